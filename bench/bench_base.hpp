@@ -0,0 +1,73 @@
+#ifndef BENCH_BENCH_BASE_HPP
+#define BENCH_BENCH_BASE_HPP
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "common/aligned_allocator.hpp"
+#include "common/types.hpp"
+#include "disk-emulator/disk.hpp"
+#include "fsfs/file_system.hpp"
+
+namespace FSFS {
+constexpr char bench_disk_name[] = "_bench_disk.img";
+constexpr auto bench_rnd_seed = 0xCAFE;
+constexpr int64_t bench_block_sizes[] = {1024, 2048, 4096};
+
+// Creates a scratch image for the lifetime of a benchmark and removes it afterwards.
+class BenchImage {
+   private:
+    const char* path;
+
+   public:
+    BenchImage(const char* path, int32_t n_blocks, int32_t block_size) : path(path) {
+        std::remove(path);
+        Disk::create(path, n_blocks, block_size);
+    }
+    ~BenchImage() { std::remove(path); }
+};
+
+// Opened scratch image, must exist before anything that mounts the disk is constructed.
+class BenchDisk {
+   private:
+    BenchImage image;
+
+   public:
+    Disk disk;
+
+    BenchDisk(int32_t n_blocks, int32_t block_size, DiskMode mode = DiskMode::Posix)
+        : image(bench_disk_name, n_blocks, block_size), disk(block_size, mode) {
+        disk.open(bench_disk_name);
+    }
+};
+
+// Formatted and mounted file system on a scratch image.
+class BenchFileSystem : public BenchDisk {
+   public:
+    FileSystem fs;
+
+    BenchFileSystem(int32_t n_blocks, int32_t block_size, DiskMode mode = DiskMode::Posix, uint32_t features = 0)
+        : BenchDisk(n_blocks, block_size, mode), fs(disk) {
+        FileSystem::format(disk, features);
+        fs.mount();
+    }
+    ~BenchFileSystem() { fs.unmount(); }
+};
+
+inline AlignedBuffer make_dummy_data(size_t length) {
+    AlignedBuffer data(length);
+    srand(bench_rnd_seed);
+    for (auto& el : data) {
+        el = static_cast<uint8_t>(rand());
+    }
+    return data;
+}
+
+inline void apply_block_sizes(benchmark::internal::Benchmark* bench) {
+    for (auto block_size : bench_block_sizes) {
+        bench->Arg(block_size);
+    }
+}
+}
+#endif
@@ -0,0 +1,205 @@
+#include <string>
+
+#include "bench_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr int32_t n_bench_blocks = 4096;
+
+template <DiskMode mode>
+void BM_disk_sequential_write(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    BenchImage image(bench_disk_name, n_bench_blocks, block_size);
+    auto w_data = make_dummy_data(block_size);
+
+    Disk disk(block_size, mode);
+    disk.open(bench_disk_name);
+    disk.mount();
+    int32_t block_n = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(disk.write(block_n, w_data.data(), block_size));
+        block_n = (block_n + 1) % n_bench_blocks;
+    }
+    disk.unmount();
+    state.SetBytesProcessed(state.iterations() * block_size);
+}
+
+template <DiskMode mode>
+void BM_disk_sequential_read(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    BenchImage image(bench_disk_name, n_bench_blocks, block_size);
+    AlignedBuffer r_data(block_size);
+
+    Disk disk(block_size, mode);
+    disk.open(bench_disk_name);
+    disk.mount();
+    int32_t block_n = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(disk.read(block_n, r_data.data(), block_size));
+        block_n = (block_n + 1) % n_bench_blocks;
+    }
+    disk.unmount();
+    state.SetBytesProcessed(state.iterations() * block_size);
+}
+
+template <DiskMode mode>
+void BM_disk_random_read(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    BenchImage image(bench_disk_name, n_bench_blocks, block_size);
+    AlignedBuffer r_data(block_size);
+
+    Disk disk(block_size, mode);
+    disk.open(bench_disk_name);
+    disk.mount();
+    srand(bench_rnd_seed);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(disk.read(rand() % n_bench_blocks, r_data.data(), block_size));
+    }
+    disk.unmount();
+    state.SetBytesProcessed(state.iterations() * block_size);
+}
+
+constexpr int32_t n_run_blocks = 64;
+
+template <DiskMode mode>
+void BM_disk_read_run_per_block(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    BenchImage image(bench_disk_name, n_bench_blocks, block_size);
+    AlignedBuffer r_data(block_size * n_run_blocks);
+
+    Disk disk(block_size, mode);
+    disk.open(bench_disk_name);
+    disk.mount();
+    int32_t block_n = 0;
+    for (auto _ : state) {
+        for (auto i = 0; i < n_run_blocks; i++) {
+            disk.read(block_n + i, &r_data[i * block_size], block_size);
+        }
+        block_n = (block_n + n_run_blocks) % n_bench_blocks;
+    }
+    disk.unmount();
+    state.SetBytesProcessed(state.iterations() * block_size * n_run_blocks);
+}
+
+template <DiskMode mode>
+void BM_disk_read_run_vectored(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    BenchImage image(bench_disk_name, n_bench_blocks, block_size);
+    AlignedBuffer r_data(block_size * n_run_blocks);
+    std::vector<BlockReadVec> r_vecs(n_run_blocks);
+
+    Disk disk(block_size, mode);
+    disk.open(bench_disk_name);
+    disk.mount();
+    int32_t block_n = 0;
+    for (auto _ : state) {
+        for (auto i = 0; i < n_run_blocks; i++) {
+            r_vecs[i] = {block_n + i, &r_data[i * block_size]};
+        }
+        benchmark::DoNotOptimize(disk.read_blocks(r_vecs));
+        block_n = (block_n + n_run_blocks) % n_bench_blocks;
+    }
+    disk.unmount();
+    state.SetBytesProcessed(state.iterations() * block_size * n_run_blocks);
+}
+
+template <AsyncEngine engine>
+void BM_disk_async_random_read(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    int32_t queue_depth = state.range(1);
+    BenchImage image(bench_disk_name, n_bench_blocks, block_size);
+    AlignedBuffer r_data(block_size * queue_depth);
+    std::vector<std::future<int32_t>> completions(queue_depth);
+
+    Disk disk(block_size, DiskMode::Posix);
+    disk.open(bench_disk_name);
+    disk.start_async(queue_depth, engine);
+    disk.mount();
+    srand(bench_rnd_seed);
+    for (auto _ : state) {
+        for (auto i = 0; i < queue_depth; i++) {
+            completions[i] = disk.read_async(rand() % n_bench_blocks, &r_data[i * block_size], block_size);
+        }
+        for (auto& completion : completions) {
+            benchmark::DoNotOptimize(completion.get());
+        }
+    }
+    state.counters["engine"] = static_cast<int32_t>(disk.get_async_engine());
+    disk.unmount();
+    state.SetBytesProcessed(state.iterations() * block_size * queue_depth);
+}
+
+void BM_disk_mmap_block_scan(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    BenchImage image(bench_disk_name, n_bench_blocks, block_size);
+
+    Disk disk(block_size, DiskMode::Mmap);
+    disk.open(bench_disk_name);
+    disk.mount();
+    disk.advise(DiskAccess::Sequential);
+    int32_t block_n = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(disk.map_block(block_n)[block_size - 1]);
+        block_n = (block_n + 1) % n_bench_blocks;
+    }
+    disk.unmount();
+    state.SetBytesProcessed(state.iterations() * block_size);
+}
+
+// Bulk import with 1 MiB writes, the stripe set has as many members as the second argument.
+void BM_disk_striped_bulk_write(benchmark::State& state) {
+    constexpr int32_t stripe_unit = 64 * 1024;
+    constexpr int32_t bulk_size = 1024 * 1024;
+    int32_t block_size = state.range(0);
+    int32_t n_members = state.range(1);
+    int32_t n_bulk_blocks = bulk_size / block_size;
+
+    std::vector<std::string> member_paths;
+    for (int32_t member_n = 0; member_n < n_members; member_n++) {
+        member_paths.push_back(std::string(bench_disk_name) + "." + std::to_string(member_n));
+    }
+    Disk::create_striped(bench_disk_name, member_paths, n_bench_blocks * n_bulk_blocks / 64, block_size, stripe_unit);
+    auto w_data = make_dummy_data(bulk_size);
+
+    {
+        Disk disk(block_size, DiskMode::Striped);
+        disk.open(bench_disk_name);
+        disk.mount();
+        int32_t block_n = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(disk.write(block_n, w_data.data(), bulk_size));
+            block_n = (block_n + n_bulk_blocks) % disk.get_disk_size();
+        }
+        disk.unmount();
+    }
+    state.SetBytesProcessed(state.iterations() * bulk_size);
+
+    std::remove(bench_disk_name);
+    for (auto& member_path : member_paths) {
+        std::remove(member_path.c_str());
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_disk_sequential_write, DiskMode::Stream)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_write, DiskMode::Posix)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_write, DiskMode::Mmap)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_write, DiskMode::Direct)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_write, DiskMode::Ram)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_read, DiskMode::Stream)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_read, DiskMode::Posix)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_read, DiskMode::Mmap)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_read, DiskMode::Direct)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_sequential_read, DiskMode::Ram)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_random_read, DiskMode::Stream)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_random_read, DiskMode::Posix)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_random_read, DiskMode::Mmap)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_random_read, DiskMode::Direct)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_random_read, DiskMode::Ram)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_read_run_per_block, DiskMode::Stream)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_read_run_per_block, DiskMode::Posix)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_read_run_vectored, DiskMode::Stream)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_read_run_vectored, DiskMode::Posix)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_disk_async_random_read, AsyncEngine::ThreadPool)->ArgsProduct({{4096}, {1, 8, 32}});
+BENCHMARK_TEMPLATE(BM_disk_async_random_read, AsyncEngine::Uring)->ArgsProduct({{4096}, {1, 8, 32}});
+BENCHMARK(BM_disk_mmap_block_scan)->Apply(apply_block_sizes);
+BENCHMARK(BM_disk_striped_bulk_write)->ArgsProduct({{4096}, {1, 2, 4}})->UseRealTime();
+}
@@ -0,0 +1,174 @@
+#include "fsfs/block_bitmap.hpp"
+
+#include "bench_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr int32_t n_bench_lookups = 1024;
+
+using FindFreeRowFunc = size_t (*)(const bitmap_t*, size_t, size_t);
+
+// Every block used but the last one, each lookup scans the whole bitmap.
+template <FindFreeRowFunc FindFreeRow>
+void BM_bitmap_scan_nearly_full(benchmark::State& state) {
+    int32_t n_blocks = state.range(0);
+    BlockBitmap bitmap(n_blocks);
+    for (int32_t block_n = 0; block_n < n_blocks - 1; block_n++) {
+        bitmap.set_status(block_n, 1);
+    }
+
+    auto& rows = bitmap.get_rows();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FindFreeRow(rows.data(), 0, rows.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * rows.size() * sizeof(bitmap_t));
+}
+
+void BM_bitmap_next_free_nearly_full(benchmark::State& state) {
+    int32_t n_blocks = state.range(0);
+    BlockBitmap bitmap(n_blocks);
+    for (int32_t block_n = 0; block_n < n_blocks - 1; block_n++) {
+        bitmap.set_status(block_n, 1);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bitmap.next_free(0));
+    }
+}
+
+// Bitmap of 1M+ blocks with one free block in every 64 at a random place, lookups start at
+// random offsets like allocations behind a moving cursor do.
+void BM_bitmap_next_free_fragmented(benchmark::State& state) {
+    int32_t n_blocks = state.range(0);
+    BlockBitmap bitmap(n_blocks);
+    srand(bench_rnd_seed);
+    for (int32_t block_n = 0; block_n < n_blocks; block_n++) {
+        bitmap.set_status(block_n, rand() % 64 != 0);
+    }
+
+    std::vector<int32_t> offsets(n_bench_lookups);
+    for (auto& offset : offsets) {
+        offset = rand() % (n_blocks / 2);
+    }
+
+    for (auto _ : state) {
+        for (auto offset : offsets) {
+            benchmark::DoNotOptimize(bitmap.next_free(offset));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n_bench_lookups);
+}
+
+// Bit by bit lookup through get_status() as next_free did before, for reference.
+void BM_bitmap_next_free_bitwise_fragmented(benchmark::State& state) {
+    int32_t n_blocks = state.range(0);
+    BlockBitmap bitmap(n_blocks);
+    srand(bench_rnd_seed);
+    for (int32_t block_n = 0; block_n < n_blocks; block_n++) {
+        bitmap.set_status(block_n, rand() % 64 != 0);
+    }
+
+    std::vector<int32_t> offsets(n_bench_lookups);
+    for (auto& offset : offsets) {
+        offset = rand() % (n_blocks / 2);
+    }
+
+    for (auto _ : state) {
+        for (auto offset : offsets) {
+            int32_t block_n = offset;
+            while (block_n < n_blocks && bitmap.get_status(block_n)) {
+                block_n++;
+            }
+            benchmark::DoNotOptimize(block_n);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n_bench_lookups);
+}
+
+// Allocation from the start of a 16M block bitmap filled from the front to the given percent,
+// like FileSystem::write does. The block is freed again to keep the fill level.
+void BM_bitmap_allocate_filling(benchmark::State& state) {
+    constexpr int32_t n_blocks = 1 << 24;
+    int32_t n_used_blocks = static_cast<int64_t>(n_blocks) * state.range(0) / 100;
+    BlockBitmap bitmap(n_blocks);
+    for (int32_t block_n = 0; block_n < n_used_blocks; block_n++) {
+        bitmap.set_status(block_n, 1);
+    }
+
+    for (auto _ : state) {
+        int32_t block_n = bitmap.next_free(0);
+        bitmap.set_status(block_n, 1);
+        bitmap.set_status(block_n, 0);
+        benchmark::DoNotOptimize(block_n);
+    }
+}
+
+// Files of a 64K block bitmap grown by appends of 1 to 16 blocks in random order, each append
+// hinted with the file end. Once three quarters of the blocks are used, random files are removed
+// until half are. Counters show the runs a file is split into and the free runs left between them,
+// every policy runs the same appends so they are comparable.
+template <AllocPolicy Policy>
+void BM_bitmap_alloc_policy(benchmark::State& state) {
+    constexpr int32_t n_blocks = 1 << 16;
+    constexpr int32_t n_files = 256;
+    BlockBitmap bitmap(n_blocks);
+    bitmap.set_alloc_policy(Policy);
+    std::vector<std::vector<int32_t>> files(n_files);
+    srand(bench_rnd_seed);
+
+    for (auto _ : state) {
+        auto& file_blocks = files[rand() % n_files];
+        int32_t n_blocks_left = rand() % 16 + 1;
+        while (n_blocks_left > 0) {
+            int32_t hint = file_blocks.empty() ? fs_nullptr : file_blocks.back() + 1;
+            int32_t first_block_n = fs_nullptr;
+            int32_t run_len = bitmap.allocate(n_blocks_left, hint, first_block_n);
+            for (int32_t block_n = first_block_n; block_n < first_block_n + run_len; block_n++) {
+                file_blocks.push_back(block_n);
+            }
+            n_blocks_left -= run_len;
+        }
+
+        if (bitmap.get_n_used() > n_blocks / 4 * 3) {
+            state.PauseTiming();
+            while (bitmap.get_n_used() > n_blocks / 2) {
+                auto& removed_blocks = files[rand() % n_files];
+                for (auto block_n : removed_blocks) {
+                    bitmap.set_status(block_n, 0);
+                }
+                removed_blocks.clear();
+            }
+            state.ResumeTiming();
+        }
+    }
+
+    int64_t n_file_runs = 0;
+    int32_t n_stored_files = 0;
+    for (const auto& file_blocks : files) {
+        for (size_t ptr_n = 0; ptr_n < file_blocks.size(); ptr_n++) {
+            n_file_runs += ptr_n == 0 || file_blocks[ptr_n] != file_blocks[ptr_n - 1] + 1;
+        }
+        n_stored_files += !file_blocks.empty();
+    }
+
+    int32_t n_free_runs = 0;
+    int32_t first_block_n = 0;
+    for (int32_t offset = 0, run_len; (run_len = bitmap.next_free_run(offset, first_block_n)) > 0;) {
+        offset = first_block_n + run_len;
+        n_free_runs++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["runs_per_file"] = static_cast<double>(n_file_runs) / std::max(1, n_stored_files);
+    state.counters["free_runs"] = n_free_runs;
+}
+
+BENCHMARK(BM_bitmap_allocate_filling)->Arg(0)->Arg(50)->Arg(90)->Arg(99);
+BENCHMARK_TEMPLATE(BM_bitmap_scan_nearly_full, find_free_row_portable)->Arg(1 << 20)->Arg(1 << 24);
+BENCHMARK_TEMPLATE(BM_bitmap_scan_nearly_full, find_free_row_avx2)->Arg(1 << 20)->Arg(1 << 24);
+BENCHMARK(BM_bitmap_next_free_nearly_full)->Arg(1 << 20)->Arg(1 << 24);
+BENCHMARK(BM_bitmap_next_free_fragmented)->Arg(1 << 20)->Arg(1 << 24);
+BENCHMARK(BM_bitmap_next_free_bitwise_fragmented)->Arg(1 << 20)->Arg(1 << 24);
+BENCHMARK_TEMPLATE(BM_bitmap_alloc_policy, AllocPolicy::FirstFit)->Iterations(1 << 17);
+BENCHMARK_TEMPLATE(BM_bitmap_alloc_policy, AllocPolicy::NextFit)->Iterations(1 << 17);
+BENCHMARK_TEMPLATE(BM_bitmap_alloc_policy, AllocPolicy::BestFit)->Iterations(1 << 17);
+}
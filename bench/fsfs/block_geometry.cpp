@@ -0,0 +1,32 @@
+#include "fsfs/block_geometry.hpp"
+
+#include "bench_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr int32_t n_bench_offsets = 4096;
+
+// Offset to block/offset split done for every chunk of a read or write.
+template <typename Geometry>
+void BM_block_geometry_split(benchmark::State& state) {
+    Geometry geometry(state.range(0));
+    std::vector<int32_t> offsets(n_bench_offsets);
+    srand(bench_rnd_seed);
+    for (auto& offset : offsets) {
+        offset = rand() % (1 << 30);
+    }
+
+    for (auto _ : state) {
+        int32_t sum = 0;
+        for (auto offset : offsets) {
+            sum += geometry.block_of(offset) + geometry.offset_in_block(offset) + geometry.blocks_for(offset);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n_bench_offsets);
+}
+
+BENCHMARK_TEMPLATE(BM_block_geometry_split, BlockGeometry)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_block_geometry_split, FixedBlockGeometry<1024>)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_block_geometry_split, FixedBlockGeometry<2048>)->Arg(2048);
+BENCHMARK_TEMPLATE(BM_block_geometry_split, FixedBlockGeometry<4096>)->Arg(4096);
+}
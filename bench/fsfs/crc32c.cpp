@@ -0,0 +1,29 @@
+#include "fsfs/crc32c.hpp"
+
+#include "bench_base.hpp"
+using namespace FSFS;
+namespace {
+void BM_crc32c_portable(benchmark::State& state) {
+    auto data = make_dummy_data(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(crc32c_portable(data.data(), data.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+void BM_crc32c_hw(benchmark::State& state) {
+    if (!crc32c_hw_supported()) {
+        state.SkipWithError("No CRC32C instruction on this host.");
+        return;
+    }
+
+    auto data = make_dummy_data(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(crc32c_hw(data.data(), data.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+BENCHMARK(BM_crc32c_portable)->Apply(apply_block_sizes)->Arg(64 * 1024);
+BENCHMARK(BM_crc32c_hw)->Apply(apply_block_sizes)->Arg(64 * 1024);
+}
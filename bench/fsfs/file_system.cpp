@@ -0,0 +1,322 @@
+#include "bench_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr int32_t n_bench_blocks = 8192;
+constexpr int32_t bench_file_size = 1024 * 1024;
+
+template <DiskMode Mode>
+void BM_fs_write_file(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    auto w_data = make_dummy_data(bench_file_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, Mode);
+    bench_fs.disk.reset_io_stats();
+    for (auto _ : state) {
+        int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+        benchmark::DoNotOptimize(bench_fs.fs.write(inode_n, w_data.data(), 0, bench_file_size));
+        bench_fs.fs.remove_file(inode_n);
+    }
+    state.SetBytesProcessed(state.iterations() * bench_file_size);
+
+    // Bytes written to the disk per byte of file data
+    auto totals = bench_fs.disk.get_io_stats()->get_totals();
+    state.counters["write_amp"] = static_cast<double>(totals.bytes_written) / (state.iterations() * bench_file_size);
+    state.counters["disk_reads"] = benchmark::Counter(totals.n_reads, benchmark::Counter::kAvgIterations);
+}
+
+template <DiskMode Mode>
+void BM_fs_read_file(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    auto w_data = make_dummy_data(bench_file_size);
+    std::vector<uint8_t> r_data(bench_file_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, Mode);
+    int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+    bench_fs.fs.write(inode_n, w_data.data(), 0, bench_file_size);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_fs.fs.read(inode_n, r_data.data(), 0, bench_file_size));
+    }
+    state.SetBytesProcessed(state.iterations() * bench_file_size);
+}
+
+// Mount of a file system holding many files, scanned without stored bitmaps and loaded from them with.
+template <uint32_t Features>
+void BM_fs_mount(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    constexpr int32_t n_files = 64;
+    constexpr int32_t file_size = 64 * 1024;
+    auto w_data = make_dummy_data(file_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, DiskMode::Ram, Features);
+    for (int32_t file_n = 0; file_n < n_files; file_n++) {
+        int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+        bench_fs.fs.write(inode_n, w_data.data(), 0, file_size);
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        bench_fs.fs.unmount();
+        bench_fs.disk.reset_io_stats();
+        state.ResumeTiming();
+        bench_fs.fs.mount();
+    }
+    state.counters["disk_reads"] = bench_fs.disk.get_io_stats()->get_totals().n_reads;
+    state.counters["scanned"] = bench_fs.fs.is_scanned_on_mount();
+}
+
+// Export in block sized chunks like the CLI does, the second argument is the read-ahead window.
+template <DiskMode Mode>
+void BM_fs_read_file_chunked(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    auto w_data = make_dummy_data(bench_file_size);
+    std::vector<uint8_t> r_data(bench_file_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, Mode);
+    bench_fs.fs.set_read_ahead(state.range(1));
+    int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+    bench_fs.fs.write(inode_n, w_data.data(), 0, bench_file_size);
+    for (auto _ : state) {
+        // Blocks cached by the previous pass would hide the disk latency
+        state.PauseTiming();
+        bench_fs.fs.unmount();
+        bench_fs.fs.mount();
+        bench_fs.disk.reset_io_stats();
+        state.ResumeTiming();
+        for (int32_t offset = 0; offset < bench_file_size; offset += block_size) {
+            benchmark::DoNotOptimize(bench_fs.fs.read(inode_n, &r_data[offset], offset, block_size));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * bench_file_size);
+
+    auto& cache = bench_fs.fs.get_block_cache();
+    state.counters["disk_reads"] = bench_fs.disk.get_io_stats()->get_totals().n_reads;
+    state.counters["prefetch_hit_rate"] =
+        cache.get_n_prefetched() ? static_cast<double>(cache.get_n_prefetch_hits()) / cache.get_n_prefetched() : 0;
+}
+
+// Random reads of a few hot files interrupted by a sweep like a directory listing does, every inode
+// is looked at and the first block of each cold file is read.
+template <CachePolicy Policy>
+void BM_fs_sweep_and_hot_reads(benchmark::State& state) {
+    constexpr int32_t n_hot_files = 4;
+    constexpr int32_t n_cold_files = 64;
+    constexpr int32_t n_hot_reads = 256;
+    int32_t block_size = state.range(0);
+    int32_t hot_file_size = 4 * block_size;
+    int32_t read_len = block_size / 2;
+    auto w_data = make_dummy_data(hot_file_size);
+    std::vector<uint8_t> r_data(read_len);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, DiskMode::Posix);
+    bench_fs.fs.set_cache_policy(Policy);
+    bench_fs.fs.set_read_ahead(0);
+    std::vector<int32_t> hot_inode_ns;
+    for (int32_t file_n = 0; file_n < n_hot_files + n_cold_files; file_n++) {
+        int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+        bool is_hot = file_n % (n_cold_files / n_hot_files + 1) == 0 && static_cast<int32_t>(hot_inode_ns.size()) < n_hot_files;
+        bench_fs.fs.write(inode_n, w_data.data(), 0, is_hot ? hot_file_size : block_size);
+        if (is_hot) {
+            hot_inode_ns.push_back(inode_n);
+        }
+    }
+
+    int32_t n_inodes = bench_fs.fs.get_inode_blocks_ammount();
+    srand(bench_rnd_seed);
+    bench_fs.disk.reset_io_stats();
+    for (auto _ : state) {
+        for (int32_t inode_n = 0; inode_n < n_inodes; inode_n++) {
+            if (bench_fs.fs.get_file_length(inode_n) > 0) {
+                bench_fs.fs.read(inode_n, r_data.data(), 0, 1);
+            }
+        }
+
+        for (int32_t read_n = 0; read_n < n_hot_reads; read_n++) {
+            int32_t inode_n = hot_inode_ns[rand() % n_hot_files];
+            int32_t offset = (rand() % (hot_file_size / read_len)) * read_len;
+            benchmark::DoNotOptimize(bench_fs.fs.read(inode_n, r_data.data(), offset, read_len));
+        }
+    }
+
+    auto& cache = bench_fs.fs.get_block_cache();
+    state.counters["hit_rate"] = static_cast<double>(cache.get_n_hits()) / (cache.get_n_hits() + cache.get_n_misses());
+    state.counters["disk_reads"] =
+        benchmark::Counter(bench_fs.disk.get_io_stats()->get_totals().n_reads, benchmark::Counter::kAvgIterations);
+}
+
+// Cold export of a file from a RAM disk, with and without CRC32C verification of every block read.
+template <uint32_t Features>
+void BM_fs_read_file_cold(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    auto w_data = make_dummy_data(bench_file_size);
+    std::vector<uint8_t> r_data(bench_file_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, DiskMode::Ram, Features);
+    int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+    bench_fs.fs.write(inode_n, w_data.data(), 0, bench_file_size);
+    for (auto _ : state) {
+        state.PauseTiming();
+        bench_fs.fs.unmount();
+        bench_fs.fs.mount();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(bench_fs.fs.read(inode_n, r_data.data(), 0, bench_file_size));
+    }
+    state.SetBytesProcessed(state.iterations() * bench_file_size);
+    state.counters["verified"] = bench_fs.fs.get_block_checksums().get_n_verified();
+}
+
+// Same export through pinned views, the data is consumed straight from the block cache.
+template <DiskMode Mode>
+void BM_fs_read_file_views(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    auto w_data = make_dummy_data(bench_file_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, Mode);
+    int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+    bench_fs.fs.write(inode_n, w_data.data(), 0, bench_file_size);
+    for (auto _ : state) {
+        uint8_t checksum = 0;
+        for (int32_t offset = 0; offset < bench_file_size;) {
+            auto view = bench_fs.fs.read_view(inode_n, offset, bench_file_size - offset);
+            checksum ^= view.data()[view.size() - 1];
+            offset += view.size();
+        }
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetBytesProcessed(state.iterations() * bench_file_size);
+}
+
+// Two files grown by interleaved appends of a few blocks on a disk with one block holes left by
+// removed files, then one is read back cold. Every append is placed in one run, so the read seeks
+// only where the other file sits between the runs.
+void BM_fs_read_interleaved_appends(benchmark::State& state) {
+    constexpr int32_t n_appends = 32;
+    constexpr int32_t n_holes = 256;
+    int32_t block_size = state.range(0);
+    int32_t append_size = state.range(1) * block_size;
+    auto w_data = make_dummy_data(append_size);
+    std::vector<uint8_t> r_data(n_appends * append_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, DiskMode::Posix);
+    bench_fs.fs.set_read_ahead(0);
+    for (int32_t file_n = 0; file_n < 2 * n_holes; file_n++) {
+        int32_t inode_n = bench_fs.fs.create_file("hole.bin");
+        bench_fs.fs.write(inode_n, w_data.data(), 0, block_size);
+    }
+    for (int32_t inode_n = 0; inode_n < 2 * n_holes; inode_n += 2) {
+        bench_fs.fs.remove_file(inode_n);
+    }
+
+    int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+    int32_t other_inode_n = bench_fs.fs.create_file("other.bin");
+    for (int32_t append_n = 0; append_n < n_appends; append_n++) {
+        bench_fs.fs.write(inode_n, w_data.data(), 0, append_size);
+        bench_fs.fs.write(other_inode_n, w_data.data(), 0, block_size);
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        bench_fs.fs.unmount();
+        bench_fs.fs.mount();
+        bench_fs.disk.reset_io_stats();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(bench_fs.fs.read(inode_n, r_data.data(), 0, r_data.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * r_data.size());
+    state.counters["seeks"] = bench_fs.disk.get_io_stats()->get_totals().n_seeks;
+}
+
+// Small reads and writes from a RAM disk spend their time in the offset arithmetic and the cache
+// lookups, compares the paths specialized for the block size with the generic one.
+template <BlockArithmetic Arithmetic>
+void BM_fs_small_chunks(benchmark::State& state) {
+    constexpr int32_t chunk_size = 100;
+    int32_t block_size = state.range(0);
+    auto w_data = make_dummy_data(bench_file_size);
+    std::vector<uint8_t> r_data(chunk_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size, DiskMode::Ram);
+    bench_fs.fs.set_block_arithmetic(Arithmetic);
+    int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+    bench_fs.fs.write(inode_n, w_data.data(), 0, bench_file_size);
+    for (auto _ : state) {
+        for (int32_t offset = 0; offset + chunk_size <= bench_file_size; offset += chunk_size) {
+            benchmark::DoNotOptimize(bench_fs.fs.read(inode_n, r_data.data(), offset, chunk_size));
+        }
+        benchmark::DoNotOptimize(bench_fs.fs.write(inode_n, r_data.data(), bench_file_size / 2, chunk_size));
+    }
+    state.SetBytesProcessed(state.iterations() * bench_file_size);
+}
+
+void BM_fs_write_file_device_time(benchmark::State& state) {
+    int32_t block_size = state.range(0);
+    auto w_data = make_dummy_data(bench_file_size);
+
+    BenchFileSystem bench_fs(n_bench_blocks, block_size);
+    bench_fs.disk.set_timing(default_nand_timing);
+    for (auto _ : state) {
+        int32_t inode_n = bench_fs.fs.create_file("bench.bin");
+        benchmark::DoNotOptimize(bench_fs.fs.write(inode_n, w_data.data(), 0, bench_file_size));
+        bench_fs.fs.remove_file(inode_n);
+    }
+
+    auto stats = bench_fs.disk.get_timing_model()->get_stats();
+    state.counters["device_ms"] = benchmark::Counter(stats.device_time.count() / 1e6, benchmark::Counter::kAvgIterations);
+    state.counters["erases"] = benchmark::Counter(stats.n_block_erases, benchmark::Counter::kAvgIterations);
+    state.counters["programs"] = benchmark::Counter(stats.n_page_programs, benchmark::Counter::kAvgIterations);
+}
+
+// Log-like appends of small uneven chunks, alternates inode, indirect and data blocks.
+template <WriteMode Mode>
+void BM_fs_append_small_writes(benchmark::State& state) {
+    constexpr int32_t chunk_size = 1000;
+    constexpr int32_t n_chunks = 512;
+    int32_t block_size = state.range(0);
+    int32_t n_cache_entries = state.range(1);
+    auto w_data = make_dummy_data(chunk_size);
+
+    BenchDisk bench_disk(n_bench_blocks, block_size);
+    FileSystem::format(bench_disk.disk);
+    FileSystem fs(bench_disk.disk, n_cache_entries);
+    fs.mount();
+    fs.set_write_mode(Mode);
+    bench_disk.disk.reset_io_stats();
+    for (auto _ : state) {
+        int32_t inode_n = fs.create_file("bench.log");
+        for (int32_t chunk_n = 0; chunk_n < n_chunks; chunk_n++) {
+            benchmark::DoNotOptimize(fs.write(inode_n, w_data.data(), 0, chunk_size));
+        }
+        fs.flush();
+        fs.remove_file(inode_n);
+    }
+    state.SetBytesProcessed(state.iterations() * n_chunks * chunk_size);
+
+    auto& cache = fs.get_block_cache();
+    auto totals = bench_disk.disk.get_io_stats()->get_totals();
+    state.counters["disk_reads"] = benchmark::Counter(totals.n_reads, benchmark::Counter::kAvgIterations);
+    state.counters["disk_writes"] = benchmark::Counter(totals.n_blocks_written, benchmark::Counter::kAvgIterations);
+    state.counters["hit_rate"] = static_cast<double>(cache.get_n_hits()) / (cache.get_n_hits() + cache.get_n_misses());
+    fs.unmount();
+}
+
+BENCHMARK_TEMPLATE(BM_fs_write_file, DiskMode::Posix)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_fs_write_file, DiskMode::Ram)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_fs_read_file, DiskMode::Posix)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_fs_read_file, DiskMode::Ram)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_fs_mount, 0)->ArgsProduct({{1024, 4096}});
+BENCHMARK_TEMPLATE(BM_fs_mount, fs_feature_allocation_bitmaps)->ArgsProduct({{1024, 4096}});
+BENCHMARK_TEMPLATE(BM_fs_read_file_chunked, DiskMode::Posix)->ArgsProduct({{1024, 4096}, {0, 4, 16}});
+BENCHMARK_TEMPLATE(BM_fs_read_file_chunked, DiskMode::Direct)->ArgsProduct({{1024, 4096}, {0, 4, 16}});
+BENCHMARK_TEMPLATE(BM_fs_read_file_chunked, DiskMode::Ram)->ArgsProduct({{1024, 4096}, {16}});
+BENCHMARK_TEMPLATE(BM_fs_read_file_views, DiskMode::Ram)->ArgsProduct({{1024, 4096}});
+BENCHMARK_TEMPLATE(BM_fs_sweep_and_hot_reads, CachePolicy::Lru)->ArgsProduct({{1024, 4096}});
+BENCHMARK_TEMPLATE(BM_fs_sweep_and_hot_reads, CachePolicy::TwoQ)->ArgsProduct({{1024, 4096}});
+BENCHMARK_TEMPLATE(BM_fs_read_file_cold, 0)->ArgsProduct({{1024, 4096}});
+BENCHMARK_TEMPLATE(BM_fs_read_file_cold, fs_feature_block_checksums)->ArgsProduct({{1024, 4096}});
+BENCHMARK(BM_fs_read_interleaved_appends)->ArgsProduct({{1024, 4096}, {4, 16}});
+BENCHMARK_TEMPLATE(BM_fs_small_chunks, BlockArithmetic::Generic)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_fs_small_chunks, BlockArithmetic::Specialized)->Apply(apply_block_sizes);
+BENCHMARK(BM_fs_write_file_device_time)->Apply(apply_block_sizes);
+BENCHMARK_TEMPLATE(BM_fs_append_small_writes, WriteMode::WriteThrough)
+    ->ArgsProduct({{1024, 4096}, {1, 4, default_block_cache_entries}});
+BENCHMARK_TEMPLATE(BM_fs_append_small_writes, WriteMode::WriteBack)
+    ->ArgsProduct({{1024, 4096}, {1, 4, default_block_cache_entries}});
+}
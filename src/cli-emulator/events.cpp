@@ -1,20 +1,51 @@
 #include "events.hpp"
 
 #include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "common/pool_allocator.hpp"
 #include "common/types.hpp"
 #include "disk-emulator/disk.hpp"
+#include "disk-emulator/striped_disk_backend.hpp"
 #include "fsfs/file_system.hpp"
 
 namespace FSFS {
 constexpr size_t chunk_size = 4096;
+constexpr int32_t stripe_set_n_members = 2;
 namespace {
 void display_critical_error(const std::exception& e) {
     printf("Critical error occured with message:\n\t%s\nAction terminated!\n", e.what());
 }
+
+// Stripe set descriptions (see Disk::create_striped) are recognized by extension.
+DiskMode disk_mode(const char* disk_path) {
+    std::string_view path(disk_path);
+    std::string_view extension(stripe_set_extension);
+    if (path.size() > extension.size() && path.substr(path.size() - extension.size()) == extension) {
+        return DiskMode::Striped;
+    }
+    return DiskMode::Stream;
+}
+
+// Stripe set gets its members next to the description, named after it, striped by single blocks.
+void create_image(const char* disk_path, int32_t n_blocks, int32_t block_size) {
+    if (disk_mode(disk_path) != DiskMode::Striped) {
+        Disk::create(disk_path, n_blocks, block_size);
+        return;
+    }
+
+    std::string member_stem = std::filesystem::path(disk_path).stem().string();
+    std::vector<std::string> member_paths;
+    for (int32_t member_n = 0; member_n < stripe_set_n_members; member_n++) {
+        member_paths.push_back(member_stem + "." + std::to_string(member_n) + ".img");
+    }
+    Disk::create_striped(disk_path, member_paths, n_blocks, block_size, block_size);
+}
 }
 void event_invalid_parsing() {
     // No action required
@@ -26,22 +57,15 @@ void event_display_help() {
 
 void event_display_stats(const char* disk_path, int block_size, int inode_n) {
     try {
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem fs(disk);
         fs.mount();
-        auto inode_bitmap = fs.get_inode_bitmap();
-        auto block_bitmap = fs.get_data_bitmap();
+        const auto& inode_bitmap = fs.get_inode_bitmap();
 
         if (inode_n == -1) {
-            auto used_inode_blocks = 0;
-            for (auto i = 0; i < fs.get_inode_blocks_ammount(); i++) {
-                used_inode_blocks += inode_bitmap.get_status(i) ? 1 : 0;
-            }
-            auto used_data_blocks = 0;
-            for (auto i = 0; i < fs.get_data_blocks_ammount(); i++) {
-                used_data_blocks += block_bitmap.get_status(i) ? 1 : 0;
-            }
+            auto used_inode_blocks = fs.get_inode_blocks_ammount() - fs.free_inodes();
+            auto used_data_blocks = fs.get_data_blocks_ammount() - fs.free_data_blocks();
 
             printf("Disk stats:\n");
             printf("\tDisk block size: %d kb.\n", disk.get_block_size());
@@ -73,11 +97,11 @@ void event_display_stats(const char* disk_path, int block_size, int inode_n) {
 
 void event_display_files(const char* disk_path, int block_size) {
     try {
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem fs(disk);
         fs.mount();
-        auto inode_bitmap = fs.get_inode_bitmap();
+        const auto& inode_bitmap = fs.get_inode_bitmap();
 
         size_t files_found = 0;
         for (auto inode_n = 0; inode_n < fs.get_inode_blocks_ammount(); inode_n++) {
@@ -98,10 +122,11 @@ void event_display_files(const char* disk_path, int block_size) {
 
 void event_write_data(const char* disk_path, int block_size, const char* file_name, int inode_n) {
     try {
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem fs(disk);
         fs.mount();
+        fs.set_write_mode(WriteMode::WriteBack);
 
         // 1. Open file on hosts disk
         //
@@ -117,12 +142,10 @@ void event_write_data(const char* disk_path, int block_size, const char* file_na
         size_t host_file_size = in_file.tellg();
         in_file.seekg(0, in_file.beg);
 
-        // 2. Prepare buffor for file system
+        // 2. Prepare buffor for file system, the only one used for the whole transfer
         //
         printf("Reading file...\n");
-        char r_char_buffer[chunk_size];
-
-        std::vector<uint8_t> r_buffer;
+        AlignedArena r_buffer;
         r_buffer.resize(chunk_size * sizeof(char));
 
         // 3. Check if file already exists
@@ -151,10 +174,9 @@ void event_write_data(const char* disk_path, int block_size, const char* file_na
             size_t to_read = std::min(chunk_size, to_write);
             to_write -= to_read;
 
-            // Read file, fill the buffor and append to filesystem's inode
+            // Read file straight into the buffor and append to filesystem's inode
             // We cannot trust that char is 8-bits, we need to type pun here
-            in_file.read(r_char_buffer, to_read);
-            memcpy(r_buffer.data(), r_char_buffer, chunk_size * sizeof(char));
+            in_file.read(reinterpret_cast<char*>(r_buffer.data()), to_read);
             if (fs.write(write_inode_n, r_buffer.data(), 0, to_read) == -1) {
                 throw std::runtime_error("Cannot write to the filesystem image.");
             }
@@ -174,7 +196,7 @@ void event_write_data(const char* disk_path, int block_size, const char* file_na
 
 void event_read_data(const char* disk_path, int block_size, int inode_n) {
     try {
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem fs(disk);
         fs.mount();
@@ -201,29 +223,20 @@ void event_read_data(const char* disk_path, int block_size, int inode_n) {
         }
         out_file.seekg(0, std::ios::end);
 
-        // 3. Prepare buffers
-        char w_char_buffer[chunk_size];
-
-        std::vector<uint8_t> w_buffer;
-        w_buffer.resize(chunk_size * sizeof(char));
-
-        // 4. Read file and write to the end of host's file
+        // 3. Read file block by block and write to the end of host's file
         //
         size_t n_written = 0;
         size_t to_read = file_size;
-        auto cnt = 0;
         while (to_read > 0) {
-            // Calc the minimal chunk the file that can be read
-            size_t to_write = std::min(chunk_size, to_read);
-            to_read -= to_write;
-            if (fs.read(inode_n, w_buffer.data(), n_written, to_write) == -1) {
-                throw std::runtime_error("Cannot write to the filesystem image.");
+            // Cached block is written out directly, without copying it to a buffer first
+            auto view = fs.read_view(inode_n, n_written, std::min(chunk_size, to_read));
+            if (view.size() == 0) {
+                throw std::runtime_error("Cannot read from the filesystem image.");
             }
 
-            // We cannot trust that char is 8-bits, we need to type pun here
-            memcpy(w_char_buffer, w_buffer.data(), chunk_size * sizeof(char));
-            out_file.write(w_char_buffer, to_write);
-            n_written += to_write;
+            out_file.write(reinterpret_cast<const char*>(view.data()), view.size());
+            n_written += view.size();
+            to_read -= view.size();
             printf("\rReading: [%ld/%d]", n_written, file_size);
         }
         printf("\n");
@@ -232,6 +245,11 @@ void event_read_data(const char* disk_path, int block_size, int inode_n) {
         fs.unmount();
 
         printf("%ld bytes of data writen to %s.\n", n_written, out_file_name);
+        auto& cache = fs.get_block_cache();
+        if (cache.get_n_prefetched() > 0) {
+            printf("Read-ahead: %ld blocks prefetched, %.1f%% used.\n", cache.get_n_prefetched(),
+                   100.0 * cache.get_n_prefetch_hits() / cache.get_n_prefetched());
+        }
     } catch (const std::exception& e) {
         display_critical_error(e);
     }
@@ -239,7 +257,7 @@ void event_read_data(const char* disk_path, int block_size, int inode_n) {
 
 void event_delete_file(const char* disk_path, int block_size, int inode_n) {
     try {
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem fs(disk);
         fs.mount();
@@ -254,7 +272,7 @@ void event_delete_file(const char* disk_path, int block_size, int inode_n) {
 
 void event_rename_file(const char* disk_path, int block_size, int inode_n, const char* new_file_name) {
     try {
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem fs(disk);
         fs.mount();
@@ -275,7 +293,7 @@ void event_format_disk(const char* disk_path, int block_size) {
     }
 
     try {
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem::format(disk);
 
@@ -287,9 +305,9 @@ void event_format_disk(const char* disk_path, int block_size) {
 
 void event_create_disk(const char* disk_path, int block_size, int size) {
     try {
-        Disk::create(disk_path, size, block_size);
+        create_image(disk_path, size, block_size);
 
-        Disk disk(block_size);
+        Disk disk(block_size, disk_mode(disk_path));
         disk.open(disk_path);
         FileSystem::format(disk);
 
@@ -0,0 +1,43 @@
+#ifndef COMMON_ALIGNED_ALLOCATOR_HPP
+#define COMMON_ALIGNED_ALLOCATOR_HPP
+#include <stddef.h>
+
+#include <new>
+#include <vector>
+
+#include "types.hpp"
+namespace FSFS {
+// Strictest alignment required by direct I/O on the host (page size).
+constexpr size_t io_alignment = 4096;
+
+template <typename T, size_t Alignment = io_alignment>
+class AlignedAllocator {
+   public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {
+    return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {
+    return false;
+}
+
+using AlignedBuffer = std::vector<uint8_t, AlignedAllocator<uint8_t>>;
+}
+#endif
@@ -0,0 +1,162 @@
+#ifndef COMMON_POOL_ALLOCATOR_HPP
+#define COMMON_POOL_ALLOCATOR_HPP
+#include <stddef.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "aligned_allocator.hpp"
+#include "types.hpp"
+namespace FSFS {
+constexpr size_t default_node_slot_size = 32;
+constexpr size_t default_node_slots_per_chunk = 64;
+
+// Fixed size slots carved from chunks kept until the pool is destroyed. Freed slots are
+// reused first, so a container holding a steady number of nodes stops allocating once warm.
+class NodePool {
+   private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    size_t slot_size;
+    size_t slots_per_chunk;
+    std::vector<std::unique_ptr<uint8_t[]>> chunks;
+    FreeSlot* free_slots;
+    size_t n_free;
+
+    void add_chunk() {
+        chunks.emplace_back(new uint8_t[slot_size * slots_per_chunk]);
+        for (size_t slot_n = 0; slot_n < slots_per_chunk; slot_n++) {
+            release(&chunks.back()[slot_n * slot_size]);
+        }
+    }
+
+   public:
+    NodePool(size_t slot_size = default_node_slot_size, size_t slots_per_chunk = default_node_slots_per_chunk)
+        : slot_size(slot_size), slots_per_chunk(slots_per_chunk), free_slots(nullptr), n_free(0) {
+        if (slot_size == 0 || slots_per_chunk == 0) {
+            throw std::invalid_argument("Slot size and slots per chunk must be greater than 0.");
+        }
+
+        // Every slot must be able to hold any node and the free list link
+        this->slot_size = std::max(slot_size, sizeof(FreeSlot));
+        this->slot_size = (this->slot_size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    void* acquire() {
+        if (free_slots == nullptr) {
+            add_chunk();
+        }
+
+        FreeSlot* slot = free_slots;
+        free_slots = slot->next;
+        n_free--;
+        return slot;
+    }
+
+    void release(void* p) noexcept {
+        FreeSlot* slot = static_cast<FreeSlot*>(p);
+        slot->next = free_slots;
+        free_slots = slot;
+        n_free++;
+    }
+
+    void reserve(size_t n_slots) {
+        while (n_free < n_slots) {
+            add_chunk();
+        }
+    }
+
+    size_t get_slot_size() const { return slot_size; };
+    size_t get_n_slots() const { return chunks.size() * slots_per_chunk; };
+    size_t get_n_free() const { return n_free; };
+};
+
+// Standard allocator drawing single nodes from a NodePool. Arrays and nodes bigger than
+// a slot, like hash table buckets, still come from the heap, as does everything when
+// no pool is given.
+template <typename T>
+class PoolAllocator {
+   private:
+    template <typename U>
+    friend class PoolAllocator;
+
+    NodePool* pool;
+
+    bool from_pool(size_t n) const { return pool != nullptr && n == 1 && sizeof(T) <= pool->get_slot_size(); }
+
+   public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = PoolAllocator<U>;
+    };
+
+    PoolAllocator() : pool(nullptr) {}
+    explicit PoolAllocator(NodePool& pool) : pool(&pool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(size_t n) {
+        if (from_pool(n)) {
+            return static_cast<T*>(pool->acquire());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (from_pool(n)) {
+            pool->release(p);
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    NodePool* get_pool() const { return pool; };
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+    return lhs.get_pool() == rhs.get_pool();
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+    return !(lhs == rhs);
+}
+
+// One aligned allocation of fixed capacity, memory is left uninitialized so a big arena
+// costs nothing until it is touched.
+class AlignedArena {
+   private:
+    std::unique_ptr<uint8_t, void (*)(uint8_t*)> memory;
+    size_t capacity;
+
+    static void free_memory(uint8_t* p) { AlignedAllocator<uint8_t>().deallocate(p, 0); }
+
+   public:
+    AlignedArena() : memory(nullptr, free_memory), capacity(0) {}
+
+    void resize(size_t new_capacity) {
+        if (new_capacity == capacity) {
+            return;
+        }
+
+        memory.reset(new_capacity ? AlignedAllocator<uint8_t>().allocate(new_capacity) : nullptr);
+        capacity = new_capacity;
+    }
+
+    uint8_t* data() { return memory.get(); };
+    size_t size() const { return capacity; };
+};
+}
+#endif
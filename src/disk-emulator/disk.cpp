@@ -1,73 +1,390 @@
 #include "disk.hpp"
 
 #include <algorithm>
-#include <iostream>
+#include <fstream>
+#include <limits>
 #include <stdexcept>
 
+#include "striped_disk_backend.hpp"
+
 namespace FSFS {
+namespace {
+constexpr int32_t max_iov_batch = 64;
+
+// Splits scatter list into runs of consecutive blocks, each run is moved by a single vectored call.
+template <typename BlockVec, typename Transfer>
+int32_t transfer_scattered(const std::vector<BlockVec>& blocks, int32_t block_size, Transfer transfer) {
+    iovec iov[max_iov_batch];
+    int32_t n_transferred = 0;
+
+    size_t i = 0;
+    while (i < blocks.size()) {
+        int32_t first_block_n = blocks[i].block_n;
+        int32_t n_iov = 0;
+        while (i < blocks.size() && n_iov < max_iov_batch && blocks[i].block_n == first_block_n + n_iov) {
+            iov[n_iov].iov_base = const_cast<uint8_t*>(blocks[i].data);
+            iov[n_iov].iov_len = block_size;
+            n_iov++;
+            i++;
+        }
+
+        int32_t n = transfer(static_cast<int64_t>(first_block_n) * block_size, iov, n_iov);
+        n_transferred += n / block_size;
+        if (n != n_iov * block_size) {
+            break;
+        }
+    }
+
+    return n_transferred;
+}
+}
 
-Disk::Disk(int32_t block_size) : mounted(0), block_size(block_size) {
+Disk::Disk(int32_t block_size, DiskMode mode) : mounted(0), block_size(block_size), mode(mode) {
     if ((block_size % quant_block_size) != 0) {
         throw std::invalid_argument("Block size must be multiplication of 1024.");
     }
 }
 
-Disk::~Disk() { disk_img.close(); }
+Disk::~Disk() {
+    // In flight requests are accounted on completion, the queue must go before the stats
+    io_queue.reset();
+}
 
 void Disk::open(const char* path) {
     if (is_mounted()) {
         throw std::runtime_error("Image already opened.");
     }
 
-    if (disk_img.is_open()) {
-        disk_img.close();
+    io_queue.reset();
+    io_stats.reset();
+    disk_img.reset();
+
+    auto backend = DiskBackend::make(mode);
+    backend->open(path);
+    if ((backend->size() % quant_block_size) != 0) {
+        throw std::runtime_error("Image invalid size.");
     }
 
-    disk_img.open(path, std::ios::out | std::ios::in | std::ios::binary);
+    disk_img_size = backend->size();
+    disk_img = std::move(backend);
 
-    disk_img.seekg(0, std::ios::end);
-    disk_img_size = disk_img.tellg();
+    io_stats = std::make_unique<DiskStats>(block_size, get_disk_size());
+    if (timing_model) {
+        set_timing(timing_model->get_timing());
+    }
+}
 
-    if ((disk_img_size % quant_block_size) != 0) {
-        throw std::runtime_error("Image invalid size.");
+void Disk::open_ram(int32_t n_blocks) {
+    if (is_mounted()) {
+        throw std::runtime_error("Image already opened.");
+    }
+
+    if (mode != DiskMode::Ram) {
+        throw std::runtime_error("Disk is not in RAM mode.");
+    }
+
+    if (n_blocks <= 0) {
+        throw std::invalid_argument("Number of blocks must be greater than 0.");
+    }
+
+    io_queue.reset();
+    io_stats.reset();
+    disk_img.reset();
+
+    auto backend = std::make_unique<RamDiskBackend>();
+    backend->open_empty(static_cast<int64_t>(n_blocks) * block_size);
+    disk_img_size = backend->size();
+    disk_img = std::move(backend);
+
+    io_stats = std::make_unique<DiskStats>(block_size, get_disk_size());
+    if (timing_model) {
+        set_timing(timing_model->get_timing());
+    }
+}
+
+void Disk::dump(const char* path) {
+    if (!disk_img) {
+        throw std::runtime_error("Image not opened.");
+    }
+
+    std::ofstream img_file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!img_file.is_open()) {
+        throw std::runtime_error("Cannot create image.");
+    }
+
+    wait_async();
+    std::vector<uint8_t> chunk(static_cast<size_t>(block_size) * default_queue_depth);
+    for (int64_t offset = 0; offset < disk_img_size;) {
+        int32_t chunk_len = std::min<int64_t>(disk_img_size - offset, chunk.size());
+        if (disk_img->read(offset, chunk.data(), chunk_len) != chunk_len) {
+            throw std::runtime_error("Cannot read image.");
+        }
+        img_file.write(reinterpret_cast<const char*>(chunk.data()), chunk_len);
+        offset += chunk_len;
+    }
+
+    if (!img_file.good()) {
+        throw std::runtime_error("Cannot write image.");
     }
 }
 
 void Disk::create(const char* path, int32_t n_blocks, int32_t block_size) {
     std::fstream disk(path, std::ios::out | std::ios::binary);
-    int32_t disk_size = block_size * n_blocks;
+    int64_t disk_size = static_cast<int64_t>(block_size) * n_blocks;
 
     disk.seekp(disk_size - 1);
     disk.write("", 1);
 }
 
+// Relative member paths are kept in the description as given, they are taken from its directory.
+void Disk::create_striped(const char* path, const std::vector<std::string>& member_paths, int32_t n_blocks,
+                          int32_t block_size, int32_t stripe_unit) {
+    if (member_paths.empty()) {
+        throw std::invalid_argument("Stripe set needs at least one member.");
+    }
+
+    if (stripe_unit <= 0 || (stripe_unit % quant_block_size) != 0) {
+        throw std::invalid_argument("Stripe unit must be multiplication of 1024.");
+    }
+
+    int64_t disk_size = static_cast<int64_t>(block_size) * n_blocks;
+    int64_t stripe_width = static_cast<int64_t>(stripe_unit) * member_paths.size();
+    if (disk_size <= 0 || (disk_size % stripe_width) != 0) {
+        throw std::invalid_argument("Image size must be multiplication of stripe width.");
+    }
+
+    std::ofstream stripe_set(path, std::ios::out | std::ios::trunc);
+    if (!stripe_set.is_open()) {
+        throw std::runtime_error("Cannot create image.");
+    }
+
+    stripe_set << stripe_set_magic << '\n' << stripe_unit << '\n';
+    for (auto& member_path : member_paths) {
+        create(stripe_member_path(path, member_path).c_str(), disk_size / member_paths.size() / quant_block_size,
+               quant_block_size);
+        stripe_set << member_path << '\n';
+    }
+}
+
+int32_t Disk::clip_length(int64_t offset, int32_t data_len) const {
+    int64_t data_overflow = std::min<int64_t>(0, disk_img_size - (offset + data_len));
+    return std::max<int64_t>(0, data_len + data_overflow);
+}
+
+// Accesses through map_block bypass both the timing model and the counters.
+void Disk::account_read(int64_t offset, int32_t data_len) {
+    io_stats->record_read(offset, data_len);
+    if (timing_model) {
+        timing_model->read(offset, data_len);
+    }
+}
+
+void Disk::account_write(int64_t offset, int32_t data_len) {
+    io_stats->record_write(offset, data_len);
+    if (timing_model) {
+        timing_model->program(offset, data_len);
+    }
+}
+
 int32_t Disk::write(int32_t block_n, const uint8_t* data_block, int32_t data_len) {
-    if (!(disk_img.is_open() && is_mounted())) {
+    if (!(disk_img && is_mounted()) || block_n < 0 || block_n >= get_disk_size()) {
         return -1;
     }
 
-    int32_t offset = block_n * block_size;
-    int32_t data_overflow = std::min(0, disk_img_size - (offset + data_len));
-    data_len -= std::abs(data_overflow);
+    int64_t offset = static_cast<int64_t>(block_n) * block_size;
+    data_len = clip_length(offset, data_len);
 
-    disk_img.seekp(offset, disk_img.beg);
-    disk_img.write(reinterpret_cast<const char*>(data_block), data_len);
+    int32_t n_written = disk_img->write(offset, data_block, data_len);
+    account_write(offset, n_written);
 
-    return data_len;
+    return n_written;
 }
 
 int32_t Disk::read(int32_t block_n, uint8_t* data_block, int32_t data_len) {
-    if (!(disk_img.is_open() && is_mounted())) {
+    if (!(disk_img && is_mounted()) || block_n < 0 || block_n >= get_disk_size()) {
+        return -1;
+    }
+
+    int64_t offset = static_cast<int64_t>(block_n) * block_size;
+    data_len = clip_length(offset, data_len);
+
+    int32_t n_read = disk_img->read(offset, data_block, data_len);
+    account_read(offset, n_read);
+
+    return n_read;
+}
+
+int32_t Disk::run_length(int32_t block_n, int32_t n_blocks) const {
+    if (!(disk_img && is_mounted()) || block_n < 0 || n_blocks < 0 ||
+        static_cast<int64_t>(block_n) + n_blocks > get_disk_size()) {
+        return -1;
+    }
+
+    int64_t data_len = static_cast<int64_t>(n_blocks) * block_size;
+    return data_len <= std::numeric_limits<int32_t>::max() ? static_cast<int32_t>(data_len) : -1;
+}
+
+int32_t Disk::write_blocks(int32_t block_n, int32_t n_blocks, const uint8_t* data_blocks) {
+    int32_t data_len = run_length(block_n, n_blocks);
+    if (data_len < 0) {
+        return -1;
+    }
+
+    int32_t n_written = write(block_n, data_blocks, data_len);
+    return n_written < 0 ? -1 : n_written / block_size;
+}
+
+int32_t Disk::read_blocks(int32_t block_n, int32_t n_blocks, uint8_t* data_blocks) {
+    int32_t data_len = run_length(block_n, n_blocks);
+    if (data_len < 0) {
+        return -1;
+    }
+
+    int32_t n_read = read(block_n, data_blocks, data_len);
+    return n_read < 0 ? -1 : n_read / block_size;
+}
+
+int32_t Disk::write_blocks(const std::vector<BlockWriteVec>& blocks) {
+    if (!(disk_img && is_mounted())) {
+        return -1;
+    }
+
+    for (auto& block : blocks) {
+        if (block.block_n < 0 || block.block_n >= get_disk_size()) {
+            return -1;
+        }
+    }
+
+    return transfer_scattered(blocks, block_size, [this](int64_t offset, const iovec* iov, int32_t n_iov) {
+        int32_t n_written = disk_img->writev(offset, iov, n_iov);
+        account_write(offset, n_written);
+        return n_written;
+    });
+}
+
+int32_t Disk::read_blocks(const std::vector<BlockReadVec>& blocks) {
+    if (!(disk_img && is_mounted())) {
         return -1;
     }
 
-    int32_t offset = block_n * block_size;
-    int32_t data_overflow = std::min(0, disk_img_size - (offset + data_len));
-    data_len -= std::abs(data_overflow);
+    for (auto& block : blocks) {
+        if (block.block_n < 0 || block.block_n >= get_disk_size()) {
+            return -1;
+        }
+    }
+
+    return transfer_scattered(blocks, block_size, [this](int64_t offset, const iovec* iov, int32_t n_iov) {
+        int32_t n_read = disk_img->readv(offset, iov, n_iov);
+        account_read(offset, n_read);
+        return n_read;
+    });
+}
+
+void Disk::start_async(int32_t queue_depth, AsyncEngine engine) {
+    if (!disk_img) {
+        throw std::runtime_error("Image not opened.");
+    }
+
+    io_queue.reset();
+    io_queue = IoQueue::make(*disk_img, queue_depth, engine);
+}
+
+std::future<int32_t> Disk::submit_async(IoType type, int32_t block_n, uint8_t* data, int32_t data_len,
+                                        IoCallback callback) {
+    if (!(disk_img && is_mounted()) || block_n < 0 || block_n >= get_disk_size()) {
+        std::promise<int32_t> failed;
+        failed.set_value(-1);
+        if (callback) {
+            callback(-1);
+        }
+        return failed.get_future();
+    }
+
+    if (!io_queue) {
+        start_async();
+    }
+
+    int64_t offset = static_cast<int64_t>(block_n) * block_size;
+    data_len = clip_length(offset, data_len);
 
-    disk_img.seekg(offset, disk_img.beg);
-    disk_img.read(reinterpret_cast<char*>(data_block), data_len);
+    // Only the bytes actually moved are charged, once the request completes
+    IoCallback accounted = [this, type, offset, callback = std::move(callback)](int32_t result) {
+        type == IoType::Read ? account_read(offset, result) : account_write(offset, result);
+        if (callback) {
+            callback(result);
+        }
+    };
+
+    return io_queue->submit({type, offset, data, data_len, std::move(accounted)});
+}
 
-    return data_len;
+std::future<int32_t> Disk::write_async(int32_t block_n, const uint8_t* data_block, int32_t data_len,
+                                       IoCallback callback) {
+    return submit_async(IoType::Write, block_n, const_cast<uint8_t*>(data_block), data_len, std::move(callback));
+}
+
+std::future<int32_t> Disk::read_async(int32_t block_n, uint8_t* data_block, int32_t data_len, IoCallback callback) {
+    return submit_async(IoType::Read, block_n, data_block, data_len, std::move(callback));
+}
+
+void Disk::wait_async() {
+    if (io_queue) {
+        io_queue->drain();
+    }
+}
+
+AsyncEngine Disk::get_async_engine() const {
+    if (!io_queue) {
+        throw std::runtime_error("Async I/O not started.");
+    }
+
+    return io_queue->engine();
+}
+
+void Disk::set_timing(const NandTiming& timing) {
+    if (!disk_img) {
+        throw std::runtime_error("Image not opened.");
+    }
+
+    wait_async();
+    timing_model = std::make_unique<NandTimingModel>(timing, block_size, get_disk_size());
+}
+
+void Disk::reset_io_stats() {
+    if (io_stats) {
+        io_stats->reset();
+    }
+}
+
+uint8_t* Disk::map_block(int32_t block_n) {
+    if (!(disk_img && is_mounted()) || block_n < 0 || block_n >= get_disk_size()) {
+        return nullptr;
+    }
+
+    return disk_img->map(static_cast<int64_t>(block_n) * block_size);
+}
+
+void Disk::advise(DiskAccess access) {
+    if (disk_img) {
+        disk_img->advise(access);
+    }
+}
+
+void Disk::flush() {
+    if (disk_img) {
+        disk_img->flush();
+    }
+}
+
+void Disk::unmount() {
+    if (mounted == 0) {
+        return;
+    }
+
+    mounted--;
+    if (mounted == 0) {
+        wait_async();
+        flush();
+    }
 }
 }
\ No newline at end of file
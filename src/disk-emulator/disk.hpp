@@ -1,36 +1,92 @@
 #ifndef DISK_EMULATOR_DISK_HPP
 #define DISK_EMULATOR_DISK_HPP
-#include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "common/types.hpp"
+#include "disk_backend.hpp"
+#include "disk_stats.hpp"
+#include "io_queue.hpp"
+#include "nand_timing.hpp"
 namespace FSFS {
 constexpr int32_t quant_block_size = 1024;
+constexpr int32_t default_queue_depth = 64;
+
+struct BlockReadVec {
+    int32_t block_n;
+    uint8_t* data;
+};
+
+struct BlockWriteVec {
+    int32_t block_n;
+    const uint8_t* data;
+};
 
 class Disk {
    private:
     int32_t mounted;
     int32_t block_size;
-    int32_t disk_img_size;
-    std::fstream disk_img;
+    int64_t disk_img_size;
+    DiskMode mode;
+    std::unique_ptr<DiskBackend> disk_img;
+    std::unique_ptr<IoQueue> io_queue;
+    std::unique_ptr<NandTimingModel> timing_model;
+    std::unique_ptr<DiskStats> io_stats;
+
+    int32_t clip_length(int64_t offset, int32_t data_len) const;
+    // Byte length of a run of whole blocks on the disk, -1 when out of range or too long for int32_t
+    int32_t run_length(int32_t block_n, int32_t n_blocks) const;
+    void account_read(int64_t offset, int32_t data_len);
+    void account_write(int64_t offset, int32_t data_len);
+    std::future<int32_t> submit_async(IoType type, int32_t block_n, uint8_t* data, int32_t data_len,
+                                      IoCallback callback);
 
    public:
-    Disk(int32_t block_size);
+    Disk(int32_t block_size, DiskMode mode = DiskMode::Stream);
     ~Disk();
     void open(const char* path);
+    void open_ram(int32_t n_blocks);
+    void dump(const char* path);
     int32_t write(int32_t block_n, const uint8_t* data_block, int32_t data_len);
     int32_t read(int32_t block_n, uint8_t* data_block, int32_t data_len);
+    int32_t write_blocks(int32_t block_n, int32_t n_blocks, const uint8_t* data_blocks);
+    int32_t read_blocks(int32_t block_n, int32_t n_blocks, uint8_t* data_blocks);
+    int32_t write_blocks(const std::vector<BlockWriteVec>& blocks);
+    int32_t read_blocks(const std::vector<BlockReadVec>& blocks);
     int32_t get_block_size() const { return block_size; };
     int32_t get_disk_size() const { return (disk_img_size / block_size); };
+    int64_t get_disk_img_size() const { return disk_img_size; };
+    DiskMode get_mode() const { return mode; };
     static void create(const char* path, int32_t n_blocks, int32_t block_size);
+    static void create_striped(const char* path, const std::vector<std::string>& member_paths, int32_t n_blocks,
+                               int32_t block_size, int32_t stripe_unit);
+
+    void start_async(int32_t queue_depth = default_queue_depth, AsyncEngine engine = AsyncEngine::Uring);
+    std::future<int32_t> write_async(int32_t block_n, const uint8_t* data_block, int32_t data_len,
+                                     IoCallback callback = nullptr);
+    std::future<int32_t> read_async(int32_t block_n, uint8_t* data_block, int32_t data_len,
+                                    IoCallback callback = nullptr);
+    void wait_async();
+    AsyncEngine get_async_engine() const;
+
+    void set_timing(const NandTiming& timing);
+    void clear_timing() {
+        wait_async();
+        timing_model.reset();
+    };
+    const NandTimingModel* get_timing_model() const { return timing_model.get(); };
+
+    const DiskStats* get_io_stats() const { return io_stats.get(); };
+    void reset_io_stats();
+
+    uint8_t* map_block(int32_t block_n);
+    void advise(DiskAccess access);
+    void flush();
 
     bool is_mounted() const { return mounted; };
     void mount() { mounted++; };
-    void unmount() {
-        if (mounted > 0) {
-            mounted--;
-        }
-    };
+    void unmount();
 };
 
 }
@@ -0,0 +1,532 @@
+#include "disk_backend.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#include "striped_disk_backend.hpp"
+
+namespace FSFS {
+namespace {
+constexpr int64_t huge_page_size = 2 * 1024 * 1024;
+
+int64_t align_down(int64_t value) { return value & ~static_cast<int64_t>(io_alignment - 1); }
+int64_t align_up(int64_t value) { return align_down(value + io_alignment - 1); }
+
+int32_t pread_full(int fd, uint8_t* data, int32_t data_len, int64_t offset) {
+    int32_t n_read = 0;
+    while (n_read < data_len) {
+        auto n = ::pread(fd, data + n_read, data_len - n_read, offset + n_read);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        n_read += n;
+    }
+
+    return n_read;
+}
+
+int32_t pwrite_full(int fd, const uint8_t* data, int32_t data_len, int64_t offset) {
+    int32_t n_written = 0;
+    while (n_written < data_len) {
+        auto n = ::pwrite(fd, data + n_written, data_len - n_written, offset + n_written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        n_written += n;
+    }
+
+    return n_written;
+}
+
+template <typename Transfer>
+int32_t transfer_segments(int fd, const iovec* iov, int32_t n_iov, int64_t offset, Transfer transfer) {
+    int32_t n_transferred = 0;
+    for (int32_t i = 0; i < n_iov; i++) {
+        int32_t iov_len = iov[i].iov_len;
+        int32_t n = transfer(fd, static_cast<uint8_t*>(iov[i].iov_base), iov_len, offset + n_transferred);
+        n_transferred += n;
+        if (n != iov_len) {
+            break;
+        }
+    }
+
+    return n_transferred;
+}
+}
+
+std::unique_ptr<DiskBackend> DiskBackend::make(DiskMode mode) {
+    switch (mode) {
+        case DiskMode::Stream:
+            return std::make_unique<StreamDiskBackend>();
+        case DiskMode::Posix:
+            return std::make_unique<PosixDiskBackend>();
+        case DiskMode::Mmap:
+            return std::make_unique<MmapDiskBackend>();
+        case DiskMode::Direct:
+            return std::make_unique<DirectDiskBackend>();
+        case DiskMode::Ram:
+            return std::make_unique<RamDiskBackend>();
+        case DiskMode::Striped:
+            return std::make_unique<StripedDiskBackend>();
+        default:
+            throw std::invalid_argument("Unknown disk mode.");
+    }
+}
+
+int32_t DiskBackend::writev(int64_t offset, const iovec* iov, int32_t n_iov) {
+    int32_t n_written = 0;
+    for (int32_t i = 0; i < n_iov; i++) {
+        int32_t iov_len = iov[i].iov_len;
+        int32_t n = write(offset + n_written, static_cast<const uint8_t*>(iov[i].iov_base), iov_len);
+        n_written += n;
+        if (n != iov_len) {
+            break;
+        }
+    }
+
+    return n_written;
+}
+
+int32_t DiskBackend::readv(int64_t offset, const iovec* iov, int32_t n_iov) {
+    int32_t n_read = 0;
+    for (int32_t i = 0; i < n_iov; i++) {
+        int32_t iov_len = iov[i].iov_len;
+        int32_t n = read(offset + n_read, static_cast<uint8_t*>(iov[i].iov_base), iov_len);
+        n_read += n;
+        if (n != iov_len) {
+            break;
+        }
+    }
+
+    return n_read;
+}
+
+StreamDiskBackend::~StreamDiskBackend() { disk_img.close(); }
+
+void StreamDiskBackend::open(const char* path) {
+    disk_img.open(path, std::ios::out | std::ios::in | std::ios::binary);
+    if (!disk_img.is_open()) {
+        throw std::runtime_error("Cannot open image.");
+    }
+}
+
+int64_t StreamDiskBackend::size() {
+    std::scoped_lock lck(mtx);
+    disk_img.seekg(0, std::ios::end);
+    return disk_img.tellg();
+}
+
+int32_t StreamDiskBackend::write(int64_t offset, const uint8_t* data, int32_t data_len) {
+    std::scoped_lock lck(mtx);
+    disk_img.seekp(offset, disk_img.beg);
+    disk_img.write(reinterpret_cast<const char*>(data), data_len);
+
+    return data_len;
+}
+
+int32_t StreamDiskBackend::read(int64_t offset, uint8_t* data, int32_t data_len) {
+    std::scoped_lock lck(mtx);
+    disk_img.seekg(offset, disk_img.beg);
+    disk_img.read(reinterpret_cast<char*>(data), data_len);
+
+    return data_len;
+}
+
+void StreamDiskBackend::flush() {
+    std::scoped_lock lck(mtx);
+    disk_img.flush();
+}
+
+PosixDiskBackend::~PosixDiskBackend() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void PosixDiskBackend::open(const char* path) {
+    fd = ::open(path, O_RDWR);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open image.");
+    }
+}
+
+int64_t PosixDiskBackend::size() {
+    struct stat img_stat;
+    if (::fstat(fd, &img_stat) != 0) {
+        throw std::runtime_error("Cannot stat image.");
+    }
+
+    return img_stat.st_size;
+}
+
+int32_t PosixDiskBackend::write(int64_t offset, const uint8_t* data, int32_t data_len) {
+    return pwrite_full(fd, data, data_len, offset);
+}
+
+int32_t PosixDiskBackend::read(int64_t offset, uint8_t* data, int32_t data_len) {
+    return pread_full(fd, data, data_len, offset);
+}
+
+int32_t PosixDiskBackend::writev(int64_t offset, const iovec* iov, int32_t n_iov) {
+    int32_t n_written = 0;
+    for (int32_t i = 0; i < n_iov; i += IOV_MAX) {
+        int32_t n_chunk_iov = std::min(n_iov - i, IOV_MAX);
+        int32_t chunk_len = 0;
+        for (int32_t j = i; j < i + n_chunk_iov; j++) {
+            chunk_len += iov[j].iov_len;
+        }
+
+        auto n = ::pwritev(fd, &iov[i], n_chunk_iov, offset + n_written);
+        if (n < 0 && errno == EINTR) {
+            i -= IOV_MAX;
+            continue;
+        }
+        if (n != chunk_len) {
+            // Short transfer, finish the rest segment by segment
+            return n_written + transfer_segments(fd, &iov[i], n_iov - i, offset + n_written, pwrite_full);
+        }
+        n_written += n;
+    }
+
+    return n_written;
+}
+
+int32_t PosixDiskBackend::readv(int64_t offset, const iovec* iov, int32_t n_iov) {
+    int32_t n_read = 0;
+    for (int32_t i = 0; i < n_iov; i += IOV_MAX) {
+        int32_t n_chunk_iov = std::min(n_iov - i, IOV_MAX);
+        int32_t chunk_len = 0;
+        for (int32_t j = i; j < i + n_chunk_iov; j++) {
+            chunk_len += iov[j].iov_len;
+        }
+
+        auto n = ::preadv(fd, &iov[i], n_chunk_iov, offset + n_read);
+        if (n < 0 && errno == EINTR) {
+            i -= IOV_MAX;
+            continue;
+        }
+        if (n != chunk_len) {
+            // Short transfer, finish the rest segment by segment
+            return n_read + transfer_segments(fd, &iov[i], n_iov - i, offset + n_read, pread_full);
+        }
+        n_read += n;
+    }
+
+    return n_read;
+}
+
+DirectDiskBackend::~DirectDiskBackend() {
+    if (buffered_fd >= 0) {
+        ::close(buffered_fd);
+    }
+}
+
+void DirectDiskBackend::open(const char* path) {
+    buffered_fd = ::open(path, O_RDWR);
+    if (buffered_fd < 0) {
+        throw std::runtime_error("Cannot open image.");
+    }
+
+    fd = ::open(path, O_RDWR | O_DIRECT);
+    if (fd < 0) {
+        throw std::runtime_error("Image file system does not support direct I/O.");
+    }
+    direct_limit = align_down(size());
+}
+
+bool DirectDiskBackend::is_aligned(int64_t offset, const uint8_t* data, int32_t data_len) const {
+    return align_down(offset) == offset && align_down(data_len) == data_len &&
+           reinterpret_cast<uintptr_t>(data) % io_alignment == 0 && offset + data_len <= direct_limit;
+}
+
+int32_t DirectDiskBackend::transfer_bounced(int64_t offset, uint8_t* data, int32_t data_len, bool is_write) {
+    std::unique_lock lck(mtx);
+    int32_t n_transferred = 0;
+
+    // Step 1: Move the part inside aligned area of the image through the bounce buffer
+    //
+    int32_t direct_len = std::clamp<int64_t>(direct_limit - offset, 0, data_len);
+    if (direct_len > 0) {
+        int64_t span_start = align_down(offset);
+        int32_t span_len = align_up(offset + direct_len) - span_start;
+        int32_t span_offset = offset - span_start;
+        if (static_cast<int32_t>(bounce_buffer.size()) < span_len) {
+            bounce_buffer.resize(span_len);
+        }
+
+        bool is_partial_span = span_offset != 0 || direct_len != span_len;
+        if (!is_write || is_partial_span) {
+            if (pread_full(fd, bounce_buffer.data(), span_len, span_start) != span_len) {
+                return n_transferred;
+            }
+        }
+
+        if (is_write) {
+            std::memcpy(bounce_buffer.data() + span_offset, data, direct_len);
+            if (pwrite_full(fd, bounce_buffer.data(), span_len, span_start) != span_len) {
+                return n_transferred;
+            }
+        } else {
+            std::memcpy(data, bounce_buffer.data() + span_offset, direct_len);
+        }
+        n_transferred += direct_len;
+    }
+
+    // Step 2: Move the unaligned tail of the image through page cache
+    //
+    if (n_transferred < data_len) {
+        int32_t tail_len = data_len - n_transferred;
+        n_transferred += is_write ? pwrite_full(buffered_fd, data + n_transferred, tail_len, offset + n_transferred)
+                                  : pread_full(buffered_fd, data + n_transferred, tail_len, offset + n_transferred);
+    }
+
+    return n_transferred;
+}
+
+int32_t DirectDiskBackend::write(int64_t offset, const uint8_t* data, int32_t data_len) {
+    if (data_len <= 0) {
+        return 0;
+    }
+
+    if (is_aligned(offset, data, data_len)) {
+        std::shared_lock lck(mtx);
+        return PosixDiskBackend::write(offset, data, data_len);
+    }
+
+    return transfer_bounced(offset, const_cast<uint8_t*>(data), data_len, true);
+}
+
+int32_t DirectDiskBackend::read(int64_t offset, uint8_t* data, int32_t data_len) {
+    if (data_len <= 0) {
+        return 0;
+    }
+
+    if (is_aligned(offset, data, data_len)) {
+        std::shared_lock lck(mtx);
+        return PosixDiskBackend::read(offset, data, data_len);
+    }
+
+    return transfer_bounced(offset, data, data_len, false);
+}
+
+int32_t DirectDiskBackend::writev(int64_t offset, const iovec* iov, int32_t n_iov) {
+    int64_t iov_offset = offset;
+    for (int32_t i = 0; i < n_iov; i++) {
+        if (!is_aligned(iov_offset, static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len)) {
+            return DiskBackend::writev(offset, iov, n_iov);
+        }
+        iov_offset += iov[i].iov_len;
+    }
+
+    std::shared_lock lck(mtx);
+    return PosixDiskBackend::writev(offset, iov, n_iov);
+}
+
+int32_t DirectDiskBackend::readv(int64_t offset, const iovec* iov, int32_t n_iov) {
+    int64_t iov_offset = offset;
+    for (int32_t i = 0; i < n_iov; i++) {
+        if (!is_aligned(iov_offset, static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len)) {
+            return DiskBackend::readv(offset, iov, n_iov);
+        }
+        iov_offset += iov[i].iov_len;
+    }
+
+    std::shared_lock lck(mtx);
+    return PosixDiskBackend::readv(offset, iov, n_iov);
+}
+
+MmapDiskBackend::~MmapDiskBackend() {
+    if (img_map != nullptr) {
+        ::msync(img_map, img_size, MS_SYNC);
+        ::munmap(img_map, img_size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void MmapDiskBackend::open(const char* path) {
+    fd = ::open(path, O_RDWR);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open image.");
+    }
+
+    struct stat img_stat;
+    if (::fstat(fd, &img_stat) != 0) {
+        throw std::runtime_error("Cannot stat image.");
+    }
+    img_size = img_stat.st_size;
+
+    if (img_size == 0) {
+        return;
+    }
+
+    void* mapping = ::mmap(nullptr, img_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map image.");
+    }
+    img_map = static_cast<uint8_t*>(mapping);
+}
+
+int32_t MmapDiskBackend::write(int64_t offset, const uint8_t* data, int32_t data_len) {
+    if (data_len <= 0) {
+        return 0;
+    }
+
+    if (img_map == nullptr || offset < 0 || offset + data_len > img_size) {
+        return -1;
+    }
+
+    std::memcpy(img_map + offset, data, data_len);
+    return data_len;
+}
+
+int32_t MmapDiskBackend::read(int64_t offset, uint8_t* data, int32_t data_len) {
+    if (data_len <= 0) {
+        return 0;
+    }
+
+    if (img_map == nullptr || offset < 0 || offset + data_len > img_size) {
+        return -1;
+    }
+
+    std::memcpy(data, img_map + offset, data_len);
+    return data_len;
+}
+
+uint8_t* MmapDiskBackend::map(int64_t offset) {
+    if (img_map == nullptr || offset < 0 || offset >= img_size) {
+        return nullptr;
+    }
+
+    return img_map + offset;
+}
+
+void MmapDiskBackend::advise(DiskAccess access) {
+    if (img_map == nullptr) {
+        return;
+    }
+
+    int advice = MADV_NORMAL;
+    switch (access) {
+        case DiskAccess::Sequential:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case DiskAccess::Random:
+            advice = MADV_RANDOM;
+            break;
+        case DiskAccess::Normal:
+        default:
+            break;
+    }
+    ::madvise(img_map, img_size, advice);
+}
+
+void MmapDiskBackend::flush() {
+    if (img_map == nullptr) {
+        return;
+    }
+
+    if (::msync(img_map, img_size, MS_SYNC) != 0) {
+        throw std::runtime_error("Cannot flush image.");
+    }
+}
+
+RamDiskBackend::~RamDiskBackend() {
+    if (img_mem != nullptr) {
+        ::munmap(img_mem, img_size);
+    }
+}
+
+void RamDiskBackend::allocate(int64_t size) {
+    img_size = size;
+    if (img_size == 0) {
+        return;
+    }
+
+    void* mapping = ::mmap(nullptr, img_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot allocate RAM image.");
+    }
+    img_mem = static_cast<uint8_t*>(mapping);
+
+    if (img_size >= huge_page_size) {
+        ::madvise(img_mem, img_size, MADV_HUGEPAGE);
+    }
+}
+
+void RamDiskBackend::open(const char* path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open image.");
+    }
+
+    struct stat img_stat;
+    if (::fstat(fd, &img_stat) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat image.");
+    }
+
+    allocate(img_stat.st_size);
+    for (int64_t offset = 0; offset < img_size;) {
+        int32_t chunk_len = std::min<int64_t>(img_size - offset, huge_page_size);
+        int32_t n_read = pread_full(fd, img_mem + offset, chunk_len, offset);
+        if (n_read != chunk_len) {
+            ::close(fd);
+            throw std::runtime_error("Cannot load image.");
+        }
+        offset += n_read;
+    }
+    ::close(fd);
+}
+
+void RamDiskBackend::open_empty(int64_t size) { allocate(size); }
+
+int32_t RamDiskBackend::write(int64_t offset, const uint8_t* data, int32_t data_len) {
+    if (data_len <= 0) {
+        return 0;
+    }
+
+    if (img_mem == nullptr || offset < 0 || offset + data_len > img_size) {
+        return -1;
+    }
+
+    std::memcpy(img_mem + offset, data, data_len);
+    return data_len;
+}
+
+int32_t RamDiskBackend::read(int64_t offset, uint8_t* data, int32_t data_len) {
+    if (data_len <= 0) {
+        return 0;
+    }
+
+    if (img_mem == nullptr || offset < 0 || offset + data_len > img_size) {
+        return -1;
+    }
+
+    std::memcpy(data, img_mem + offset, data_len);
+    return data_len;
+}
+
+uint8_t* RamDiskBackend::map(int64_t offset) {
+    if (img_mem == nullptr || offset < 0 || offset >= img_size) {
+        return nullptr;
+    }
+
+    return img_mem + offset;
+}
+}
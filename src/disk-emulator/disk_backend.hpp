@@ -0,0 +1,140 @@
+#ifndef DISK_EMULATOR_DISK_BACKEND_HPP
+#define DISK_EMULATOR_DISK_BACKEND_HPP
+#include <sys/uio.h>
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include "common/aligned_allocator.hpp"
+#include "common/types.hpp"
+namespace FSFS {
+enum class DiskMode { Stream, Posix, Mmap, Direct, Ram, Striped };
+enum class DiskAccess { Normal, Sequential, Random };
+
+class DiskBackend {
+   public:
+    virtual ~DiskBackend() = default;
+
+    virtual void open(const char* path) = 0;
+    virtual int64_t size() = 0;
+    virtual int32_t write(int64_t offset, const uint8_t* data, int32_t data_len) = 0;
+    virtual int32_t read(int64_t offset, uint8_t* data, int32_t data_len) = 0;
+    virtual int32_t writev(int64_t offset, const iovec* iov, int32_t n_iov);
+    virtual int32_t readv(int64_t offset, const iovec* iov, int32_t n_iov);
+
+    virtual int native_handle() const { return -1; };
+    virtual uint8_t* map(int64_t) { return nullptr; };
+    virtual void advise(DiskAccess){};
+    virtual void flush(){};
+
+    static std::unique_ptr<DiskBackend> make(DiskMode mode);
+};
+
+// Stream position is shared, all accesses are serialized.
+class StreamDiskBackend : public DiskBackend {
+   private:
+    std::fstream disk_img;
+    std::mutex mtx;
+
+   public:
+    ~StreamDiskBackend() override;
+
+    void open(const char* path) override;
+    int64_t size() override;
+    int32_t write(int64_t offset, const uint8_t* data, int32_t data_len) override;
+    int32_t read(int64_t offset, uint8_t* data, int32_t data_len) override;
+    void flush() override;
+};
+
+// Positional I/O on a raw file descriptor. Does not share any stream position
+// so read and write can be called from several threads at once.
+class PosixDiskBackend : public DiskBackend {
+   protected:
+    int fd;
+
+   public:
+    PosixDiskBackend() : fd(-1){};
+    ~PosixDiskBackend() override;
+
+    void open(const char* path) override;
+    int64_t size() override;
+    int32_t write(int64_t offset, const uint8_t* data, int32_t data_len) override;
+    int32_t read(int64_t offset, uint8_t* data, int32_t data_len) override;
+    int32_t writev(int64_t offset, const iovec* iov, int32_t n_iov) override;
+    int32_t readv(int64_t offset, const iovec* iov, int32_t n_iov) override;
+    int native_handle() const override { return fd; };
+};
+
+// Bypasses the host page cache with O_DIRECT. Requests that are not aligned to
+// io_alignment (offset, length or buffer) go through an aligned bounce buffer,
+// writes smaller than an aligned span are read-modify-write. The unaligned tail
+// of the image is accessed through a second, buffered descriptor.
+class DirectDiskBackend : public PosixDiskBackend {
+   private:
+    int buffered_fd;
+    int64_t direct_limit;
+    AlignedBuffer bounce_buffer;
+    std::shared_mutex mtx;
+
+    bool is_aligned(int64_t offset, const uint8_t* data, int32_t data_len) const;
+    int32_t transfer_bounced(int64_t offset, uint8_t* data, int32_t data_len, bool is_write);
+
+   public:
+    DirectDiskBackend() : buffered_fd(-1), direct_limit(0){};
+    ~DirectDiskBackend() override;
+
+    void open(const char* path) override;
+    int32_t write(int64_t offset, const uint8_t* data, int32_t data_len) override;
+    int32_t read(int64_t offset, uint8_t* data, int32_t data_len) override;
+    int32_t writev(int64_t offset, const iovec* iov, int32_t n_iov) override;
+    int32_t readv(int64_t offset, const iovec* iov, int32_t n_iov) override;
+    int native_handle() const override { return -1; };
+};
+
+// Whole image mapped once on open, reads and writes become plain memory copies.
+// Dirty pages are written back to the image on flush. A range outside the image fails with -1.
+class MmapDiskBackend : public DiskBackend {
+   private:
+    int fd;
+    uint8_t* img_map;
+    int64_t img_size;
+
+   public:
+    MmapDiskBackend() : fd(-1), img_map(nullptr), img_size(0){};
+    ~MmapDiskBackend() override;
+
+    void open(const char* path) override;
+    int64_t size() override { return img_size; };
+    int32_t write(int64_t offset, const uint8_t* data, int32_t data_len) override;
+    int32_t read(int64_t offset, uint8_t* data, int32_t data_len) override;
+
+    uint8_t* map(int64_t offset) override;
+    void advise(DiskAccess access) override;
+    void flush() override;
+};
+
+// Image kept in anonymous memory (transparent huge pages when large enough),
+// either loaded from an image file or created empty without any file. A range outside
+// the image fails with -1.
+class RamDiskBackend : public DiskBackend {
+   private:
+    uint8_t* img_mem;
+    int64_t img_size;
+
+    void allocate(int64_t size);
+
+   public:
+    RamDiskBackend() : img_mem(nullptr), img_size(0){};
+    ~RamDiskBackend() override;
+
+    void open(const char* path) override;
+    void open_empty(int64_t size);
+    int64_t size() override { return img_size; };
+    int32_t write(int64_t offset, const uint8_t* data, int32_t data_len) override;
+    int32_t read(int64_t offset, uint8_t* data, int32_t data_len) override;
+    uint8_t* map(int64_t offset) override;
+};
+}
+#endif
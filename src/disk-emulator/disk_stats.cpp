@@ -0,0 +1,125 @@
+#include "disk_stats.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace FSFS {
+namespace {
+constexpr auto counter_order = std::memory_order_relaxed;
+
+// Bucket 0 holds blocks never written, bucket k blocks written [2^(k-1), 2^k) times.
+int32_t histogram_bucket(uint32_t n_writes) { return n_writes == 0 ? 0 : 32 - __builtin_clz(n_writes); }
+}
+
+DiskStats::DiskStats(int32_t block_size, int32_t n_blocks)
+    : block_size(block_size), block_reads(n_blocks), block_writes(n_blocks) {
+    reset();
+}
+
+int64_t DiskStats::record(int64_t offset, int32_t data_len, BlockCounters& block_counters) {
+    int64_t first_block_n = offset / block_size;
+    int64_t last_block_n = (offset + data_len - 1) / block_size;
+
+    int64_t prev_next_block_n = next_block_n.exchange(last_block_n + 1, counter_order);
+    if (prev_next_block_n != first_block_n) {
+        n_seeks.fetch_add(1, counter_order);
+        seek_distance.fetch_add(std::abs(first_block_n - prev_next_block_n), counter_order);
+    }
+
+    for (int64_t block_n = first_block_n; block_n <= last_block_n; block_n++) {
+        block_counters[block_n].fetch_add(1, counter_order);
+    }
+
+    return last_block_n - first_block_n + 1;
+}
+
+void DiskStats::record_read(int64_t offset, int32_t data_len) {
+    if (data_len <= 0) {
+        return;
+    }
+
+    n_reads.fetch_add(1, counter_order);
+    bytes_read.fetch_add(data_len, counter_order);
+    n_blocks_read.fetch_add(record(offset, data_len, block_reads), counter_order);
+}
+
+void DiskStats::record_write(int64_t offset, int32_t data_len) {
+    if (data_len <= 0) {
+        return;
+    }
+
+    n_writes.fetch_add(1, counter_order);
+    bytes_written.fetch_add(data_len, counter_order);
+    n_blocks_written.fetch_add(record(offset, data_len, block_writes), counter_order);
+}
+
+uint32_t DiskStats::get_block_reads(int32_t block_n) const {
+    if (block_n < 0 || block_n >= get_n_blocks()) {
+        throw std::invalid_argument("Block out of range.");
+    }
+
+    return block_reads[block_n].load(counter_order);
+}
+
+uint32_t DiskStats::get_block_writes(int32_t block_n) const {
+    if (block_n < 0 || block_n >= get_n_blocks()) {
+        throw std::invalid_argument("Block out of range.");
+    }
+
+    return block_writes[block_n].load(counter_order);
+}
+
+DiskIoTotals DiskStats::get_totals() const {
+    return {n_reads.load(counter_order),       n_writes.load(counter_order),      n_blocks_read.load(counter_order),
+            n_blocks_written.load(counter_order), bytes_read.load(counter_order),   bytes_written.load(counter_order),
+            n_seeks.load(counter_order),        seek_distance.load(counter_order)};
+}
+
+std::vector<int32_t> DiskStats::get_write_histogram() const {
+    std::vector<int32_t> histogram(1, 0);
+    for (auto& n_writes : block_writes) {
+        int32_t bucket = histogram_bucket(n_writes.load(counter_order));
+        if (bucket >= static_cast<int32_t>(histogram.size())) {
+            histogram.resize(bucket + 1, 0);
+        }
+        histogram[bucket]++;
+    }
+
+    return histogram;
+}
+
+void DiskStats::dump_csv(const char* path) const {
+    std::ofstream csv(path, std::ios::out | std::ios::trunc);
+    if (!csv.is_open()) {
+        throw std::runtime_error("Cannot create stats file.");
+    }
+
+    csv << "block,reads,writes\n";
+    for (int32_t block_n = 0; block_n < get_n_blocks(); block_n++) {
+        csv << block_n << ',' << block_reads[block_n].load(counter_order) << ','
+            << block_writes[block_n].load(counter_order) << '\n';
+    }
+
+    if (!csv.good()) {
+        throw std::runtime_error("Cannot write stats file.");
+    }
+}
+
+void DiskStats::reset() {
+    for (int32_t block_n = 0; block_n < get_n_blocks(); block_n++) {
+        block_reads[block_n].store(0, counter_order);
+        block_writes[block_n].store(0, counter_order);
+    }
+
+    n_reads = 0;
+    n_writes = 0;
+    n_blocks_read = 0;
+    n_blocks_written = 0;
+    bytes_read = 0;
+    bytes_written = 0;
+    n_seeks = 0;
+    seek_distance = 0;
+    next_block_n = 0;
+}
+}
@@ -0,0 +1,57 @@
+#ifndef DISK_EMULATOR_DISK_STATS_HPP
+#define DISK_EMULATOR_DISK_STATS_HPP
+#include <atomic>
+#include <vector>
+
+#include "common/types.hpp"
+namespace FSFS {
+struct DiskIoTotals {
+    int64_t n_reads;
+    int64_t n_writes;
+    int64_t n_blocks_read;
+    int64_t n_blocks_written;
+    int64_t bytes_read;
+    int64_t bytes_written;
+    int64_t n_seeks;
+    int64_t seek_distance;
+};
+
+// Per-block access and wear counters. A request touching several blocks counts
+// once in the totals and once for each block. An access that does not start at
+// the block following the previous one is a seek, its distance is in blocks.
+class DiskStats {
+   private:
+    using BlockCounters = std::vector<std::atomic<uint32_t>>;
+
+    int32_t block_size;
+    BlockCounters block_reads;
+    BlockCounters block_writes;
+
+    std::atomic<int64_t> n_reads;
+    std::atomic<int64_t> n_writes;
+    std::atomic<int64_t> n_blocks_read;
+    std::atomic<int64_t> n_blocks_written;
+    std::atomic<int64_t> bytes_read;
+    std::atomic<int64_t> bytes_written;
+    std::atomic<int64_t> n_seeks;
+    std::atomic<int64_t> seek_distance;
+    std::atomic<int64_t> next_block_n;
+
+    int64_t record(int64_t offset, int32_t data_len, BlockCounters& block_counters);
+
+   public:
+    DiskStats(int32_t block_size, int32_t n_blocks);
+
+    void record_read(int64_t offset, int32_t data_len);
+    void record_write(int64_t offset, int32_t data_len);
+
+    int32_t get_n_blocks() const { return block_writes.size(); };
+    uint32_t get_block_reads(int32_t block_n) const;
+    uint32_t get_block_writes(int32_t block_n) const;
+    DiskIoTotals get_totals() const;
+    std::vector<int32_t> get_write_histogram() const;
+    void dump_csv(const char* path) const;
+    void reset();
+};
+}
+#endif
@@ -0,0 +1,419 @@
+#include "io_queue.hpp"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace FSFS {
+namespace {
+constexpr uint64_t uring_exit_token = UINT64_MAX;
+
+int uring_setup(uint32_t entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(int ring_fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+template <typename T>
+T* ring_field(uint8_t* ring, uint32_t offset) {
+    return reinterpret_cast<T*>(ring + offset);
+}
+
+// Set while a completion callback runs, a submit from there must not block on a full queue
+thread_local bool in_callback = false;
+
+void complete(IoCallback& callback, std::promise<int32_t>& completion, int32_t result) {
+    // Callback may complete another request itself, the outer flag is restored
+    bool outer_in_callback = in_callback;
+    try {
+        if (callback) {
+            in_callback = true;
+            callback(result);
+            in_callback = outer_in_callback;
+        }
+        completion.set_value(result);
+    } catch (...) {
+        in_callback = outer_in_callback;
+        completion.set_exception(std::current_exception());
+    }
+}
+}
+
+std::unique_ptr<IoQueue> IoQueue::make(DiskBackend& backend, int32_t queue_depth, AsyncEngine engine) {
+    if (queue_depth <= 0) {
+        throw std::invalid_argument("Queue depth must be greater than 0.");
+    }
+
+    if (engine == AsyncEngine::Uring && backend.native_handle() >= 0) {
+        try {
+            return std::make_unique<UringIoQueue>(backend.native_handle(), queue_depth);
+        } catch (const std::runtime_error&) {
+            // Kernel without io_uring or syscall not permitted, use worker threads instead
+        }
+    }
+
+    int32_t n_workers = std::clamp<int32_t>(std::thread::hardware_concurrency(), 2, queue_depth);
+    return std::make_unique<ThreadPoolIoQueue>(backend, queue_depth, n_workers);
+}
+
+ThreadPoolIoQueue::ThreadPoolIoQueue(DiskBackend& backend, int32_t queue_depth, int32_t n_workers)
+    : backend(backend), queue_depth(queue_depth), n_in_flight(0), stopping(false) {
+    for (int32_t i = 0; i < n_workers; i++) {
+        workers.emplace_back(&ThreadPoolIoQueue::worker_loop, this);
+    }
+}
+
+ThreadPoolIoQueue::~ThreadPoolIoQueue() {
+    drain();
+    {
+        std::scoped_lock lck(mtx);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::future<int32_t> ThreadPoolIoQueue::submit(IoRequest request) {
+    std::unique_lock lck(mtx);
+    // Waiting in a callback could hold every worker, the queue goes over its depth instead
+    if (!in_callback) {
+        job_done.wait(lck, [this]() { return n_in_flight < queue_depth; });
+    }
+
+    jobs.push_back({std::move(request), std::promise<int32_t>()});
+    auto completion = jobs.back().completion.get_future();
+    n_in_flight++;
+    lck.unlock();
+
+    job_ready.notify_one();
+    return completion;
+}
+
+void ThreadPoolIoQueue::drain() {
+    std::unique_lock lck(mtx);
+    job_done.wait(lck, [this]() { return n_in_flight == 0; });
+}
+
+void ThreadPoolIoQueue::worker_loop() {
+    while (true) {
+        std::unique_lock lck(mtx);
+        job_ready.wait(lck, [this]() { return stopping || !jobs.empty(); });
+        if (jobs.empty()) {
+            return;
+        }
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        lck.unlock();
+
+        auto& request = job.request;
+        int32_t result = request.type == IoType::Read
+                             ? backend.read(request.offset, request.data, request.data_len)
+                             : backend.write(request.offset, request.data, request.data_len);
+        complete(request.callback, job.completion, result);
+
+        lck.lock();
+        n_in_flight--;
+        lck.unlock();
+        job_done.notify_all();
+    }
+}
+
+UringIoQueue::UringIoQueue(int file_fd, int32_t queue_depth)
+    : ring_fd(-1),
+      file_fd(file_fd),
+      queue_depth(queue_depth),
+      sq_ring(nullptr),
+      sq_ring_size(0),
+      cq_ring(nullptr),
+      cq_ring_size(0),
+      sqes(nullptr),
+      sqes_size(0),
+      slots(queue_depth),
+      failed(false) {
+    // Step 1: Create ring and map submission/completion queues
+    //
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd = uring_setup(queue_depth, &params);
+    if (ring_fd < 0) {
+        throw std::runtime_error("Cannot setup io_uring.");
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    void* mapping = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                           IORING_OFF_SQ_RING);
+    if (mapping == MAP_FAILED) {
+        release();
+        throw std::runtime_error("Cannot map io_uring submission queue.");
+    }
+    sq_ring = static_cast<uint8_t*>(mapping);
+
+    if (single_mmap) {
+        cq_ring = sq_ring;
+    } else {
+        mapping = ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                         IORING_OFF_CQ_RING);
+        if (mapping == MAP_FAILED) {
+            release();
+            throw std::runtime_error("Cannot map io_uring completion queue.");
+        }
+        cq_ring = static_cast<uint8_t*>(mapping);
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    mapping = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (mapping == MAP_FAILED) {
+        release();
+        throw std::runtime_error("Cannot map io_uring submission entries.");
+    }
+    sqes = static_cast<io_uring_sqe*>(mapping);
+
+    sq_head = ring_field<uint32_t>(sq_ring, params.sq_off.head);
+    sq_tail = ring_field<uint32_t>(sq_ring, params.sq_off.tail);
+    sq_mask = ring_field<uint32_t>(sq_ring, params.sq_off.ring_mask);
+    sq_array = ring_field<uint32_t>(sq_ring, params.sq_off.array);
+    cq_head = ring_field<uint32_t>(cq_ring, params.cq_off.head);
+    cq_tail = ring_field<uint32_t>(cq_ring, params.cq_off.tail);
+    cq_mask = ring_field<uint32_t>(cq_ring, params.cq_off.ring_mask);
+    cqes = ring_field<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+
+    // Step 2: Prepare request slots and start reaping completions
+    //
+    for (int32_t slot_n = queue_depth - 1; slot_n >= 0; slot_n--) {
+        slots[slot_n].busy = false;
+        free_slots.push_back(slot_n);
+    }
+    reaper = std::thread(&UringIoQueue::reaper_loop, this);
+}
+
+UringIoQueue::~UringIoQueue() {
+    drain();
+    {
+        // Reaper has already stopped when the ring failed
+        std::scoped_lock lck(mtx);
+        if (!failed) {
+            push_sqe(IORING_OP_NOP, uring_exit_token, nullptr, 0);
+        }
+    }
+    reaper.join();
+    release();
+}
+
+void UringIoQueue::release() {
+    if (sqes != nullptr) {
+        ::munmap(sqes, sqes_size);
+    }
+    if (cq_ring != nullptr && cq_ring != sq_ring) {
+        ::munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != nullptr) {
+        ::munmap(sq_ring, sq_ring_size);
+    }
+    if (ring_fd >= 0) {
+        ::close(ring_fd);
+    }
+}
+
+void UringIoQueue::push_sqe(uint8_t opcode, uint64_t user_data, const iovec* iov, int64_t offset) {
+    // Submissions are serialized by mtx, the kernel only moves the head
+    uint32_t tail = *sq_tail;
+    uint32_t index = tail & *sq_mask;
+
+    io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->fd = file_fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = iov != nullptr ? 1 : 0;
+    sqe->user_data = user_data;
+    sq_array[index] = index;
+
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    while (uring_enter(ring_fd, 1, 0, 0) < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+            continue;
+        }
+        // Entry the kernel did not take is withdrawn, so the next enter does not submit it instead
+        if (__atomic_load_n(sq_head, __ATOMIC_ACQUIRE) != tail + 1) {
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+            throw std::runtime_error("Cannot submit io_uring request.");
+        }
+        break;
+    }
+}
+
+void UringIoQueue::push_request(int32_t slot_n) {
+    Slot& slot = slots[slot_n];
+    IoRequest& request = slot.request;
+    slot.iov.iov_base = request.data + slot.n_done;
+    slot.iov.iov_len = request.data_len - slot.n_done;
+
+    uint8_t opcode = request.type == IoType::Read ? IORING_OP_READV : IORING_OP_WRITEV;
+    push_sqe(opcode, slot_n, &slot.iov, request.offset + slot.n_done);
+}
+
+void UringIoQueue::start_request(int32_t slot_n, IoRequest request, std::promise<int32_t> completion) {
+    Slot& slot = slots[slot_n];
+    slot.request = std::move(request);
+    slot.completion = std::move(completion);
+    slot.n_done = 0;
+    slot.busy = true;
+    push_request(slot_n);
+}
+
+std::future<int32_t> UringIoQueue::submit(IoRequest request) {
+    std::unique_lock lck(mtx);
+    // Waiting in a callback would block the reaper that frees the slots
+    if (!in_callback) {
+        slot_freed.wait(lck, [this]() { return failed || !free_slots.empty(); });
+    }
+
+    std::promise<int32_t> completion;
+    auto result = completion.get_future();
+    if (failed) {
+        lck.unlock();
+        complete(request.callback, completion, -1);
+        return result;
+    }
+
+    if (free_slots.empty()) {
+        deferred.push_back({std::move(request), std::move(completion)});
+        return result;
+    }
+
+    int32_t slot_n = free_slots.back();
+    free_slots.pop_back();
+    try {
+        start_request(slot_n, std::move(request), std::move(completion));
+    } catch (const std::runtime_error&) {
+        // Request was never submitted, it fails alone and its slot is freed
+        Slot& slot = slots[slot_n];
+        IoCallback callback = std::move(slot.request.callback);
+        std::promise<int32_t> failed_completion = std::move(slot.completion);
+        slot.request.callback = nullptr;
+        slot.busy = false;
+        free_slots.push_back(slot_n);
+        lck.unlock();
+        slot_freed.notify_all();
+        complete(callback, failed_completion, -1);
+    }
+
+    return result;
+}
+
+void UringIoQueue::drain() {
+    std::unique_lock lck(mtx);
+    slot_freed.wait(lck, [this]() { return static_cast<int32_t>(free_slots.size()) == queue_depth; });
+}
+
+void UringIoQueue::reap(int32_t slot_n, int32_t res) {
+    Slot& slot = slots[slot_n];
+    IoRequest& request = slot.request;
+
+    // Step 1: Resubmit the rest of a short or interrupted transfer
+    //
+    bool retry = res == -EINTR || res == -EAGAIN;
+    if (res > 0) {
+        slot.n_done += res;
+        retry = slot.n_done < request.data_len;
+    }
+    if (retry) {
+        std::scoped_lock lck(mtx);
+        push_request(slot_n);
+        return;
+    }
+
+    // Step 2: Report the bytes moved, an error after some progress still reports them
+    //
+    int32_t result = slot.n_done > 0 || res == 0 ? slot.n_done : -1;
+    complete(request.callback, slot.completion, result);
+    request.callback = nullptr;
+
+    // Step 3: Hand the slot to the oldest deferred request or free it
+    //
+    std::scoped_lock lck(mtx);
+    if (deferred.empty()) {
+        slot.busy = false;
+        free_slots.push_back(slot_n);
+        slot_freed.notify_all();
+        return;
+    }
+
+    DeferredRequest next = std::move(deferred.front());
+    deferred.pop_front();
+    start_request(slot_n, std::move(next.request), std::move(next.completion));
+}
+
+// Kernel may still be moving data for the failed requests, nothing more can be reaped from the ring.
+void UringIoQueue::fail_all() {
+    std::unique_lock lck(mtx);
+    failed = true;
+    std::deque<DeferredRequest> failed_requests = std::move(deferred);
+    deferred.clear();
+    lck.unlock();
+
+    for (auto& slot : slots) {
+        if (slot.busy) {
+            complete(slot.request.callback, slot.completion, -1);
+            slot.request.callback = nullptr;
+        }
+    }
+    for (auto& failed_request : failed_requests) {
+        complete(failed_request.request.callback, failed_request.completion, -1);
+    }
+
+    lck.lock();
+    for (int32_t slot_n = 0; slot_n < queue_depth; slot_n++) {
+        if (slots[slot_n].busy) {
+            slots[slot_n].busy = false;
+            free_slots.push_back(slot_n);
+        }
+    }
+    slot_freed.notify_all();
+}
+
+void UringIoQueue::reaper_loop() {
+    bool exiting = false;
+    try {
+        while (!exiting) {
+            if (uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN) {
+                throw std::runtime_error("Cannot wait for io_uring completion.");
+            }
+
+            // Only this thread consumes completions
+            uint32_t head = *cq_head;
+            uint32_t tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++) {
+                const io_uring_cqe& cqe = cqes[head & *cq_mask];
+                if (cqe.user_data == uring_exit_token) {
+                    exiting = true;
+                    continue;
+                }
+                reap(static_cast<int32_t>(cqe.user_data), cqe.res);
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        }
+    } catch (const std::runtime_error&) {
+        // Errors cannot leave the reaper thread, they reach the submitters as failed requests
+        fail_all();
+    }
+}
+}
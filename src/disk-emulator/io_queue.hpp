@@ -0,0 +1,139 @@
+#ifndef DISK_EMULATOR_IO_QUEUE_HPP
+#define DISK_EMULATOR_IO_QUEUE_HPP
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/types.hpp"
+#include "disk_backend.hpp"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace FSFS {
+enum class IoType { Read, Write };
+enum class AsyncEngine { Uring, ThreadPool };
+
+using IoCallback = std::function<void(int32_t)>;
+
+struct IoRequest {
+    IoType type;
+    int64_t offset;
+    uint8_t* data;
+    int32_t data_len;
+    IoCallback callback;
+};
+
+// Keeps up to queue depth requests in flight. The completion result (number of
+// bytes moved or -1) is delivered to the callback first and then to the future,
+// an exception thrown by the callback is forwarded to the future. A submit from
+// a callback never waits for room in the queue.
+class IoQueue {
+   public:
+    virtual ~IoQueue() = default;
+
+    virtual std::future<int32_t> submit(IoRequest request) = 0;
+    virtual void drain() = 0;
+    virtual AsyncEngine engine() const = 0;
+
+    static std::unique_ptr<IoQueue> make(DiskBackend& backend, int32_t queue_depth, AsyncEngine engine);
+};
+
+class ThreadPoolIoQueue : public IoQueue {
+   private:
+    struct Job {
+        IoRequest request;
+        std::promise<int32_t> completion;
+    };
+
+    DiskBackend& backend;
+    int32_t queue_depth;
+    int32_t n_in_flight;
+    bool stopping;
+    std::deque<Job> jobs;
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable job_ready;
+    std::condition_variable job_done;
+
+    void worker_loop();
+
+   public:
+    ThreadPoolIoQueue(DiskBackend& backend, int32_t queue_depth, int32_t n_workers);
+    ~ThreadPoolIoQueue() override;
+
+    std::future<int32_t> submit(IoRequest request) override;
+    void drain() override;
+    AsyncEngine engine() const override { return AsyncEngine::ThreadPool; };
+};
+
+// io_uring driven directly through the raw syscalls, a single reaper thread
+// waits for completions. Short transfers are resubmitted for the remainder.
+// A request the ring refuses completes with -1. When the reaper fails, every
+// pending and later request completes with -1.
+class UringIoQueue : public IoQueue {
+   private:
+    struct Slot {
+        IoRequest request;
+        int32_t n_done;
+        bool busy;
+        iovec iov;
+        std::promise<int32_t> completion;
+    };
+
+    struct DeferredRequest {
+        IoRequest request;
+        std::promise<int32_t> completion;
+    };
+
+    int ring_fd;
+    int file_fd;
+    int32_t queue_depth;
+
+    uint8_t* sq_ring;
+    size_t sq_ring_size;
+    uint8_t* cq_ring;
+    size_t cq_ring_size;
+    io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_mask;
+    uint32_t* sq_array;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t* cq_mask;
+    io_uring_cqe* cqes;
+
+    std::vector<Slot> slots;
+    std::vector<int32_t> free_slots;
+    std::deque<DeferredRequest> deferred;
+    bool failed;
+    std::mutex mtx;
+    std::condition_variable slot_freed;
+    std::thread reaper;
+
+    void push_sqe(uint8_t opcode, uint64_t user_data, const iovec* iov, int64_t offset);
+    void push_request(int32_t slot_n);
+    void start_request(int32_t slot_n, IoRequest request, std::promise<int32_t> completion);
+    void reap(int32_t slot_n, int32_t res);
+    void fail_all();
+    void reaper_loop();
+    void release();
+
+   public:
+    UringIoQueue(int file_fd, int32_t queue_depth);
+    ~UringIoQueue() override;
+
+    std::future<int32_t> submit(IoRequest request) override;
+    void drain() override;
+    AsyncEngine engine() const override { return AsyncEngine::Uring; };
+};
+}
+#endif
@@ -0,0 +1,103 @@
+#include "nand_timing.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace FSFS {
+NandTimingModel::NandTimingModel(const NandTiming& timing, int32_t page_size, int32_t n_pages)
+    : timing(timing),
+      page_size(page_size),
+      programmed_pages(n_pages, false),
+      n_page_reads(0),
+      n_page_programs(0),
+      n_block_erases(0),
+      device_time_ns(0) {
+    if (timing.pages_per_erase_block <= 0) {
+        throw std::invalid_argument("Erase block must contain at least one page.");
+    }
+
+    if (timing.bus_bytes_per_sec <= 0) {
+        throw std::invalid_argument("Bus bandwidth must be greater than 0.");
+    }
+}
+
+std::chrono::nanoseconds NandTimingModel::transfer_time(int32_t n_bytes) const {
+    return std::chrono::nanoseconds(static_cast<int64_t>(n_bytes) * 1000 * 1000 * 1000 / timing.bus_bytes_per_sec);
+}
+
+void NandTimingModel::check_range(int64_t offset, int32_t data_len) const {
+    if (offset < 0 || (offset + data_len - 1) / page_size >= static_cast<int64_t>(programmed_pages.size())) {
+        throw std::invalid_argument("Access out of range.");
+    }
+}
+
+void NandTimingModel::charge(std::chrono::nanoseconds time) {
+    device_time_ns += time.count();
+    if (timing.mode == TimingMode::RealTime) {
+        std::this_thread::sleep_for(time);
+    }
+}
+
+void NandTimingModel::read(int64_t offset, int32_t data_len) {
+    if (data_len <= 0) {
+        return;
+    }
+    check_range(offset, data_len);
+
+    int64_t first_page = offset / page_size;
+    int64_t last_page = (offset + data_len - 1) / page_size;
+    int64_t n_pages = last_page - first_page + 1;
+
+    n_page_reads += n_pages;
+    charge(n_pages * timing.page_read + transfer_time(data_len));
+}
+
+void NandTimingModel::program(int64_t offset, int32_t data_len) {
+    if (data_len <= 0) {
+        return;
+    }
+    check_range(offset, data_len);
+
+    int64_t first_page = offset / page_size;
+    int64_t last_page = (offset + data_len - 1) / page_size;
+    std::chrono::nanoseconds time = transfer_time(data_len);
+
+    {
+        std::scoped_lock lck(mtx);
+        for (int64_t page_n = first_page; page_n <= last_page; page_n++) {
+            // Page cannot be reprogrammed without erasing the whole erase block
+            if (programmed_pages[page_n]) {
+                int64_t first_erased = page_n - page_n % timing.pages_per_erase_block;
+                int64_t last_erased =
+                    std::min<int64_t>(first_erased + timing.pages_per_erase_block, programmed_pages.size());
+                std::fill(programmed_pages.begin() + first_erased, programmed_pages.begin() + last_erased, false);
+
+                n_block_erases++;
+                time += timing.block_erase;
+            }
+
+            programmed_pages[page_n] = true;
+            n_page_programs++;
+            time += timing.page_program;
+        }
+    }
+
+    charge(time);
+}
+
+std::chrono::nanoseconds NandTimingModel::get_device_time() const { return std::chrono::nanoseconds(device_time_ns); }
+
+NandStats NandTimingModel::get_stats() const {
+    return {n_page_reads, n_page_programs, n_block_erases, get_device_time()};
+}
+
+void NandTimingModel::reset() {
+    std::scoped_lock lck(mtx);
+    std::fill(programmed_pages.begin(), programmed_pages.end(), false);
+    n_page_reads = 0;
+    n_page_programs = 0;
+    n_block_erases = 0;
+    device_time_ns = 0;
+}
+}
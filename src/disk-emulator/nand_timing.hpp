@@ -0,0 +1,66 @@
+#ifndef DISK_EMULATOR_NAND_TIMING_HPP
+#define DISK_EMULATOR_NAND_TIMING_HPP
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "common/types.hpp"
+namespace FSFS {
+enum class TimingMode { Virtual, RealTime };
+
+struct NandTiming {
+    std::chrono::nanoseconds page_read;
+    std::chrono::nanoseconds page_program;
+    std::chrono::nanoseconds block_erase;
+    int64_t bus_bytes_per_sec;
+    int32_t pages_per_erase_block;
+    TimingMode mode;
+};
+
+// Typical SLC NAND part on a 40 MB/s bus.
+constexpr NandTiming default_nand_timing = {std::chrono::microseconds(25), std::chrono::microseconds(200),
+                                            std::chrono::microseconds(1500), 40 * 1000 * 1000, 64,
+                                            TimingMode::Virtual};
+
+struct NandStats {
+    int64_t n_page_reads;
+    int64_t n_page_programs;
+    int64_t n_block_erases;
+    std::chrono::nanoseconds device_time;
+};
+
+// Charges device time for every access. One disk block is one flash page,
+// programming a page that was already programmed since the last erase costs
+// an erase of the whole erase block first. In virtual mode the time is only
+// accumulated, in real time mode the caller is also put to sleep for it. Pages outside
+// the device are rejected, nothing is charged for them.
+class NandTimingModel {
+   private:
+    NandTiming timing;
+    int32_t page_size;
+    std::vector<bool> programmed_pages;
+    std::mutex mtx;
+
+    std::atomic<int64_t> n_page_reads;
+    std::atomic<int64_t> n_page_programs;
+    std::atomic<int64_t> n_block_erases;
+    std::atomic<int64_t> device_time_ns;
+
+    std::chrono::nanoseconds transfer_time(int32_t n_bytes) const;
+    void check_range(int64_t offset, int32_t data_len) const;
+    void charge(std::chrono::nanoseconds time);
+
+   public:
+    NandTimingModel(const NandTiming& timing, int32_t page_size, int32_t n_pages);
+
+    void read(int64_t offset, int32_t data_len);
+    void program(int64_t offset, int32_t data_len);
+
+    const NandTiming& get_timing() const { return timing; };
+    std::chrono::nanoseconds get_device_time() const;
+    NandStats get_stats() const;
+    void reset();
+};
+}
+#endif
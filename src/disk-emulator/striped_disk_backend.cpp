@@ -0,0 +1,225 @@
+#include "striped_disk_backend.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace FSFS {
+std::string stripe_member_path(const char* stripe_set_path, const std::string& member_path) {
+    std::filesystem::path path(member_path);
+    if (path.is_absolute()) {
+        return member_path;
+    }
+    return (std::filesystem::path(stripe_set_path).parent_path() / path).string();
+}
+
+void StripedDiskBackend::open(const char* path) {
+    std::ifstream stripe_set(path);
+    if (!stripe_set.is_open()) {
+        throw std::runtime_error("Cannot open image.");
+    }
+
+    std::string magic;
+    std::getline(stripe_set, magic);
+    stripe_set >> stripe_unit;
+    if (magic != stripe_set_magic || !stripe_set.good() || stripe_unit <= 0) {
+        throw std::runtime_error("Invalid stripe set.");
+    }
+
+    std::string member_path;
+    std::getline(stripe_set, member_path);
+    while (std::getline(stripe_set, member_path)) {
+        if (member_path.empty()) {
+            continue;
+        }
+
+        auto member = DiskBackend::make(DiskMode::Posix);
+        member->open(stripe_member_path(path, member_path).c_str());
+        if (members.empty()) {
+            member_size = member->size();
+        }
+        if (member->size() != member_size || (member_size % stripe_unit) != 0) {
+            throw std::runtime_error("Stripe set members differ in size.");
+        }
+
+        members.push_back(std::move(member));
+    }
+
+    if (members.empty()) {
+        throw std::runtime_error("Invalid stripe set.");
+    }
+
+    member_transfers.resize(members.size());
+    for (int32_t member_n = 0; member_n < static_cast<int32_t>(members.size()); member_n++) {
+        workers.emplace_back(&StripedDiskBackend::worker_loop, this, member_n);
+    }
+}
+
+StripedDiskBackend::~StripedDiskBackend() {
+    {
+        std::lock_guard<std::mutex> lck(worker_mtx);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int32_t StripedDiskBackend::transfer_member(int32_t member_n) {
+    auto& member = *members[member_n];
+    auto& member_transfer = member_transfers[member_n];
+    int32_t n_member_iov = member_transfer.iov.size();
+    return is_write_transfer ? member.writev(member_transfer.offset, member_transfer.iov.data(), n_member_iov)
+                             : member.readv(member_transfer.offset, member_transfer.iov.data(), n_member_iov);
+}
+
+void StripedDiskBackend::worker_loop(int32_t member_n) {
+    auto& member_transfer = member_transfers[member_n];
+    std::unique_lock<std::mutex> lck(worker_mtx);
+    while (true) {
+        work_ready.wait(lck, [&] { return stopping || member_transfer.pending; });
+        if (stopping) {
+            return;
+        }
+
+        lck.unlock();
+        int32_t n_transferred = transfer_member(member_n);
+        lck.lock();
+
+        member_transfer.n_transferred = n_transferred;
+        member_transfer.pending = false;
+        if (--n_pending == 0) {
+            work_done.notify_all();
+        }
+    }
+}
+
+int32_t StripedDiskBackend::split_transfer(bool is_write, int64_t offset, const iovec* iov, int32_t n_iov) {
+    std::lock_guard<std::mutex> transfer_lck(transfer_mtx);
+
+    // Step 1: Split request at stripe unit boundaries, pieces of one member are
+    // consecutive in the member image
+    //
+    int32_t n_members = members.size();
+    for (auto& member_transfer : member_transfers) {
+        member_transfer.iov.clear();
+        member_transfer.n_transferred = 0;
+    }
+    pieces.clear();
+
+    int64_t piece_offset = offset;
+    for (int32_t i = 0; i < n_iov; i++) {
+        auto iov_data = static_cast<uint8_t*>(iov[i].iov_base);
+        int64_t iov_left = iov[i].iov_len;
+        while (iov_left > 0) {
+            int64_t stripe_n = piece_offset / stripe_unit;
+            int64_t stripe_offset = piece_offset % stripe_unit;
+            int64_t piece_len = std::min(iov_left, stripe_unit - stripe_offset);
+
+            int32_t member_n = stripe_n % n_members;
+            auto& member_transfer = member_transfers[member_n];
+            if (member_transfer.iov.empty()) {
+                member_transfer.offset = (stripe_n / n_members) * stripe_unit + stripe_offset;
+            }
+            member_transfer.iov.push_back({iov_data, static_cast<size_t>(piece_len)});
+            pieces.push_back({member_n, piece_len});
+
+            iov_data += piece_len;
+            iov_left -= piece_len;
+            piece_offset += piece_len;
+        }
+    }
+
+    // Step 2: Every touched member moves its pieces with a single vectored call. Member of the
+    // first piece is moved by the caller, the other ones by their workers
+    //
+    int32_t caller_member_n = pieces.front().member_n;
+    {
+        std::lock_guard<std::mutex> lck(worker_mtx);
+        is_write_transfer = is_write;
+        for (int32_t member_n = 0; member_n < n_members; member_n++) {
+            if (member_n != caller_member_n && !member_transfers[member_n].iov.empty()) {
+                member_transfers[member_n].pending = true;
+                n_pending++;
+            }
+        }
+    }
+    work_ready.notify_all();
+
+    member_transfers[caller_member_n].n_transferred = transfer_member(caller_member_n);
+    {
+        std::unique_lock<std::mutex> lck(worker_mtx);
+        work_done.wait(lck, [this] { return n_pending == 0; });
+    }
+
+    // Step 3: Bytes moved count up to the first piece a member did not move in full
+    //
+    int64_t n_transferred = 0;
+    for (auto& piece : pieces) {
+        auto& member_transfer = member_transfers[piece.member_n];
+        int64_t n_piece = std::clamp<int64_t>(member_transfer.n_transferred, 0, piece.len);
+        n_transferred += n_piece;
+        if (n_piece < piece.len) {
+            break;
+        }
+        member_transfer.n_transferred -= piece.len;
+    }
+
+    bool failed = std::any_of(member_transfers.begin(), member_transfers.end(),
+                              [](const MemberTransfer& member_transfer) { return member_transfer.n_transferred < 0; });
+    return n_transferred == 0 && failed ? -1 : n_transferred;
+}
+
+// Request within one stripe unit, or on a single member set, is consecutive in one member image.
+int32_t StripedDiskBackend::transfer(bool is_write, int64_t offset, const iovec* iov, int32_t n_iov) {
+    int64_t length = 0;
+    for (int32_t i = 0; i < n_iov; i++) {
+        length += iov[i].iov_len;
+    }
+    if (length == 0) {
+        return 0;
+    }
+
+    int32_t n_members = members.size();
+    int64_t stripe_n = offset / stripe_unit;
+    if (n_members == 1 || stripe_n == (offset + length - 1) / stripe_unit) {
+        auto& member = *members[stripe_n % n_members];
+        int64_t member_offset = (stripe_n / n_members) * stripe_unit + offset % stripe_unit;
+        return is_write ? member.writev(member_offset, iov, n_iov) : member.readv(member_offset, iov, n_iov);
+    }
+
+    return split_transfer(is_write, offset, iov, n_iov);
+}
+
+int32_t StripedDiskBackend::write(int64_t offset, const uint8_t* data, int32_t data_len) {
+    iovec iov = {const_cast<uint8_t*>(data), static_cast<size_t>(data_len)};
+    return transfer(true, offset, &iov, 1);
+}
+
+int32_t StripedDiskBackend::read(int64_t offset, uint8_t* data, int32_t data_len) {
+    iovec iov = {data, static_cast<size_t>(data_len)};
+    return transfer(false, offset, &iov, 1);
+}
+
+int32_t StripedDiskBackend::writev(int64_t offset, const iovec* iov, int32_t n_iov) {
+    return transfer(true, offset, iov, n_iov);
+}
+
+int32_t StripedDiskBackend::readv(int64_t offset, const iovec* iov, int32_t n_iov) {
+    return transfer(false, offset, iov, n_iov);
+}
+
+void StripedDiskBackend::advise(DiskAccess access) {
+    for (auto& member : members) {
+        member->advise(access);
+    }
+}
+
+void StripedDiskBackend::flush() {
+    for (auto& member : members) {
+        member->flush();
+    }
+}
+}
@@ -0,0 +1,78 @@
+#ifndef DISK_EMULATOR_STRIPED_DISK_BACKEND_HPP
+#define DISK_EMULATOR_STRIPED_DISK_BACKEND_HPP
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/types.hpp"
+#include "disk_backend.hpp"
+namespace FSFS {
+constexpr char stripe_set_magic[] = "fsfs-stripe-set";
+constexpr char stripe_set_extension[] = ".stripe";
+
+// Member path as opened, relative paths are taken from the directory of the stripe set description.
+std::string stripe_member_path(const char* stripe_set_path, const std::string& member_path);
+
+// RAID-0 style image striped across member images in round robin order of
+// stripe units. The image file is a stripe set description: magic, stripe unit
+// in bytes and one member image path per line. A request touching several
+// members is split and the members are accessed concurrently by workers started
+// with the stripe set. Split requests are served one at a time, a request
+// within one member goes to it right away.
+class StripedDiskBackend : public DiskBackend {
+   private:
+    struct MemberTransfer {
+        int64_t offset;
+        std::vector<iovec> iov;
+        int32_t n_transferred;
+        bool pending;
+    };
+
+    struct Piece {
+        int32_t member_n;
+        int64_t len;
+    };
+
+    int64_t stripe_unit;
+    int64_t member_size;
+    std::vector<std::unique_ptr<DiskBackend>> members;
+
+    // Lists keep their capacity, a split request allocates nothing once they grew to it
+    std::mutex transfer_mtx;
+    std::vector<MemberTransfer> member_transfers;
+    std::vector<Piece> pieces;
+    bool is_write_transfer;
+
+    std::vector<std::thread> workers;
+    std::mutex worker_mtx;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    int32_t n_pending;
+    bool stopping;
+
+    int32_t transfer_member(int32_t member_n);
+    void worker_loop(int32_t member_n);
+    int32_t split_transfer(bool is_write, int64_t offset, const iovec* iov, int32_t n_iov);
+    int32_t transfer(bool is_write, int64_t offset, const iovec* iov, int32_t n_iov);
+
+   public:
+    StripedDiskBackend() : stripe_unit(0), member_size(0), is_write_transfer(false), n_pending(0), stopping(false){};
+    ~StripedDiskBackend() override;
+
+    void open(const char* path) override;
+    int64_t size() override { return member_size * static_cast<int64_t>(members.size()); };
+    int32_t write(int64_t offset, const uint8_t* data, int32_t data_len) override;
+    int32_t read(int64_t offset, uint8_t* data, int32_t data_len) override;
+    int32_t writev(int64_t offset, const iovec* iov, int32_t n_iov) override;
+    int32_t readv(int64_t offset, const iovec* iov, int32_t n_iov) override;
+    void advise(DiskAccess access) override;
+    void flush() override;
+
+    int64_t get_stripe_unit() const { return stripe_unit; };
+    int32_t get_n_members() const { return members.size(); };
+};
+}
+#endif
@@ -0,0 +1,84 @@
+#include "alloc_policy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "block_bitmap.hpp"
+
+namespace FSFS {
+namespace {
+// Free block right past the file end is taken first, whatever the policy, so the file stays in one run.
+int32_t allocate_in_place(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) {
+    if (hint == fs_nullptr || hint >= bitmap.get_n_blocks() || bitmap.get_status(hint)) {
+        return 0;
+    }
+    return bitmap.allocate_run(1, max_len, hint, first_block_n);
+}
+}
+
+std::unique_ptr<BlockAllocator> BlockAllocator::make(AllocPolicy policy) {
+    switch (policy) {
+        case AllocPolicy::FirstFit:
+            return std::make_unique<FirstFitAllocator>();
+        case AllocPolicy::NextFit:
+            return std::make_unique<NextFitAllocator>();
+        case AllocPolicy::BestFit:
+            return std::make_unique<BestFitAllocator>();
+    }
+    throw std::invalid_argument("Unknown allocation policy.");
+}
+
+int32_t FirstFitAllocator::allocate(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) {
+    int32_t run_len = allocate_in_place(bitmap, max_len, hint, first_block_n);
+    if (run_len > 0) {
+        return run_len;
+    }
+
+    int32_t first_n = hint != fs_nullptr ? hint : 0;
+    run_len = bitmap.allocate_run(max_len, max_len, first_n, first_block_n);
+    return run_len ? run_len : bitmap.allocate_run(1, max_len, first_n, first_block_n);
+}
+
+int32_t NextFitAllocator::allocate(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) {
+    int32_t run_len = allocate_in_place(bitmap, max_len, hint, first_block_n);
+    if (run_len == 0) {
+        run_len = bitmap.allocate_run(max_len, max_len, cursor, first_block_n);
+    }
+    if (run_len == 0) {
+        run_len = bitmap.allocate_run(1, max_len, cursor, first_block_n);
+    }
+
+    if (run_len > 0) {
+        cursor = first_block_n + run_len;
+    }
+    return run_len;
+}
+
+// Shortest run holding max_len blocks, the longest one when none is long enough.
+int32_t BestFitAllocator::allocate(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) {
+    int32_t run_len = allocate_in_place(bitmap, max_len, hint, first_block_n);
+    if (run_len > 0) {
+        return run_len;
+    }
+
+    int32_t best_first_n = fs_nullptr;
+    int32_t best_len = 0;
+    int32_t first_n = fs_nullptr;
+    for (int32_t offset = 0; (run_len = bitmap.next_free_run(offset, first_n)) > 0; offset = first_n + run_len) {
+        bool is_better = best_len < max_len ? run_len > best_len : run_len >= max_len && run_len < best_len;
+        if (is_better) {
+            best_first_n = first_n;
+            best_len = run_len;
+        }
+        if (best_len == max_len) {
+            break;
+        }
+    }
+
+    if (best_len == 0) {
+        return 0;
+    }
+    best_len = std::min(best_len, max_len);
+    return bitmap.allocate_run(best_len, best_len, best_first_n, first_block_n);
+}
+}
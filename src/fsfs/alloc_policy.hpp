@@ -0,0 +1,54 @@
+#ifndef FSFS_ALLOC_POLICY_HPP
+#define FSFS_ALLOC_POLICY_HPP
+#include <memory>
+
+#include "common/types.hpp"
+#include "data_structs.hpp"
+
+namespace FSFS {
+class BlockBitmap;
+
+// Every policy first extends the file in place when the block right past its end is free.
+// FirstFit takes the lowest free run past the file end, or from the bitmap start. NextFit goes on
+// from where the last allocation ended, so new files do not all land in the low blocks. BestFit
+// takes the smallest free run the blocks fit in, leaving the long runs for big writes.
+enum class AllocPolicy { FirstFit, NextFit, BestFit };
+
+// Chooses the blocks of the next allocation and marks them in the bitmap. hint is the block
+// following the end of the file being extended, fs_nullptr when there is no such file.
+class BlockAllocator {
+   public:
+    virtual ~BlockAllocator() = default;
+
+    virtual void reset(){};
+    // Run of 1 to max_len blocks, all of them when a run that long is free. Returns the run length,
+    // 0 when every block is used.
+    virtual int32_t allocate(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) = 0;
+
+    static std::unique_ptr<BlockAllocator> make(AllocPolicy policy);
+};
+
+class FirstFitAllocator : public BlockAllocator {
+   public:
+    int32_t allocate(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) override;
+};
+
+// Cursor is moved past every run allocated and wraps at the bitmap end.
+class NextFitAllocator : public BlockAllocator {
+   private:
+    int32_t cursor;
+
+   public:
+    NextFitAllocator() : cursor(0){};
+
+    void reset() override { cursor = 0; };
+    int32_t allocate(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) override;
+};
+
+// Walks every free run of the bitmap, allocation time grows with the fragmentation.
+class BestFitAllocator : public BlockAllocator {
+   public:
+    int32_t allocate(BlockBitmap& bitmap, int32_t max_len, int32_t hint, int32_t& first_block_n) override;
+};
+}
+#endif
@@ -1,32 +1,123 @@
 #include "block.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 namespace FSFS {
-Block::Block(Disk& disk, const super_block& MB) : disk(disk), MB(MB) {
+Block::Block(Disk& disk, const super_block& MB, int32_t n_cache_entries)
+    : disk(disk), MB(MB), cache(n_cache_entries, MB.block_size), write_mode(WriteMode::WriteThrough),
+      dirty_limit(n_cache_entries) {
+    // Lists bounded by the cache size never grow past it, no allocation once the block is built
+    dirty_block_ns.reserve(n_cache_entries);
+    flush_vecs.reserve(n_cache_entries);
+    prefetch_vecs.reserve(n_cache_entries);
+    prefetch_entry_ns.reserve(n_cache_entries);
     disk.mount();
-    resize();
+    checksums.load(disk, MB);
 }
 
 void Block::resize() {
-    casched_block = fs_nullptr;
-    rwbuffer.resize(MB.block_size);
+    flush();
+    cache.resize(cache.get_n_entries(), MB.block_size);
+    checksums.load(disk, MB);
 }
 
-Block::~Block() { disk.unmount(); }
+// Super block and bitmaps are written past the cache and never checksummed, the table is rebuilt from the inodes on.
+void Block::rebuild_checksums() {
+    flush();
+    checksums.rebuild(disk, fs_offset_inode_block + MB.n_bitmap_blocks);
+}
+
+// A failed write back cannot be reported from here, FileSystem::unmount() flushes first and throws it.
+Block::~Block() {
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+    }
+    disk.unmount();
+}
+
+// Dirty limit defaults to the cache size, so eviction is the only forced write back.
+void Block::set_write_mode(WriteMode mode, int32_t n_dirty_limit) {
+    if (n_dirty_limit == fs_nullptr) {
+        n_dirty_limit = cache.get_n_entries();
+    }
+
+    if (n_dirty_limit <= 0) {
+        throw std::invalid_argument("Dirty limit must be greater than 0.");
+    }
+
+    if (mode == WriteMode::WriteThrough) {
+        flush();
+    }
+
+    write_mode = mode;
+    dirty_limit = n_dirty_limit;
+}
+
+// Dirty blocks are written out before the cache is emptied for the new policy.
+void Block::set_cache_policy(CachePolicy policy) {
+    flush();
+    cache.set_policy(policy);
+}
 
-int32_t Block::read_block(int32_t block_n) {
-    if (block_n == casched_block) {
-        return block_n;
+uint8_t* Block::read_block(int32_t block_n) {
+    uint8_t* cached_data = cache.lookup(block_n);
+    if (cached_data != nullptr) {
+        cache.consume_prefetched(block_n);
+        return cached_data;
     }
 
-    auto n_read = disk.read(block_n, rwbuffer.data(), MB.block_size);
+    cached_data = insert_block(block_n);
+    auto n_read = disk.read(block_n, cached_data, MB.block_size);
     if (n_read != MB.block_size) {
+        cache.invalidate(block_n);
         throw std::runtime_error("Error while read operaion.");
     }
-    casched_block = block_n;
 
-    return block_n;
+    if (!checksums.verify(block_n, cached_data)) {
+        cache.invalidate(block_n);
+        throw std::runtime_error("Block checksum mismatch.");
+    }
+
+    return cached_data;
+}
+
+void Block::write_to_disk(int32_t block_n, const uint8_t* data) {
+    if (disk.write(block_n, data, MB.block_size) != MB.block_size) {
+        throw std::runtime_error("Error while write operaion.");
+    }
+    checksums.update(block_n, data);
+}
+
+// Dirty block held by the entry about to be reused is written back first.
+uint8_t* Block::insert_block(int32_t block_n) {
+    int32_t victim_block_n = cache.get_victim();
+    if (cache.is_dirty(victim_block_n)) {
+        write_to_disk(victim_block_n, cache.find(victim_block_n));
+        cache.mark_clean(victim_block_n);
+    }
+
+    return cache.insert(block_n);
+}
+
+void Block::store_block(int32_t block_n, uint8_t* cached_data) {
+    if (write_mode == WriteMode::WriteBack) {
+        cache.mark_dirty(block_n);
+        if (cache.get_n_dirty() >= dirty_limit) {
+            flush();
+        }
+        return;
+    }
+
+    try {
+        write_to_disk(block_n, cached_data);
+    } catch (const std::runtime_error&) {
+        cache.invalidate(block_n);
+        throw;
+    }
+    cache.mark_clean(block_n);
+    checksums.store(disk);
 }
 
 int32_t Block::write(int32_t block_n, const uint8_t* wdata, int32_t offset, int32_t length) {
@@ -50,17 +141,50 @@ int32_t Block::write(int32_t block_n, const uint8_t* wdata, int32_t offset, int3
     int32_t writtable_space = MB.block_size - real_offset;
     length = std::min(length, writtable_space);
 
-    read_block(block_n);
-    std::memcpy(rwbuffer.data() + real_offset, wdata, length);
-    auto n_write = disk.write(casched_block, rwbuffer.data(), MB.block_size);
-    if (n_write != MB.block_size) {
-        throw std::runtime_error("Error while write operaion.");
+    // Whole block overwritten, previous content not needed
+    if (length == MB.block_size) {
+        return write_full(block_n, wdata, length);
     }
 
+    uint8_t* cached_data = read_block(block_n);
+    std::memcpy(cached_data + real_offset, wdata, length);
+    store_block(block_n, cached_data);
+
     return length;
 }
 
-int32_t Block::read(int32_t block_n, uint8_t* rdata, int32_t offset, int32_t length) {
+// Replaces the whole block without reading it first, bytes past length are zeroed.
+int32_t Block::write_full(int32_t block_n, const uint8_t* wdata, int32_t length) {
+    if (block_n >= MB.n_blocks || block_n < 0) {
+        throw std::invalid_argument("Invalid uint8_t block number.");
+    }
+
+    if (length < 0 || length > MB.block_size) {
+        throw std::invalid_argument("Length cannot be greater than block size and lower than zero.");
+    }
+
+    // Full block not cached yet goes to the disk directly and does not evict anything
+    uint8_t* cached_data = cache.find(block_n);
+    if (cached_data == nullptr && length == MB.block_size) {
+        write_to_disk(block_n, wdata);
+        if (write_mode == WriteMode::WriteThrough) {
+            checksums.store(disk);
+        }
+        return length;
+    }
+
+    if (cached_data == nullptr) {
+        cached_data = insert_block(block_n);
+    }
+    std::memcpy(cached_data, wdata, length);
+    std::memset(cached_data + length, 0x00, MB.block_size - length);
+    store_block(block_n, cached_data);
+
+    return length;
+}
+
+// Validates range inside the block like read() does, returns the offset counted from the block start.
+int32_t Block::check_range(int32_t block_n, int32_t offset, int32_t length) {
     if (block_n >= MB.n_blocks || block_n < 0) {
         throw std::invalid_argument("Invalid uint8_t block number.");
     }
@@ -77,21 +201,199 @@ int32_t Block::read(int32_t block_n, uint8_t* rdata, int32_t offset, int32_t len
             "zero.");
     }
 
+    return real_offset;
+}
+
+int32_t Block::read(int32_t block_n, uint8_t* rdata, int32_t offset, int32_t length) {
+    int32_t real_offset = check_range(block_n, offset, length);
     if (length == 0) {
         return length;
     }
 
-    read_block(block_n);
-    std::memcpy(rdata, rwbuffer.data() + real_offset, length);
+    uint8_t* cached_data = read_block(block_n);
+    std::memcpy(rdata, cached_data + real_offset, length);
     return length;
 }
 
+BlockReadView Block::pin_read(int32_t block_n, int32_t offset, int32_t length) {
+    int32_t real_offset = check_range(block_n, offset, length);
+    uint8_t* cached_data = read_block(block_n);
+    return BlockReadView(cache, cache.pin(block_n), block_n, cached_data + real_offset, length);
+}
+
+// Changes made through the view reach the disk on commit(), or with the next flush when the view is just released.
+BlockWriteView Block::pin_write(int32_t block_n, int32_t offset, int32_t length) {
+    int32_t real_offset = check_range(block_n, offset, length);
+    uint8_t* cached_data = read_block(block_n);
+    return BlockWriteView(cache, cache.pin(block_n), block_n, cached_data + real_offset, length);
+}
+
+void Block::commit(BlockWriteView& view) {
+    if (!view.is_pinned()) {
+        throw std::invalid_argument("View not pinned.");
+    }
+
+    int32_t block_n = view.get_block_n();
+    view.release();
+    store_block(block_n, cache.find(block_n));
+}
+
+int32_t Block::write_blocks(const std::vector<BlockWriteVec>& blocks) {
+    for (auto& wblock : blocks) {
+        if (wblock.block_n >= MB.n_blocks || wblock.block_n < 0) {
+            throw std::invalid_argument("Invalid uint8_t block number.");
+        }
+    }
+
+    auto n_write = disk.write_blocks(blocks);
+    if (n_write != static_cast<int32_t>(blocks.size())) {
+        throw std::runtime_error("Error while write operaion.");
+    }
+
+    // Cached copies are kept up to date with the disk
+    for (auto& wblock : blocks) {
+        checksums.update(wblock.block_n, wblock.data);
+        uint8_t* cached_data = cache.find(wblock.block_n);
+        if (cached_data != nullptr) {
+            std::memcpy(cached_data, wblock.data, MB.block_size);
+            cache.mark_clean(wblock.block_n);
+        }
+    }
+    if (write_mode == WriteMode::WriteThrough) {
+        checksums.store(disk);
+    }
+
+    return n_write;
+}
+
+// Cached blocks, dirty or prefetched ones included, are copied from the cache, the rest is read in one scattered call.
+int32_t Block::read_blocks(const std::vector<BlockReadVec>& blocks) {
+    for (auto& rblock : blocks) {
+        if (rblock.block_n >= MB.n_blocks || rblock.block_n < 0) {
+            throw std::invalid_argument("Invalid uint8_t block number.");
+        }
+    }
+
+    miss_vecs.clear();
+    for (auto& rblock : blocks) {
+        uint8_t* cached_data = cache.find(rblock.block_n);
+        if (cached_data == nullptr) {
+            miss_vecs.push_back(rblock);
+            continue;
+        }
+        cache.consume_prefetched(rblock.block_n);
+        std::memcpy(rblock.data, cached_data, MB.block_size);
+    }
+
+    if (!miss_vecs.empty()) {
+        auto n_read = disk.read_blocks(miss_vecs);
+        if (n_read != static_cast<int32_t>(miss_vecs.size())) {
+            throw std::runtime_error("Error while read operaion.");
+        }
+
+        for (auto& rblock : miss_vecs) {
+            if (!checksums.verify(rblock.block_n, rblock.data)) {
+                throw std::runtime_error("Block checksum mismatch.");
+            }
+        }
+    }
+
+    return blocks.size();
+}
+
+// Reads blocks not cached yet into the cache with as few vectored reads as possible, returns the number
+// of blocks prefetched. Failed or corrupted prefetch is dropped silently, the next access reads the block again.
+int32_t Block::prefetch(const std::vector<int32_t>& block_ns) {
+    if (static_cast<int32_t>(block_ns.size()) >= cache.get_n_entries()) {
+        throw std::invalid_argument("Cannot prefetch more blocks than the cache holds.");
+    }
+
+    for (auto block_n : block_ns) {
+        if (block_n >= MB.n_blocks || block_n < 0) {
+            throw std::invalid_argument("Invalid uint8_t block number.");
+        }
+    }
+
+    // Entries of the batch stay pinned until it is read, so the policy cannot hand one of them
+    // out again for a later block of the same batch
+    prefetch_vecs.clear();
+    prefetch_entry_ns.clear();
+    try {
+        for (auto block_n : block_ns) {
+            if (cache.find(block_n) == nullptr) {
+                prefetch_vecs.push_back({block_n, insert_block(block_n)});
+                prefetch_entry_ns.push_back(cache.pin(block_n));
+            }
+        }
+    } catch (const std::runtime_error&) {
+        for (auto& rblock : prefetch_vecs) {
+            cache.invalidate(rblock.block_n);
+        }
+        unpin_prefetched();
+        throw;
+    }
+
+    if (prefetch_vecs.empty()) {
+        return 0;
+    }
+
+    std::sort(prefetch_vecs.begin(), prefetch_vecs.end(),
+              [](const BlockReadVec& a, const BlockReadVec& b) { return a.block_n < b.block_n; });
+    auto n_read = disk.read_blocks(prefetch_vecs);
+    bool failed = n_read != static_cast<int32_t>(prefetch_vecs.size());
+    int32_t n_prefetched = 0;
+    for (auto& rblock : prefetch_vecs) {
+        if (failed || !checksums.verify(rblock.block_n, rblock.data)) {
+            cache.invalidate(rblock.block_n);
+        } else {
+            cache.mark_prefetched(rblock.block_n);
+            n_prefetched++;
+        }
+    }
+    unpin_prefetched();
+
+    return n_prefetched;
+}
+
+void Block::unpin_prefetched() noexcept {
+    for (auto entry_n : prefetch_entry_ns) {
+        cache.unpin(entry_n, false);
+    }
+    prefetch_entry_ns.clear();
+}
+
+// Dirty blocks are written in block order, consecutive ones end up in a single vectored write.
+// Checksums of the written blocks go to the disk last.
+void Block::flush() {
+    if (cache.get_n_dirty() == 0) {
+        checksums.store(disk);
+        return;
+    }
+
+    cache.collect_dirty(dirty_block_ns);
+    flush_vecs.clear();
+    for (auto block_n : dirty_block_ns) {
+        flush_vecs.push_back({block_n, cache.find(block_n)});
+    }
+
+    auto n_write = disk.write_blocks(flush_vecs);
+    if (n_write != static_cast<int32_t>(flush_vecs.size())) {
+        throw std::runtime_error("Error while write operaion.");
+    }
+
+    for (auto& wblock : flush_vecs) {
+        checksums.update(wblock.block_n, wblock.data);
+        cache.mark_clean(wblock.block_n);
+    }
+    checksums.store(disk);
+}
+
 int32_t Block::data_n_to_block_n(int32_t data_n) {
     if (data_n >= MB.n_data_blocks || data_n < 0) {
         throw std::invalid_argument("Invalid uint8_t block number.");
     }
 
-    return data_n + MB.n_inode_blocks + fs_offset_inode_block;
+    return data_n + MB.n_inode_blocks + MB.n_bitmap_blocks + fs_offset_inode_block;
 }
 
 int32_t Block::inode_n_to_block_n(int32_t inode_n) {
@@ -99,7 +401,7 @@ int32_t Block::inode_n_to_block_n(int32_t inode_n) {
         throw std::invalid_argument("Invalid inode block number.");
     }
 
-    return inode_n / get_n_inodes_in_block() + fs_offset_inode_block;
+    return inode_n / get_n_inodes_in_block() + MB.n_bitmap_blocks + fs_offset_inode_block;
 }
 
 int32_t Block::get_n_inodes_in_block() { return MB.block_size / meta_fragm_size_bytes; }
@@ -2,27 +2,62 @@
 #define FSFS_DATA_BLOCK_HPP
 #include <vector>
 
+#include "block_cache.hpp"
+#include "block_checksums.hpp"
 #include "common/types.hpp"
 #include "data_structs.hpp"
 #include "disk-emulator/disk.hpp"
 
 namespace FSFS {
+constexpr int32_t default_block_cache_entries = 32;
+
+// WriteThrough stores every update on the disk right away, together with its
+// checksum. WriteBack keeps updated blocks dirty in the cache until flush(),
+// eviction or the dirty limit, the checksum table is stored by flush().
+enum class WriteMode { WriteThrough, WriteBack };
+
 class Block {
    private:
     Disk& disk;
     const super_block& MB;
-    std::vector<uint8_t> rwbuffer;
-    int32_t casched_block;
+    BlockCache cache;
+    BlockChecksums checksums;
+    WriteMode write_mode;
+    int32_t dirty_limit;
+    std::vector<int32_t> dirty_block_ns;
+    std::vector<BlockWriteVec> flush_vecs;
+    std::vector<BlockReadVec> miss_vecs;
+    std::vector<BlockReadVec> prefetch_vecs;
+    std::vector<int32_t> prefetch_entry_ns;
 
-    int32_t read_block(int32_t block_n);
+    uint8_t* read_block(int32_t block_n);
+    uint8_t* insert_block(int32_t block_n);
+    void write_to_disk(int32_t block_n, const uint8_t* data);
+    void store_block(int32_t block_n, uint8_t* cached_data);
+    void unpin_prefetched() noexcept;
+    int32_t check_range(int32_t block_n, int32_t offset, int32_t length);
 
    public:
-    Block(Disk& disk, const super_block& MB);
+    Block(Disk& disk, const super_block& MB, int32_t n_cache_entries = default_block_cache_entries);
     ~Block();
 
     void resize();
+    void rebuild_checksums();
     int32_t write(int32_t block_n, const uint8_t* wdata, int32_t offset, int32_t length);
+    int32_t write_full(int32_t block_n, const uint8_t* wdata, int32_t length);
     int32_t read(int32_t block_n, uint8_t* rdata, int32_t offset, int32_t length);
+    BlockReadView pin_read(int32_t block_n, int32_t offset, int32_t length);
+    BlockWriteView pin_write(int32_t block_n, int32_t offset, int32_t length);
+    void commit(BlockWriteView& view);
+    int32_t write_blocks(const std::vector<BlockWriteVec>& blocks);
+    int32_t read_blocks(const std::vector<BlockReadVec>& blocks);
+    void flush();
+    int32_t prefetch(const std::vector<int32_t>& block_ns);
+
+    void set_write_mode(WriteMode mode, int32_t n_dirty_limit = fs_nullptr);
+    void set_cache_policy(CachePolicy policy);
+    WriteMode get_write_mode() const { return write_mode; };
+    int32_t get_dirty_limit() const { return dirty_limit; };
 
     int32_t get_block_size();
     int32_t get_n_addreses_in_block();
@@ -30,6 +65,9 @@ class Block {
     int32_t inode_n_to_block_n(int32_t inode_n);
     int32_t data_n_to_block_n(int32_t data_n);
     int32_t bytes_to_blocks(int32_t length);
+
+    const BlockCache& get_cache() const { return cache; };
+    const BlockChecksums& get_checksums() const { return checksums; };
 };
 }
 #endif
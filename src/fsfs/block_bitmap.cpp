@@ -1,25 +1,89 @@
 #include "block_bitmap.hpp"
 
+#include <algorithm>
 #include <stdexcept>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 namespace FSFS {
-inline int32_t BlockBitmap::calc_pos(int32_t block_n) const {
-    auto row = block_n / bitmap_row_length;
-    return block_n - (bitmap_row_length * row);
+namespace {
+constexpr bitmap_t full_row = std::numeric_limits<bitmap_t>::max();
+
+#if defined(__x86_64__)
+// Eight rows per step, the row with the clear bit is then found by the portable scan.
+__attribute__((target("avx2"))) size_t find_free_row_avx2_impl(const bitmap_t* rows, size_t row, size_t n_rows) {
+    const __m256i full = _mm256_set1_epi64x(-1);
+    for (; row + 8 <= n_rows; row += 8) {
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows + row));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows + row + 4));
+        if (!_mm256_testc_si256(_mm256_and_si256(low, high), full)) {
+            break;
+        }
+    }
+    return find_free_row_portable(rows, row, n_rows);
+}
+#endif
+
+using FindFreeRowFunc = size_t (*)(const bitmap_t*, size_t, size_t);
+
+FindFreeRowFunc select_find_free_row() {
+#if defined(__x86_64__)
+    if (find_free_row_avx2_supported()) {
+        return find_free_row_avx2_impl;
+    }
+#endif
+    return find_free_row_portable;
+}
+
+const FindFreeRowFunc find_free_row_impl = select_find_free_row();
+}
+
+size_t find_free_row_portable(const bitmap_t* rows, size_t first_row, size_t n_rows) {
+    size_t row = first_row;
+    while (row < n_rows && rows[row] == full_row) {
+        row++;
+    }
+    return row;
+}
+
+size_t find_free_row_avx2(const bitmap_t* rows, size_t first_row, size_t n_rows) {
+#if defined(__x86_64__)
+    if (find_free_row_avx2_supported()) {
+        return find_free_row_avx2_impl(rows, first_row, n_rows);
+    }
+#endif
+    return find_free_row_portable(rows, first_row, n_rows);
+}
+
+bool find_free_row_avx2_supported() {
+#if defined(__x86_64__)
+    // Also used by a static initializer, CPU model may not be probed yet
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
 }
 
+size_t find_free_row(const bitmap_t* rows, size_t first_row, size_t n_rows) {
+    return find_free_row_impl(rows, first_row, n_rows);
+}
+
+inline int32_t BlockBitmap::calc_pos(int32_t block_n) const { return block_n % bitmap_row_length; }
+
 bitmap_t* BlockBitmap::get_map_row(int32_t block_n) {
     if (block_n >= n_blocks || block_n < 0) {
         throw std::invalid_argument("Block idx out of bound.");
     }
-    return &bitmap.at(block_n / bitmap_row_length);
+    return &bitmap[block_n / bitmap_row_length];
 }
 
 const bitmap_t& BlockBitmap::get_map_row(int32_t block_n) const {
     if (block_n >= n_blocks || block_n < 0) {
         throw std::invalid_argument("Block idx out of bound.");
     }
-    return bitmap.at(block_n / bitmap_row_length);
+    return bitmap[block_n / bitmap_row_length];
 }
 
 void BlockBitmap::resize(int32_t n_blocks) {
@@ -30,18 +94,88 @@ void BlockBitmap::resize(int32_t n_blocks) {
     // Step 1: calculate needed space and prepare free
     //
     this->n_blocks = n_blocks;
+    n_used = 0;
     int32_t map_size = n_blocks / bitmap_row_length;
     if ((n_blocks - map_size * bitmap_row_length) > 0) {
         map_size += 1;
     }
-    bitmap.resize(map_size);
-    std::fill_n(bitmap.data(), map_size, 0x00);
+    bitmap.assign(map_size, 0x00);
 
     // Step 2: Set as no free additional unused blocks
     //
-    int32_t n_unused_bits = map_size * bitmap_row_length - n_blocks;
-    bitmap_t unused_bits_mask = (1UL << n_unused_bits) - 1;
-    bitmap.at(map_size - 1) = unused_bits_mask << (std::numeric_limits<bitmap_t>::digits - n_unused_bits - 1);
+    int32_t n_used_bits = calc_pos(n_blocks);
+    if (n_used_bits != 0) {
+        bitmap.back() = full_row << n_used_bits;
+    }
+
+    // Step 3: Summarize levels until the top one is short enough to scan, no row is full yet and
+    // summary bits past the last row are never free either
+    //
+    summary.clear();
+    for (size_t n_rows = bitmap.size(); n_rows > max_bitmap_top_rows;) {
+        size_t n_summary_rows = (n_rows + bitmap_row_length - 1) / bitmap_row_length;
+        summary.emplace_back(n_summary_rows, 0x00);
+        if (n_rows % bitmap_row_length != 0) {
+            summary.back().back() = full_row << (n_rows % bitmap_row_length);
+        }
+        n_rows = n_summary_rows;
+    }
+    allocator->reset();
+}
+
+// Rows of a bitmap of the same size, as stored from get_rows(). Bits past the last block are set
+// again, the summary and the counters are rebuilt from the copied rows.
+void BlockBitmap::load_rows(const bitmap_t* rows) {
+    if (n_blocks < 0) {
+        throw std::runtime_error("Bitmap is not initialized.");
+    }
+
+    resize(n_blocks);
+    bitmap_t tail_bits = bitmap.back();
+    std::copy(rows, rows + bitmap.size(), bitmap.begin());
+    bitmap.back() |= tail_bits;
+
+    for (size_t row = 0; row < bitmap.size(); row++) {
+        update_summary(row);
+    }
+    n_used = count_used();
+}
+
+// Row filled or freed is marked in the level above, up to the first level that does not change.
+void BlockBitmap::update_summary(size_t row) {
+    for (size_t level = 0; level < summary.size(); level++) {
+        bool is_full = level_rows(level)[row] == full_row;
+        bitmap_t mask = bitmap_t(1) << (row % bitmap_row_length);
+        row /= bitmap_row_length;
+        bitmap_t& summary_row = summary[level][row];
+        if (((summary_row & mask) != 0) == is_full) {
+            return;
+        }
+        summary_row ^= mask;
+    }
+}
+
+// First row of the level from first_row on with a clear bit, number of its rows when there is none.
+size_t BlockBitmap::next_free_row(size_t level, size_t first_row) const {
+    const auto& rows = level_rows(level);
+    if (first_row >= rows.size()) {
+        return rows.size();
+    }
+
+    if (level == summary.size()) {
+        return find_free_row(rows.data(), first_row, rows.size());
+    }
+
+    size_t summary_row = first_row / bitmap_row_length;
+    bitmap_t free_rows = ~summary[level][summary_row] & (full_row << (first_row % bitmap_row_length));
+    if (free_rows == 0) {
+        summary_row = next_free_row(level + 1, summary_row + 1);
+        if (summary_row == summary[level].size()) {
+            return rows.size();
+        }
+        free_rows = ~summary[level][summary_row];
+    }
+    return summary_row * bitmap_row_length + __builtin_ctzll(free_rows);
 }
 
 void BlockBitmap::set_status(int32_t block_n, bool status) {
@@ -53,15 +187,20 @@ void BlockBitmap::set_status(int32_t block_n, bool status) {
         throw std::runtime_error("Bitmap is not initialized.");
     }
 
-    constexpr bitmap_t mask = (1UL << (bitmap_row_length - 1));
     bitmap_t* block_map = get_map_row(block_n);
+    bitmap_t mask = bitmap_t(1) << calc_pos(block_n);
+    if (((*block_map & mask) != 0) == status) {
+        return;
+    }
 
-    int32_t mask_shift = bitmap_row_length - calc_pos(block_n);
     if (status) {
-        *block_map |= (mask >> mask_shift);
+        *block_map |= mask;
+        n_used++;
     } else {
-        *block_map &= ~(mask >> mask_shift);
+        *block_map &= ~mask;
+        n_used--;
     }
+    update_summary(block_n / bitmap_row_length);
 }
 
 bool BlockBitmap::get_status(int32_t block_n) const {
@@ -73,11 +212,136 @@ bool BlockBitmap::get_status(int32_t block_n) const {
         throw std::runtime_error("Bitmap is not initialized.");
     }
 
-    constexpr bitmap_t mask = (1UL << (bitmap_row_length - 1));
-    auto block_map = get_map_row(block_n);
+    return (get_map_row(block_n) >> calc_pos(block_n)) & 1;
+}
 
-    int32_t mask_shift = bitmap_row_length - calc_pos(block_n);
-    return block_map & (mask >> mask_shift);
+// Free blocks from block_n on, which must be free, up to max_len. Bits past the last block end every run.
+int32_t BlockBitmap::free_run_length(int32_t block_n, int32_t max_len) const {
+    int32_t run_len = 0;
+    size_t row = block_n / bitmap_row_length;
+    int32_t pos = calc_pos(block_n);
+    while (run_len < max_len && row < bitmap.size()) {
+        bitmap_t used_bits = bitmap[row] >> pos;
+        int32_t n_free = used_bits ? __builtin_ctzll(used_bits) : bitmap_row_length - pos;
+        run_len += n_free;
+        if (pos + n_free < bitmap_row_length) {
+            break;
+        }
+        row++;
+        pos = 0;
+    }
+    return std::min(run_len, max_len);
+}
+
+int32_t BlockBitmap::find_free_run(int32_t block_offset, int32_t min_len, int32_t max_len,
+                                   int32_t& first_block_n) const {
+    while (block_offset < n_blocks) {
+        block_offset = next_free(block_offset);
+        if (block_offset == -1) {
+            return 0;
+        }
+
+        // Run too short, the block past it is used
+        int32_t run_len = free_run_length(block_offset, max_len);
+        if (run_len >= min_len) {
+            first_block_n = block_offset;
+            return run_len;
+        }
+        block_offset += run_len + 1;
+    }
+    return 0;
+}
+
+// Marks the first free run of at least min_len blocks at or past hint, or from the bitmap start when
+// there is none, cut to max_len. Returns the run length, 0 when no run is long enough.
+int32_t BlockBitmap::allocate_run(int32_t min_len, int32_t max_len, int32_t hint, int32_t& first_block_n) {
+    if (n_blocks < 0) {
+        throw std::runtime_error("Bitmap is not initialized.");
+    }
+
+    if (min_len <= 0 || max_len < min_len) {
+        throw std::invalid_argument("Run length must be greater than 0 and max length not lower than min length.");
+    }
+
+    if (hint < 0) {
+        throw std::invalid_argument("Size number cannot be equal or lower than 0.");
+    }
+
+    // Step 1: Find the run, hint past the last block starts from the bitmap start
+    //
+    hint = hint < n_blocks ? hint : 0;
+    int32_t run_len = find_free_run(hint, min_len, max_len, first_block_n);
+    if (run_len == 0 && hint > 0) {
+        run_len = find_free_run(0, min_len, max_len, first_block_n);
+    }
+
+    // Step 2: Mark the run a row at a time
+    //
+    int32_t block_n = first_block_n;
+    for (int32_t n_left = run_len; n_left > 0;) {
+        size_t row = block_n / bitmap_row_length;
+        int32_t pos = calc_pos(block_n);
+        int32_t n_bits = std::min(n_left, bitmap_row_length - pos);
+        bitmap_t mask = n_bits == bitmap_row_length ? full_row : ((bitmap_t(1) << n_bits) - 1) << pos;
+        bitmap[row] |= mask;
+        update_summary(row);
+
+        block_n += n_bits;
+        n_left -= n_bits;
+    }
+    n_used += run_len;
+
+    return run_len;
+}
+
+// Length of the first free run at or past block_offset, whole, 0 when there is none.
+int32_t BlockBitmap::next_free_run(int32_t block_offset, int32_t& first_block_n) const {
+    if (block_offset < 0) {
+        throw std::invalid_argument("Size number cannot be equal or lower than 0.");
+    }
+
+    if (n_blocks < 0) {
+        throw std::runtime_error("Bitmap is not initialized.");
+    }
+
+    return find_free_run(block_offset, 1, n_blocks, first_block_n);
+}
+
+// Allocator state, like the next fit cursor, starts over with the new policy.
+void BlockBitmap::set_alloc_policy(AllocPolicy policy) {
+    allocator = BlockAllocator::make(policy);
+    this->policy = policy;
+}
+
+int32_t BlockBitmap::allocate(int32_t max_len, int32_t hint, int32_t& first_block_n) {
+    if (n_blocks < 0) {
+        throw std::runtime_error("Bitmap is not initialized.");
+    }
+
+    if (max_len <= 0) {
+        throw std::invalid_argument("Run length must be greater than 0.");
+    }
+
+    return allocator->allocate(*this, max_len, hint, first_block_n);
+}
+
+// Single block, fs_nullptr when every block is used.
+int32_t BlockBitmap::allocate(int32_t hint) {
+    int32_t block_n = fs_nullptr;
+    return allocate(1, hint, block_n) ? block_n : fs_nullptr;
+}
+
+// Bits past the last block are set, they are not counted.
+int32_t BlockBitmap::count_used() const {
+    if (n_blocks < 0) {
+        throw std::runtime_error("Bitmap is not initialized.");
+    }
+
+    int64_t n_set_bits = 0;
+    for (auto row : bitmap) {
+        n_set_bits += __builtin_popcountll(row);
+    }
+    return n_set_bits - (static_cast<int64_t>(bitmap.size()) * bitmap_row_length - n_blocks);
 }
 
 int32_t BlockBitmap::next_free(int32_t block_offset) const {
@@ -89,31 +353,23 @@ int32_t BlockBitmap::next_free(int32_t block_offset) const {
         throw std::runtime_error("Block offset is greater than block map size.");
     }
 
-    // Step 1: Find row in bitmap with free blocks
+    // Step 1: Look for free blocks at or past the offset in its own row
     //
     size_t row = block_offset / bitmap_row_length;
-    for (; row < bitmap.size(); row++) {
-        if (bitmap.at(row) != std::numeric_limits<bitmap_t>::max()) {
-            break;
-        }
-    }
+    bitmap_t free_bits = ~bitmap[row] & (full_row << calc_pos(block_offset));
 
-    // Step 2: Check if no free blocks
+    // Step 2: Find next row in bitmap with free blocks through the summary
     //
-    if (row == bitmap.size()) {
-        return -1;
+    if (free_bits == 0) {
+        row = next_free_row(0, row + 1);
+        if (row == bitmap.size()) {
+            return -1;
+        }
+        free_bits = ~bitmap[row];
     }
 
-    // Step 3: Find free block in row
+    // Step 3: Lowest clear bit is the free block, bits past the last block are never clear
     //
-    int32_t pos_offset = calc_pos(block_offset);
-    int32_t real_idx = row * bitmap_row_length + pos_offset;
-    for (auto i = pos_offset; i < bitmap_row_length; i++) {
-        if (!get_status(real_idx)) {
-            break;
-        }
-        real_idx++;
-    }
-    return real_idx;
+    return row * bitmap_row_length + __builtin_ctzll(free_bits);
 }
 }
@@ -1,32 +1,81 @@
 #ifndef FSFS_BLOCK_BITMAP_HPP
 #define FSFS_BLOCK_BITMAP_HPP
+#include <stddef.h>
+
 #include <limits>
+#include <memory>
 #include <vector>
 
+#include "alloc_policy.hpp"
 #include "common/types.hpp"
 
 namespace FSFS {
 using bitmap_t = uint64_t;
+
+// Index of the first row from first_row on with a clear bit, n_rows when every row is full.
+// find_free_row() picks the AVX2 scan when the host has it.
+size_t find_free_row(const bitmap_t* rows, size_t first_row, size_t n_rows);
+size_t find_free_row_portable(const bitmap_t* rows, size_t first_row, size_t n_rows);
+size_t find_free_row_avx2(const bitmap_t* rows, size_t first_row, size_t n_rows);
+bool find_free_row_avx2_supported();
+
+// Levels of the summary over the bitmap stop once one fits in this many rows, it is scanned whole.
+constexpr size_t max_bitmap_top_rows = 64;
+
+// Block n is bit n % 64 of row n / 64, bits past the last block are kept set so they are never free.
+// Each summary level keeps one bit per row of the level below, set while that row is full, so a free
+// block is found through one row per level instead of scanning every full row before it.
 class BlockBitmap {
    private:
     int32_t n_blocks;
+    int32_t n_used;
     std::vector<bitmap_t> bitmap;
+    std::vector<std::vector<bitmap_t>> summary;
+    AllocPolicy policy;
+    std::unique_ptr<BlockAllocator> allocator;
 
     constexpr static auto bitmap_row_length = std::numeric_limits<bitmap_t>::digits;
 
     inline int32_t calc_pos(int32_t block_n) const;
     const bitmap_t& get_map_row(int32_t block_n) const;
     bitmap_t* get_map_row(int32_t block_n);
+    const std::vector<bitmap_t>& level_rows(size_t level) const { return level ? summary[level - 1] : bitmap; };
+    void update_summary(size_t row);
+    size_t next_free_row(size_t level, size_t first_row) const;
+    int32_t free_run_length(int32_t block_n, int32_t max_len) const;
+    int32_t find_free_run(int32_t block_offset, int32_t min_len, int32_t max_len, int32_t& first_block_n) const;
 
    public:
-    BlockBitmap() : n_blocks(-1){};
-    BlockBitmap(int32_t n_blocks) : n_blocks(n_blocks) { resize(n_blocks); };
+    BlockBitmap() : n_blocks(-1), n_used(0), policy(AllocPolicy::FirstFit), allocator(BlockAllocator::make(policy)){};
+    BlockBitmap(int32_t n_blocks)
+        : n_blocks(n_blocks), n_used(0), policy(AllocPolicy::FirstFit), allocator(BlockAllocator::make(policy)) {
+        resize(n_blocks);
+    };
 
     void resize(int32_t n_blocks);
+    void load_rows(const bitmap_t* rows);
     void set_status(int32_t block_n, bool status);
     bool get_status(int32_t block_n) const;
 
     int32_t next_free(int32_t block_offset) const;
+    int32_t allocate_run(int32_t min_len, int32_t max_len, int32_t hint, int32_t& first_block_n);
+    int32_t next_free_run(int32_t block_offset, int32_t& first_block_n) const;
+
+    // Blocks chosen by the allocation policy, see BlockAllocator
+    void set_alloc_policy(AllocPolicy policy);
+    AllocPolicy get_alloc_policy() const { return policy; };
+    int32_t allocate(int32_t max_len, int32_t hint, int32_t& first_block_n);
+    int32_t allocate(int32_t hint);
+
+    int32_t get_n_blocks() const { return n_blocks; };
+    // Counters kept up to date by set_status(), count_used() recounts the bitmap to verify them
+    int32_t get_n_used() const { return n_used; };
+    int32_t get_n_free() const { return n_blocks - n_used; };
+    int32_t count_used() const;
+
+    const std::vector<bitmap_t>& get_rows() const { return bitmap; };
+
+    static int32_t calc_n_rows(int32_t n_blocks) { return (n_blocks + bitmap_row_length - 1) / bitmap_row_length; };
 };
 }
 #endif
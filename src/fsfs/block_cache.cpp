@@ -0,0 +1,222 @@
+#include "block_cache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace FSFS {
+BlockCache::BlockCache(int32_t n_entries, int32_t block_size, CachePolicy policy)
+    : block_size(block_size), entry_lut(0, std::hash<int32_t>(), std::equal_to<int32_t>(), EntryLut::allocator_type(lut_pool)),
+      policy(policy), replacer(CacheReplacer::make(policy)), n_pins(0) {
+    resize(n_entries, block_size);
+}
+
+// Cached blocks are dropped, the new policy starts from an empty cache.
+void BlockCache::set_policy(CachePolicy policy) {
+    if (n_pins > 0) {
+        throw std::runtime_error("Cache entries still pinned.");
+    }
+
+    replacer = CacheReplacer::make(policy);
+    this->policy = policy;
+    clear();
+}
+
+void BlockCache::resize(int32_t n_entries, int32_t block_size) {
+    if (n_entries <= 0) {
+        throw std::invalid_argument("Cache must contain at least one entry.");
+    }
+
+    if (n_pins > 0) {
+        throw std::runtime_error("Cache entries still pinned.");
+    }
+
+    // Block size not known yet leaves the arena empty until the next resize
+    this->block_size = block_size;
+    buffers.resize(block_size > 0 ? static_cast<size_t>(n_entries) * block_size : 0);
+    entries.resize(n_entries);
+    entry_lut.reserve(n_entries);
+    lut_pool.reserve(n_entries);
+    clear();
+}
+
+void BlockCache::clear() {
+    if (n_pins > 0) {
+        throw std::runtime_error("Cache entries still pinned.");
+    }
+
+    entry_lut.clear();
+
+    for (auto& entry : entries) {
+        entry = {fs_nullptr, false, false, 0};
+    }
+    replacer->reset(entries.size());
+    n_dirty = 0;
+    n_pins = 0;
+
+    reset_stats();
+}
+
+// Does not count as an access, neither for the counters nor for the LRU order.
+uint8_t* BlockCache::find(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    return it != entry_lut.end() ? entry_data(it->second) : nullptr;
+}
+
+uint8_t* BlockCache::lookup(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    if (it == entry_lut.end()) {
+        n_misses++;
+        return nullptr;
+    }
+
+    n_hits++;
+    replacer->on_hit(it->second);
+    return entry_data(it->second);
+}
+
+int32_t BlockCache::victim_entry() const { return replacer->victim(); }
+
+uint8_t* BlockCache::insert(int32_t block_n) {
+    invalidate(block_n);
+
+    int32_t entry_n = victim_entry();
+    if (entry_n == fs_nullptr) {
+        throw std::runtime_error("All cache entries pinned.");
+    }
+    Entry& entry = entries[entry_n];
+    int32_t evicted_block_n = entry.block_n;
+    if (evicted_block_n != fs_nullptr) {
+        entry_lut.erase(evicted_block_n);
+    }
+    if (entry.dirty) {
+        entry.dirty = false;
+        n_dirty--;
+    }
+    entry.prefetched = false;
+
+    entry.block_n = block_n;
+    entry_lut[block_n] = entry_n;
+    replacer->on_insert(entry_n, block_n, evicted_block_n);
+
+    return entry_data(entry_n);
+}
+
+void BlockCache::invalidate(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    if (it == entry_lut.end()) {
+        return;
+    }
+
+    int32_t entry_n = it->second;
+    entry_lut.erase(it);
+    if (entries[entry_n].dirty) {
+        entries[entry_n].dirty = false;
+        n_dirty--;
+    }
+    entries[entry_n].prefetched = false;
+    entries[entry_n].block_n = fs_nullptr;
+    replacer->on_free(entry_n);
+}
+
+void BlockCache::mark_dirty(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    if (it == entry_lut.end()) {
+        throw std::invalid_argument("Block not cached.");
+    }
+
+    Entry& entry = entries[it->second];
+    if (!entry.dirty) {
+        entry.dirty = true;
+        n_dirty++;
+    }
+}
+
+void BlockCache::mark_clean(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    if (it == entry_lut.end()) {
+        return;
+    }
+
+    Entry& entry = entries[it->second];
+    if (entry.dirty) {
+        entry.dirty = false;
+        n_dirty--;
+    }
+}
+
+bool BlockCache::is_dirty(int32_t block_n) const {
+    auto it = entry_lut.find(block_n);
+    return it != entry_lut.end() && entries[it->second].dirty;
+}
+
+// Block held by the entry the next insert reuses, fs_nullptr when that entry is free.
+int32_t BlockCache::get_victim() const {
+    int32_t entry_n = victim_entry();
+    return entry_n != fs_nullptr ? entries[entry_n].block_n : fs_nullptr;
+}
+
+void BlockCache::collect_dirty(std::vector<int32_t>& dirty_block_ns) const {
+    dirty_block_ns.clear();
+    for (auto& entry : entries) {
+        if (entry.dirty) {
+            dirty_block_ns.push_back(entry.block_n);
+        }
+    }
+    std::sort(dirty_block_ns.begin(), dirty_block_ns.end());
+}
+
+void BlockCache::mark_prefetched(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    if (it == entry_lut.end()) {
+        throw std::invalid_argument("Block not cached.");
+    }
+
+    entries[it->second].prefetched = true;
+    n_prefetched++;
+}
+
+// First use of a prefetched block counts as a prefetch hit, later ones are ordinary hits.
+bool BlockCache::consume_prefetched(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    if (it == entry_lut.end() || !entries[it->second].prefetched) {
+        return false;
+    }
+
+    entries[it->second].prefetched = false;
+    n_prefetch_hits++;
+    return true;
+}
+
+// Returns the pinned entry, it is released by index since the block may be invalidated meanwhile.
+int32_t BlockCache::pin(int32_t block_n) {
+    auto it = entry_lut.find(block_n);
+    if (it == entry_lut.end()) {
+        throw std::invalid_argument("Block not cached.");
+    }
+
+    if (entries[it->second].n_pins++ == 0) {
+        replacer->set_pinned(it->second, true);
+    }
+    n_pins++;
+    return it->second;
+}
+
+void BlockCache::unpin(int32_t entry_n, bool dirty) noexcept {
+    Entry& entry = entries[entry_n];
+    if (--entry.n_pins == 0) {
+        replacer->set_pinned(entry_n, false);
+    }
+    n_pins--;
+    if (dirty && entry.block_n != fs_nullptr && !entry.dirty) {
+        entry.dirty = true;
+        n_dirty++;
+    }
+}
+
+void BlockCache::reset_stats() {
+    n_hits = 0;
+    n_misses = 0;
+    n_prefetched = 0;
+    n_prefetch_hits = 0;
+}
+}
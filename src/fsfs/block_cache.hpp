@@ -0,0 +1,144 @@
+#ifndef FSFS_BLOCK_CACHE_HPP
+#define FSFS_BLOCK_CACHE_HPP
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "cache_policy.hpp"
+#include "common/aligned_allocator.hpp"
+#include "common/pool_allocator.hpp"
+#include "common/types.hpp"
+#include "data_structs.hpp"
+
+namespace FSFS {
+// Fixed number of block sized buffers found by block number, the replacement
+// policy picks the one reused when a block not cached yet is inserted. Buffers live in
+// one arena and lookup nodes in a pool sized for every entry, so a warm cache
+// never touches the heap. Dirty and prefetched entries are only tracked here,
+// moving the data is up to the owner.
+class BlockCache {
+   private:
+    struct Entry {
+        int32_t block_n;
+        bool dirty;
+        bool prefetched;
+        int32_t n_pins;
+    };
+
+    using EntryLut = std::unordered_map<int32_t, int32_t, std::hash<int32_t>, std::equal_to<int32_t>,
+                                        PoolAllocator<std::pair<const int32_t, int32_t>>>;
+
+    int32_t block_size;
+    AlignedArena buffers;
+    std::vector<Entry> entries;
+    NodePool lut_pool;
+    EntryLut entry_lut;
+    CachePolicy policy;
+    std::unique_ptr<CacheReplacer> replacer;
+    int32_t n_dirty;
+    int32_t n_pins;
+
+    int64_t n_hits;
+    int64_t n_misses;
+    int64_t n_prefetched;
+    int64_t n_prefetch_hits;
+
+    uint8_t* entry_data(int32_t entry_n) { return buffers.data() + static_cast<size_t>(entry_n) * block_size; };
+    int32_t victim_entry() const;
+
+   public:
+    BlockCache(int32_t n_entries, int32_t block_size, CachePolicy policy = CachePolicy::Lru);
+
+    void resize(int32_t n_entries, int32_t block_size);
+    void clear();
+    void set_policy(CachePolicy policy);
+    CachePolicy get_policy() const { return policy; };
+    int32_t get_max_admitted() const { return replacer->max_admitted(); };
+
+    uint8_t* find(int32_t block_n);
+    uint8_t* lookup(int32_t block_n);
+    uint8_t* insert(int32_t block_n);
+    void invalidate(int32_t block_n);
+
+    void mark_dirty(int32_t block_n);
+    void mark_clean(int32_t block_n);
+    bool is_dirty(int32_t block_n) const;
+    int32_t get_victim() const;
+    void collect_dirty(std::vector<int32_t>& dirty_block_ns) const;
+    int32_t get_n_dirty() const { return n_dirty; };
+
+    void mark_prefetched(int32_t block_n);
+    bool consume_prefetched(int32_t block_n);
+
+    int32_t pin(int32_t block_n);
+    void unpin(int32_t entry_n, bool dirty) noexcept;
+    int32_t get_n_pins() const { return n_pins; };
+
+    int32_t get_n_entries() const { return entries.size(); };
+    int64_t get_n_hits() const { return n_hits; };
+    int64_t get_n_misses() const { return n_misses; };
+    int64_t get_n_prefetched() const { return n_prefetched; };
+    int64_t get_n_prefetch_hits() const { return n_prefetch_hits; };
+    void reset_stats();
+};
+
+// Cached block buffer handed out without copying. The entry cannot be reused
+// while the view lives, a writable view leaves it dirty when released.
+template <typename T>
+class PinnedBlock {
+   private:
+    BlockCache* cache;
+    int32_t entry_n;
+    int32_t block_n;
+    T* data_p;
+    int32_t length;
+
+   public:
+    PinnedBlock() : cache(nullptr), entry_n(fs_nullptr), block_n(fs_nullptr), data_p(nullptr), length(0){};
+    PinnedBlock(BlockCache& cache, int32_t entry_n, int32_t block_n, T* data_p, int32_t length)
+        : cache(&cache), entry_n(entry_n), block_n(block_n), data_p(data_p), length(length){};
+    PinnedBlock(const PinnedBlock&) = delete;
+    PinnedBlock& operator=(const PinnedBlock&) = delete;
+
+    PinnedBlock(PinnedBlock&& other) noexcept
+        : cache(other.cache), entry_n(other.entry_n), block_n(other.block_n), data_p(other.data_p), length(other.length) {
+        other.cache = nullptr;
+    }
+
+    PinnedBlock& operator=(PinnedBlock&& other) noexcept {
+        if (this != &other) {
+            release();
+            cache = other.cache;
+            entry_n = other.entry_n;
+            block_n = other.block_n;
+            data_p = other.data_p;
+            length = other.length;
+            other.cache = nullptr;
+        }
+        return *this;
+    }
+
+    ~PinnedBlock() { release(); }
+
+    void release() {
+        if (cache != nullptr) {
+            cache->unpin(entry_n, !std::is_const_v<T>);
+            cache = nullptr;
+            data_p = nullptr;
+            length = 0;
+        }
+    }
+
+    T* data() const { return data_p; };
+    T* begin() const { return data_p; };
+    T* end() const { return data_p + length; };
+    int32_t size() const { return length; };
+    int32_t get_block_n() const { return block_n; };
+    bool is_pinned() const { return cache != nullptr; };
+};
+
+using BlockReadView = PinnedBlock<const uint8_t>;
+using BlockWriteView = PinnedBlock<uint8_t>;
+}
+#endif
@@ -0,0 +1,110 @@
+#include "block_checksums.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "crc32c.hpp"
+
+namespace FSFS {
+BlockChecksums::BlockChecksums() : block_size(0), first_csum_block_n(fs_nullptr), n_verified(0), n_mismatches(0) {}
+
+int32_t BlockChecksums::calc_n_csum_blocks(int32_t n_blocks, int32_t block_size) {
+    int64_t table_size = static_cast<int64_t>(n_blocks) * csum_size_bytes;
+    return (table_size + block_size - 1) / block_size;
+}
+
+void BlockChecksums::disable() {
+    table.clear();
+    dirty_csum_blocks.clear();
+    first_csum_block_n = fs_nullptr;
+}
+
+void BlockChecksums::load(Disk& disk, const super_block& MB) {
+    disable();
+    n_verified = 0;
+    n_mismatches = 0;
+    if (!(MB.features & fs_feature_block_checksums)) {
+        return;
+    }
+
+    if (MB.n_csum_blocks != calc_n_csum_blocks(MB.n_blocks, MB.block_size)) {
+        throw std::runtime_error("Invalid checksum table size.");
+    }
+
+    block_size = MB.block_size;
+    first_csum_block_n = MB.n_blocks - MB.n_csum_blocks;
+    table.resize(static_cast<size_t>(MB.n_csum_blocks) * entries_in_block());
+    dirty_csum_blocks.assign(MB.n_csum_blocks, false);
+
+    auto n_read = disk.read_blocks(first_csum_block_n, MB.n_csum_blocks, cast_to_data(table.data()));
+    if (n_read != MB.n_csum_blocks) {
+        disable();
+        throw std::runtime_error("Cannot read checksum table.");
+    }
+}
+
+void BlockChecksums::store(Disk& disk) {
+    int32_t n_csum_blocks = dirty_csum_blocks.size();
+    for (int32_t csum_block_n = 0; csum_block_n < n_csum_blocks; csum_block_n++) {
+        if (!dirty_csum_blocks[csum_block_n]) {
+            continue;
+        }
+
+        const uint32_t* csum_block = &table[static_cast<size_t>(csum_block_n) * entries_in_block()];
+        if (disk.write(first_csum_block_n + csum_block_n, reinterpret_cast<const uint8_t*>(csum_block), block_size) != block_size) {
+            throw std::runtime_error("Cannot write checksum table.");
+        }
+        dirty_csum_blocks[csum_block_n] = false;
+    }
+}
+
+// Entries from first_block_n up to the table are taken from the blocks on the disk, for a table that may be
+// older than the blocks it covers. Read in batches and stored at once.
+void BlockChecksums::rebuild(Disk& disk, int32_t first_block_n) {
+    if (!is_enabled()) {
+        return;
+    }
+
+    AlignedBuffer batch(static_cast<size_t>(csum_rebuild_batch_blocks) * block_size);
+    for (int32_t block_n = first_block_n; block_n < first_csum_block_n; block_n += csum_rebuild_batch_blocks) {
+        int32_t n_batch_blocks = std::min(csum_rebuild_batch_blocks, first_csum_block_n - block_n);
+        if (disk.read_blocks(block_n, n_batch_blocks, batch.data()) != n_batch_blocks) {
+            throw std::runtime_error("Cannot read blocks to rebuild checksum table.");
+        }
+        for (int32_t i = 0; i < n_batch_blocks; i++) {
+            update(block_n + i, &batch[static_cast<size_t>(i) * block_size]);
+        }
+    }
+    store(disk);
+}
+
+uint32_t BlockChecksums::calc_csum(const uint8_t* data) const {
+    uint32_t crc = crc32c(data, block_size);
+    return crc != csum_unset ? crc : csum_zero_crc;
+}
+
+void BlockChecksums::update(int32_t block_n, const uint8_t* data) {
+    if (!is_enabled() || block_n >= first_csum_block_n) {
+        return;
+    }
+
+    uint32_t csum = calc_csum(data);
+    if (table[block_n] != csum) {
+        table[block_n] = csum;
+        dirty_csum_blocks[block_n / entries_in_block()] = true;
+    }
+}
+
+bool BlockChecksums::verify(int32_t block_n, const uint8_t* data) {
+    if (!is_enabled() || block_n >= first_csum_block_n || table[block_n] == csum_unset) {
+        return true;
+    }
+
+    n_verified++;
+    if (calc_csum(data) != table[block_n]) {
+        n_mismatches++;
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,53 @@
+#ifndef FSFS_BLOCK_CHECKSUMS_HPP
+#define FSFS_BLOCK_CHECKSUMS_HPP
+#include <vector>
+
+#include "common/aligned_allocator.hpp"
+#include "common/types.hpp"
+#include "data_structs.hpp"
+#include "disk-emulator/disk.hpp"
+
+namespace FSFS {
+constexpr int32_t csum_size_bytes = sizeof(uint32_t);
+constexpr uint32_t csum_unset = 0;
+// Stored for a block whose CRC32C really is 0, so it is told apart from csum_unset
+constexpr uint32_t csum_zero_crc = 0xFFFFFFFF;
+constexpr int32_t csum_rebuild_batch_blocks = 64;
+
+// CRC32C of every block kept out of band, in a table stored in the last blocks of
+// the disk. The table is loaded on mount, store() writes back its updated blocks
+// after every write through write and on flush. Blocks never written with
+// checksums on hold csum_unset and are not verified. A CRC of 0 is stored as
+// csum_zero_crc, it shares the entry with a CRC of 0xFFFFFFFF.
+class BlockChecksums {
+   private:
+    int32_t block_size;
+    int32_t first_csum_block_n;
+    std::vector<uint32_t, AlignedAllocator<uint32_t>> table;
+    std::vector<bool> dirty_csum_blocks;
+
+    int64_t n_verified;
+    int64_t n_mismatches;
+
+    int32_t entries_in_block() const { return block_size / csum_size_bytes; };
+    uint32_t calc_csum(const uint8_t* data) const;
+
+   public:
+    BlockChecksums();
+
+    static int32_t calc_n_csum_blocks(int32_t n_blocks, int32_t block_size);
+
+    void load(Disk& disk, const super_block& MB);
+    void store(Disk& disk);
+    void rebuild(Disk& disk, int32_t first_block_n);
+    void disable();
+    bool is_enabled() const { return !table.empty(); };
+
+    void update(int32_t block_n, const uint8_t* data);
+    bool verify(int32_t block_n, const uint8_t* data);
+
+    int64_t get_n_verified() const { return n_verified; };
+    int64_t get_n_mismatches() const { return n_mismatches; };
+};
+}
+#endif
@@ -0,0 +1,68 @@
+#ifndef FSFS_BLOCK_GEOMETRY_HPP
+#define FSFS_BLOCK_GEOMETRY_HPP
+#include "common/types.hpp"
+#include "data_structs.hpp"
+
+namespace FSFS {
+// Specialized selects the constexpr arithmetic for the block sizes it exists for,
+// Generic always divides by the block size read from the super block.
+enum class BlockArithmetic { Specialized, Generic };
+
+// Block size arithmetic of any size, used for the sizes without a fixed variant. Byte
+// counts must not be negative.
+class BlockGeometry {
+   private:
+    int32_t block_size;
+
+   public:
+    explicit BlockGeometry(int32_t block_size) : block_size(block_size) {}
+
+    int32_t size() const { return block_size; }
+    int32_t block_of(int32_t n_bytes) const { return n_bytes / block_size; }
+    int32_t offset_in_block(int32_t n_bytes) const { return n_bytes % block_size; }
+    int32_t blocks_for(int32_t n_bytes) const { return (n_bytes + block_size - 1) / block_size; }
+    int32_t n_addresses() const { return block_size / sizeof(int32_t); }
+    int32_t n_inodes() const { return block_size / meta_fragm_size_bytes; }
+};
+
+// Same arithmetic for a power of two size known at the compile time, divisions become
+// shifts and masks. Takes the block size only to be built the same way as BlockGeometry.
+template <int32_t BlockSize>
+class FixedBlockGeometry {
+   private:
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0, "Block size must be a power of two.");
+
+    static constexpr int32_t log2(int32_t value) { return value > 1 ? 1 + log2(value >> 1) : 0; }
+
+   public:
+    static constexpr int32_t shift = log2(BlockSize);
+    static constexpr int32_t mask = BlockSize - 1;
+
+    explicit constexpr FixedBlockGeometry(int32_t = BlockSize) {}
+
+    static constexpr int32_t size() { return BlockSize; }
+    static constexpr int32_t block_of(int32_t n_bytes) { return n_bytes >> shift; }
+    static constexpr int32_t offset_in_block(int32_t n_bytes) { return n_bytes & mask; }
+    static constexpr int32_t blocks_for(int32_t n_bytes) { return (n_bytes + mask) >> shift; }
+    static constexpr int32_t n_addresses() { return BlockSize / sizeof(int32_t); }
+    static constexpr int32_t n_inodes() { return BlockSize / meta_fragm_size_bytes; }
+};
+
+// Calls fn with the geometry of block_size, fixed one for 1024, 2048 and 4096 unless
+// the generic arithmetic is asked for.
+template <typename Fn>
+decltype(auto) dispatch_block_geometry(int32_t block_size, BlockArithmetic arithmetic, Fn&& fn) {
+    if (arithmetic == BlockArithmetic::Specialized) {
+        switch (block_size) {
+            case 1024:
+                return fn(FixedBlockGeometry<1024>());
+            case 2048:
+                return fn(FixedBlockGeometry<2048>());
+            case 4096:
+                return fn(FixedBlockGeometry<4096>());
+        }
+    }
+    return fn(BlockGeometry(block_size));
+}
+}
+#endif
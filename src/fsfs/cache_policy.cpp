@@ -0,0 +1,221 @@
+#include "cache_policy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace FSFS {
+void EntryQueue::reset(std::vector<Link>& links) {
+    this->links = &links;
+    head = fs_nullptr;
+    tail = fs_nullptr;
+    length = 0;
+}
+
+void EntryQueue::push_front(int32_t entry_n) {
+    (*links)[entry_n] = {fs_nullptr, head};
+    if (head != fs_nullptr) {
+        (*links)[head].prev = entry_n;
+    } else {
+        tail = entry_n;
+    }
+    head = entry_n;
+    length++;
+}
+
+void EntryQueue::push_back(int32_t entry_n) {
+    (*links)[entry_n] = {tail, fs_nullptr};
+    if (tail != fs_nullptr) {
+        (*links)[tail].next = entry_n;
+    } else {
+        head = entry_n;
+    }
+    tail = entry_n;
+    length++;
+}
+
+void EntryQueue::remove(int32_t entry_n) {
+    Link& link = (*links)[entry_n];
+    if (link.prev != fs_nullptr) {
+        (*links)[link.prev].next = link.next;
+    } else {
+        head = link.next;
+    }
+
+    if (link.next != fs_nullptr) {
+        (*links)[link.next].prev = link.prev;
+    } else {
+        tail = link.prev;
+    }
+    length--;
+}
+
+std::unique_ptr<CacheReplacer> CacheReplacer::make(CachePolicy policy) {
+    switch (policy) {
+        case CachePolicy::Lru:
+            return std::make_unique<LruReplacer>();
+        case CachePolicy::TwoQ:
+            return std::make_unique<TwoQReplacer>();
+    }
+    throw std::invalid_argument("Unknown cache policy.");
+}
+
+// All entries free, the last one is reused first.
+void CacheReplacer::reset(int32_t n_entries) {
+    links.resize(n_entries);
+    pinned.assign(n_entries, false);
+    free_entries.reset(links);
+    for (int32_t entry_n = 0; entry_n < n_entries; entry_n++) {
+        free_entries.push_back(entry_n);
+    }
+}
+
+int32_t CacheReplacer::last_unpinned(const EntryQueue& queue) const {
+    int32_t entry_n = queue.back();
+    while (entry_n != fs_nullptr && pinned[entry_n]) {
+        entry_n = queue.prev(entry_n);
+    }
+    return entry_n;
+}
+
+void LruReplacer::reset(int32_t n_entries) {
+    CacheReplacer::reset(n_entries);
+    lru.reset(links);
+}
+
+void LruReplacer::on_hit(int32_t entry_n) {
+    if (lru.front() != entry_n) {
+        lru.remove(entry_n);
+        lru.push_front(entry_n);
+    }
+}
+
+void LruReplacer::on_insert(int32_t entry_n, int32_t, int32_t evicted_block_n) {
+    if (evicted_block_n == fs_nullptr) {
+        free_entries.remove(entry_n);
+    } else {
+        lru.remove(entry_n);
+    }
+    lru.push_front(entry_n);
+}
+
+void LruReplacer::on_free(int32_t entry_n) {
+    lru.remove(entry_n);
+    free_entries.push_back(entry_n);
+}
+
+int32_t LruReplacer::victim() const {
+    int32_t entry_n = last_unpinned(free_entries);
+    return entry_n != fs_nullptr ? entry_n : last_unpinned(lru);
+}
+
+TwoQReplacer::TwoQReplacer()
+    : n_inserts(0), max_in(1), next_ghost_n(0),
+      ghost_lut(0, std::hash<int32_t>(), std::equal_to<int32_t>(), GhostLut::allocator_type(ghost_pool)) {}
+
+// A1in takes a quarter of the entries, A1out remembers half as many blocks as the cache holds.
+void TwoQReplacer::reset(int32_t n_entries) {
+    CacheReplacer::reset(n_entries);
+    a1_in.reset(links);
+    a_main.reset(links);
+    entry_queue.assign(n_entries, Queue::None);
+    entry_insert_n.assign(n_entries, 0);
+    n_inserts = 0;
+    max_in = std::max(1, n_entries / 4);
+
+    ghosts.assign(std::max(1, n_entries / 2), fs_nullptr);
+    next_ghost_n = 0;
+    ghost_lut.clear();
+    ghost_lut.reserve(ghosts.size());
+    ghost_pool.reserve(ghosts.size());
+}
+
+// Oldest ghost is dropped, a block remembered twice keeps only its newest slot.
+void TwoQReplacer::remember(int32_t block_n) {
+    int32_t old_block_n = ghosts[next_ghost_n];
+    if (old_block_n != fs_nullptr) {
+        auto it = ghost_lut.find(old_block_n);
+        if (it != ghost_lut.end() && it->second == next_ghost_n) {
+            ghost_lut.erase(it);
+        }
+    }
+
+    ghosts[next_ghost_n] = block_n;
+    ghost_lut[block_n] = next_ghost_n;
+    next_ghost_n = (next_ghost_n + 1) % ghosts.size();
+}
+
+bool TwoQReplacer::forget(int32_t block_n) {
+    auto it = ghost_lut.find(block_n);
+    if (it == ghost_lut.end()) {
+        return false;
+    }
+
+    ghosts[it->second] = fs_nullptr;
+    ghost_lut.erase(it);
+    return true;
+}
+
+void TwoQReplacer::on_hit(int32_t entry_n) {
+    if (entry_queue[entry_n] == Queue::In && n_inserts - entry_insert_n[entry_n] > max_in) {
+        a1_in.remove(entry_n);
+        a_main.push_front(entry_n);
+        entry_queue[entry_n] = Queue::Main;
+        return;
+    }
+
+    if (entry_queue[entry_n] == Queue::Main && a_main.front() != entry_n) {
+        a_main.remove(entry_n);
+        a_main.push_front(entry_n);
+    }
+}
+
+void TwoQReplacer::on_insert(int32_t entry_n, int32_t block_n, int32_t evicted_block_n) {
+    // Looked up before the evicted block takes the oldest ghost slot
+    bool is_ghost = forget(block_n);
+
+    switch (entry_queue[entry_n]) {
+        case Queue::None:
+            free_entries.remove(entry_n);
+            break;
+        case Queue::In:
+            a1_in.remove(entry_n);
+            remember(evicted_block_n);
+            break;
+        case Queue::Main:
+            a_main.remove(entry_n);
+            break;
+    }
+
+    entry_insert_n[entry_n] = ++n_inserts;
+    if (is_ghost) {
+        a_main.push_front(entry_n);
+        entry_queue[entry_n] = Queue::Main;
+    } else {
+        a1_in.push_front(entry_n);
+        entry_queue[entry_n] = Queue::In;
+    }
+}
+
+void TwoQReplacer::on_free(int32_t entry_n) {
+    if (entry_queue[entry_n] == Queue::In) {
+        a1_in.remove(entry_n);
+    } else if (entry_queue[entry_n] == Queue::Main) {
+        a_main.remove(entry_n);
+    }
+    entry_queue[entry_n] = Queue::None;
+    free_entries.push_back(entry_n);
+}
+
+// A1in gives up its oldest block while over its share, otherwise the working set does.
+int32_t TwoQReplacer::victim() const {
+    int32_t entry_n = last_unpinned(free_entries);
+    if (entry_n != fs_nullptr) {
+        return entry_n;
+    }
+
+    const EntryQueue& first = a1_in.size() > max_in ? a1_in : a_main;
+    const EntryQueue& second = a1_in.size() > max_in ? a_main : a1_in;
+    entry_n = last_unpinned(first);
+    return entry_n != fs_nullptr ? entry_n : last_unpinned(second);
+}
+}
@@ -0,0 +1,121 @@
+#ifndef FSFS_CACHE_POLICY_HPP
+#define FSFS_CACHE_POLICY_HPP
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "common/pool_allocator.hpp"
+#include "common/types.hpp"
+#include "data_structs.hpp"
+
+namespace FSFS {
+// Lru evicts the least recently used block. TwoQ keeps blocks used once in a
+// small FIFO, so a sweep over many blocks cannot push out the ones used again.
+enum class CachePolicy { Lru, TwoQ };
+
+// Chain of cache entries linked by index, links of all queues live in one array
+// since an entry belongs to one queue at most.
+class EntryQueue {
+   private:
+    struct Link {
+        int32_t prev;
+        int32_t next;
+    };
+
+    std::vector<Link>* links;
+    int32_t head;
+    int32_t tail;
+    int32_t length;
+
+   public:
+    EntryQueue() : links(nullptr), head(fs_nullptr), tail(fs_nullptr), length(0){};
+
+    void reset(std::vector<Link>& links);
+    void push_front(int32_t entry_n);
+    void push_back(int32_t entry_n);
+    void remove(int32_t entry_n);
+    int32_t front() const { return head; };
+    int32_t back() const { return tail; };
+    int32_t prev(int32_t entry_n) const { return (*links)[entry_n].prev; };
+    int32_t size() const { return length; };
+
+    using Links = std::vector<Link>;
+};
+
+// Decides which cache entry is reused by the next insert. Entries are known by
+// index only, the cache keeps the blocks. Free entries are always reused first
+// and pinned entries are never chosen.
+class CacheReplacer {
+   protected:
+    EntryQueue::Links links;
+    EntryQueue free_entries;
+    std::vector<bool> pinned;
+
+    int32_t last_unpinned(const EntryQueue& queue) const;
+
+   public:
+    virtual ~CacheReplacer() = default;
+
+    virtual void reset(int32_t n_entries);
+    virtual void on_hit(int32_t entry_n) = 0;
+    virtual void on_insert(int32_t entry_n, int32_t block_n, int32_t evicted_block_n) = 0;
+    virtual void on_free(int32_t entry_n) = 0;
+    virtual int32_t victim() const = 0;
+    // Most blocks inserted in a row before the policy starts evicting the ones just inserted
+    virtual int32_t max_admitted() const { return static_cast<int32_t>(links.size()) - 1; };
+    void set_pinned(int32_t entry_n, bool is_pinned) noexcept { pinned[entry_n] = is_pinned; };
+
+    static std::unique_ptr<CacheReplacer> make(CachePolicy policy);
+};
+
+class LruReplacer : public CacheReplacer {
+   private:
+    EntryQueue lru;
+
+   public:
+    void reset(int32_t n_entries) override;
+    void on_hit(int32_t entry_n) override;
+    void on_insert(int32_t entry_n, int32_t block_n, int32_t evicted_block_n) override;
+    void on_free(int32_t entry_n) override;
+    int32_t victim() const override;
+};
+
+// 2Q (Johnson, Shasha). New blocks enter the A1in FIFO, hits there within the correlation
+// window of max_in newer inserts do not promote them. Blocks leaving A1in are remembered in
+// the A1out ghost list, a block missed again while remembered goes straight to the Am LRU
+// queue of the working set. A later hit in A1in promotes too, so A1in filled past its share
+// while the cache was empty drains into Am.
+class TwoQReplacer : public CacheReplacer {
+   private:
+    enum class Queue : uint8_t { None, In, Main };
+    using GhostLut = std::unordered_map<int32_t, int32_t, std::hash<int32_t>, std::equal_to<int32_t>,
+                                        PoolAllocator<std::pair<const int32_t, int32_t>>>;
+
+    EntryQueue a1_in;
+    EntryQueue a_main;
+    std::vector<Queue> entry_queue;
+    std::vector<int64_t> entry_insert_n;
+    int64_t n_inserts;
+    int32_t max_in;
+
+    std::vector<int32_t> ghosts;
+    int32_t next_ghost_n;
+    NodePool ghost_pool;
+    GhostLut ghost_lut;
+
+    void remember(int32_t block_n);
+    bool forget(int32_t block_n);
+
+   public:
+    TwoQReplacer();
+
+    void reset(int32_t n_entries) override;
+    void on_hit(int32_t entry_n) override;
+    void on_insert(int32_t entry_n, int32_t block_n, int32_t evicted_block_n) override;
+    void on_free(int32_t entry_n) override;
+    int32_t victim() const override;
+    int32_t max_admitted() const override { return std::min(max_in, static_cast<int32_t>(links.size()) - 1); };
+};
+}
+#endif
@@ -0,0 +1,177 @@
+#include "crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace FSFS {
+namespace {
+constexpr uint32_t crc32c_poly = 0x82F63B78;  // Reversed 0x1EDC6F41
+constexpr int32_t n_slices = 8;
+
+using SliceTables = std::array<std::array<uint32_t, 256>, n_slices>;
+
+// Table k advances the CRC of a byte followed by k zero bytes, so 8 bytes are folded per step.
+constexpr SliceTables make_slice_tables() {
+    SliceTables tables{};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for (int32_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (crc & 1 ? crc32c_poly : 0);
+        }
+        tables[0][byte] = crc;
+    }
+
+    for (int32_t slice = 1; slice < n_slices; slice++) {
+        for (uint32_t byte = 0; byte < 256; byte++) {
+            uint32_t prev = tables[slice - 1][byte];
+            tables[slice][byte] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr SliceTables slice_tables = make_slice_tables();
+
+#if defined(__x86_64__)
+constexpr size_t lane_size = 256;
+
+using Gf2Matrix = std::array<uint32_t, 32>;
+using ShiftTables = std::array<std::array<uint32_t, 256>, 4>;
+
+constexpr uint32_t gf2_matrix_times(const Gf2Matrix& mat, uint32_t vec) {
+    uint32_t sum = 0;
+    for (int32_t row = 0; vec != 0; vec >>= 1, row++) {
+        sum ^= vec & 1 ? mat[row] : 0;
+    }
+    return sum;
+}
+
+constexpr Gf2Matrix gf2_matrix_square(const Gf2Matrix& mat) {
+    Gf2Matrix square{};
+    for (int32_t row = 0; row < 32; row++) {
+        square[row] = gf2_matrix_times(mat, mat[row]);
+    }
+    return square;
+}
+
+// Table k applies to byte k of a CRC the operator appending lane_size zero bytes to the data.
+// Operator for one zero bit is squared up to 8 * lane_size bits, lane_size is a power of two.
+constexpr ShiftTables make_shift_tables() {
+    Gf2Matrix op{};
+    op[0] = crc32c_poly;
+    for (int32_t row = 1; row < 32; row++) {
+        op[row] = 1u << (row - 1);
+    }
+    for (size_t n_bits = 1; n_bits < 8 * lane_size; n_bits *= 2) {
+        op = gf2_matrix_square(op);
+    }
+
+    ShiftTables tables{};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        for (int32_t k = 0; k < 4; k++) {
+            tables[k][byte] = gf2_matrix_times(op, byte << (8 * k));
+        }
+    }
+    return tables;
+}
+
+constexpr ShiftTables shift_tables = make_shift_tables();
+
+uint32_t shift_lane(uint32_t crc) {
+    return shift_tables[0][crc & 0xFF] ^ shift_tables[1][(crc >> 8) & 0xFF] ^ shift_tables[2][(crc >> 16) & 0xFF] ^
+           shift_tables[3][crc >> 24];
+}
+
+// crc32 instruction takes 3 cycles but issues every cycle, so three lanes of lane_size bytes
+// are folded at once and joined by shifting the CRC of the earlier lane past the next one.
+__attribute__((target("sse4.2"))) uint32_t crc32c_sse42(const uint8_t* data, size_t length, uint32_t crc) {
+    uint64_t crc0 = ~crc;
+    for (; length >= 3 * lane_size; length -= 3 * lane_size, data += 3 * lane_size) {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        for (size_t offset = 0; offset < lane_size; offset += sizeof(uint64_t)) {
+            uint64_t words[3];
+            std::memcpy(&words[0], data + offset, sizeof(uint64_t));
+            std::memcpy(&words[1], data + lane_size + offset, sizeof(uint64_t));
+            std::memcpy(&words[2], data + 2 * lane_size + offset, sizeof(uint64_t));
+            crc0 = _mm_crc32_u64(crc0, words[0]);
+            crc1 = _mm_crc32_u64(crc1, words[1]);
+            crc2 = _mm_crc32_u64(crc2, words[2]);
+        }
+        crc0 = shift_lane(crc0) ^ crc1;
+        crc0 = shift_lane(crc0) ^ crc2;
+    }
+
+    for (; length >= sizeof(uint64_t); length -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc0 = _mm_crc32_u64(crc0, word);
+    }
+
+    uint32_t crc32 = crc0;
+    for (; length > 0; length--, data++) {
+        crc32 = _mm_crc32_u8(crc32, *data);
+    }
+    return ~crc32;
+}
+#endif
+
+using Crc32cFunc = uint32_t (*)(const uint8_t*, size_t, uint32_t);
+
+Crc32cFunc select_crc32c() {
+#if defined(__x86_64__)
+    if (crc32c_hw_supported()) {
+        return crc32c_sse42;
+    }
+#endif
+    return crc32c_portable;
+}
+
+const Crc32cFunc crc32c_impl = select_crc32c();
+}
+
+// Slicing-by-8, little endian hosts only like the rest of the on-disk format.
+uint32_t crc32c_portable(const uint8_t* data, size_t length, uint32_t crc) {
+    crc = ~crc;
+    for (; length >= n_slices; length -= n_slices, data += n_slices) {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, data, sizeof(low));
+        std::memcpy(&high, data + sizeof(low), sizeof(high));
+        low ^= crc;
+        crc = slice_tables[7][low & 0xFF] ^ slice_tables[6][(low >> 8) & 0xFF] ^ slice_tables[5][(low >> 16) & 0xFF] ^
+              slice_tables[4][low >> 24] ^ slice_tables[3][high & 0xFF] ^ slice_tables[2][(high >> 8) & 0xFF] ^
+              slice_tables[1][(high >> 16) & 0xFF] ^ slice_tables[0][high >> 24];
+    }
+
+    for (; length > 0; length--, data++) {
+        crc = (crc >> 8) ^ slice_tables[0][(crc ^ *data) & 0xFF];
+    }
+    return ~crc;
+}
+
+uint32_t crc32c_hw(const uint8_t* data, size_t length, uint32_t crc) {
+#if defined(__x86_64__)
+    if (crc32c_hw_supported()) {
+        return crc32c_sse42(data, length, crc);
+    }
+#endif
+    return crc32c_portable(data, length, crc);
+}
+
+bool crc32c_hw_supported() {
+#if defined(__x86_64__)
+    // Also used by a static initializer, CPU model may not be probed yet
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+uint32_t crc32c(const uint8_t* data, size_t length, uint32_t crc) { return crc32c_impl(data, length, crc); }
+}
@@ -0,0 +1,15 @@
+#ifndef FSFS_CRC32C_HPP
+#define FSFS_CRC32C_HPP
+#include <stddef.h>
+
+#include "common/types.hpp"
+
+namespace FSFS {
+// CRC-32C (Castagnoli), the polynomial with hardware support on x86 since SSE4.2.
+// crc32c() picks the fastest implementation available on the host at startup.
+uint32_t crc32c(const uint8_t* data, size_t length, uint32_t crc = 0);
+uint32_t crc32c_portable(const uint8_t* data, size_t length, uint32_t crc = 0);
+uint32_t crc32c_hw(const uint8_t* data, size_t length, uint32_t crc = 0);
+bool crc32c_hw_supported();
+}
+#endif
@@ -6,7 +6,7 @@
 #include "common/types.hpp"
 namespace FSFS {
 constexpr int16_t fs_system_major = 1;
-constexpr int16_t fs_system_minor = 2;
+constexpr int16_t fs_system_minor = 4;
 constexpr int32_t fs_data_row_size = sizeof(int32_t);
 
 constexpr int32_t meta_fragm_size_bytes = 64;
@@ -19,6 +19,13 @@ constexpr int32_t fs_offset_inode_block = 1;
 const uint8_t meta_magic_seq_lut[] = {0xDE, 0xAD, 0xC0, 0xDE};
 const char inode_default_file_name[] = "././DuMmY !@#$%^&*() fIlE nAmE";
 constexpr int32_t fs_nullptr = 0xFFFFFFFF;
+
+// Optional features chosen at format time, stored in the super block
+constexpr uint32_t fs_feature_block_checksums = 0x1;
+constexpr uint32_t fs_feature_allocation_bitmaps = 0x2;
+
+// State of the image kept in the super block, clean is cleared for as long as it is mounted
+constexpr uint32_t fs_state_clean = 0x1;
 static_assert(sizeof(inode_default_file_name) < meta_max_file_name_size);
 
 enum class block_status : uint8_t { Free = 0UL, Used };
@@ -31,7 +38,12 @@ struct super_block {
     int32_t n_data_blocks;
     int16_t fs_ver_major;
     int16_t fs_ver_minor;
-    uint8_t _padding[36];
+    uint32_t features;
+    int32_t n_csum_blocks;
+    int32_t n_bitmap_blocks;
+    uint32_t state;
+    uint32_t bitmaps_crc;
+    uint8_t _padding[16];
     uint32_t checksum;
 } __attribute__((aligned(fs_data_row_size)));
 static_assert(sizeof(super_block) == meta_fragm_size_bytes);
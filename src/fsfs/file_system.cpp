@@ -3,16 +3,36 @@
 #include <algorithm>
 #include <cstring>
 
+#include "crc32c.hpp"
+
 namespace FSFS {
 
 void FileSystem::mount() {
     disk.mount();
     read_super_block(disk, MB);
+    select_block_arithmetic();
     inode_bitmap.resize(MB.n_inode_blocks);
     data_bitmap.resize(MB.n_data_blocks);
     block.resize();
+    read_ahead.reset();
+
+    // Checksums of an image that was not unmounted may be older than its blocks, they are rebuilt
+    // before the scan reads the inodes
+    if ((MB.features & fs_feature_allocation_bitmaps) && !(MB.state & fs_state_clean)) {
+        block.rebuild_checksums();
+    }
+
+    // Bitmaps stored by a clean unmount are taken as they are, any other image is scanned. The image
+    // stays unclean until unmounted, so a crash in between ends in a scan
+    is_scanned = !((MB.state & fs_state_clean) && load_bitmaps());
+    if (is_scanned) {
+        scan_blocks();
+    }
 
-    scan_blocks();
+    if (MB.features & fs_feature_allocation_bitmaps) {
+        MB.state &= ~fs_state_clean;
+        write_super_block(disk, MB);
+    }
 }
 
 void FileSystem::read_super_block(Disk& disk, super_block& MB) {
@@ -44,27 +64,148 @@ void FileSystem::read_super_block(Disk& disk, super_block& MB) {
     disk.unmount();
 }
 
-void FileSystem::unmount() { disk.unmount(); }
+void FileSystem::write_super_block(Disk& disk, super_block& MB) {
+    MB.checksum = calc_mb_checksum(MB);
+    if (disk.write(fs_offset_super_block, cast_to_data(&MB), meta_fragm_size_bytes) != meta_fragm_size_bytes) {
+        throw std::runtime_error("Cannot write super block");
+    }
+}
+
+void FileSystem::unmount() {
+    block.flush();
+    if (MB.features & fs_feature_allocation_bitmaps) {
+        store_bitmaps(disk, MB, inode_bitmap, data_bitmap);
+        MB.state |= fs_state_clean;
+        write_super_block(disk, MB);
+    }
+    disk.unmount();
+}
+
+// Inode rows followed by data rows, both stored whole. Blocks are sized for the rows of the disk
+// before they were taken from the data blocks, so they always fit.
+int32_t FileSystem::calc_n_bitmap_blocks(int32_t n_inodes, int32_t n_data_blocks, int32_t block_size) {
+    int64_t n_rows = BlockBitmap::calc_n_rows(n_inodes) + BlockBitmap::calc_n_rows(n_data_blocks);
+    int64_t rows_size = n_rows * sizeof(bitmap_t);
+    return (rows_size + block_size - 1) / block_size;
+}
+
+// Stored in one write, the CRC32C of all bitmap blocks is kept in the super block written after.
+void FileSystem::store_bitmaps(Disk& disk, super_block& MB, const BlockBitmap& inode_bitmap,
+                               const BlockBitmap& data_bitmap) {
+    AlignedBuffer bitmap_blocks(static_cast<size_t>(MB.n_bitmap_blocks) * MB.block_size);
+    const auto& inode_rows = inode_bitmap.get_rows();
+    const auto& data_rows = data_bitmap.get_rows();
+    bitmap_t* rows = reinterpret_cast<bitmap_t*>(bitmap_blocks.data());
+    std::copy(data_rows.begin(), data_rows.end(), std::copy(inode_rows.begin(), inode_rows.end(), rows));
+
+    int32_t first_bitmap_block_n = fs_offset_super_block + 1;
+    if (disk.write_blocks(first_bitmap_block_n, MB.n_bitmap_blocks, bitmap_blocks.data()) != MB.n_bitmap_blocks) {
+        throw std::runtime_error("Cannot write allocation bitmaps.");
+    }
+    MB.bitmaps_crc = crc32c(bitmap_blocks.data(), bitmap_blocks.size());
+}
+
+// False when the image has no stored bitmaps or they do not match their checksum.
+bool FileSystem::load_bitmaps() {
+    if (!(MB.features & fs_feature_allocation_bitmaps) ||
+        MB.n_bitmap_blocks < calc_n_bitmap_blocks(MB.n_inode_blocks, MB.n_data_blocks, MB.block_size)) {
+        return false;
+    }
 
-void FileSystem::format(Disk& disk) {
+    AlignedBuffer bitmap_blocks(static_cast<size_t>(MB.n_bitmap_blocks) * MB.block_size);
+    int32_t first_bitmap_block_n = fs_offset_super_block + 1;
+    if (disk.read_blocks(first_bitmap_block_n, MB.n_bitmap_blocks, bitmap_blocks.data()) != MB.n_bitmap_blocks ||
+        crc32c(bitmap_blocks.data(), bitmap_blocks.size()) != MB.bitmaps_crc) {
+        return false;
+    }
+
+    const bitmap_t* rows = reinterpret_cast<const bitmap_t*>(bitmap_blocks.data());
+    inode_bitmap.load_rows(rows);
+    data_bitmap.load_rows(rows + BlockBitmap::calc_n_rows(MB.n_inode_blocks));
+    return true;
+}
+
+void FileSystem::flush() { block.flush(); }
+
+void FileSystem::set_write_mode(WriteMode mode, int32_t n_dirty_limit) { block.set_write_mode(mode, n_dirty_limit); }
+
+// Read-ahead window is narrowed to what the new policy admits at once.
+void FileSystem::set_cache_policy(CachePolicy policy) {
+    block.set_cache_policy(policy);
+    read_ahead.set_max_window(std::min(read_ahead.get_max_window(), block.get_cache().get_max_admitted()));
+}
+
+// Kept over remounts, the policy state starts over at every mount.
+void FileSystem::set_alloc_policy(AllocPolicy policy) {
+    inode_bitmap.set_alloc_policy(policy);
+    data_bitmap.set_alloc_policy(policy);
+}
+
+void FileSystem::set_block_arithmetic(BlockArithmetic new_arithmetic) {
+    arithmetic = new_arithmetic;
+    select_block_arithmetic();
+}
+
+// Unmounted file system has no block size yet, the generic paths reject every inode anyway.
+void FileSystem::select_block_arithmetic() {
+    dispatch_block_geometry(MB.block_size, arithmetic, [this](auto geometry) {
+        using Geometry = decltype(geometry);
+        read_fn = &FileSystem::read_as<Geometry>;
+        write_fn = &FileSystem::write_as<Geometry>;
+        read_view_fn = &FileSystem::read_view_as<Geometry>;
+    });
+}
+
+// Prefetched blocks must fit in the share of the block cache the policy admits new blocks to, TwoQ
+// would otherwise evict the start of a batch to make room for its end.
+void FileSystem::set_read_ahead(int32_t max_window) {
+    if (max_window > block.get_cache().get_max_admitted()) {
+        throw std::invalid_argument("Read-ahead window must fit in the share of the block cache new blocks enter.");
+    }
+
+    read_ahead.set_max_window(max_window);
+}
+
+// Block checksums take the last blocks of the disk, the table starts zeroed so nothing is verified
+// until it is written once. Allocation bitmaps follow the super block, stored empty and clean.
+void FileSystem::format(Disk& disk, uint32_t features) {
     int32_t real_disk_size = disk.get_disk_size() - 1;
 
     super_block MB_to_write = {};
     MB_to_write.block_size = disk.get_block_size();
     MB_to_write.n_blocks = disk.get_disk_size();
     MB_to_write.n_inode_blocks = real_disk_size * 0.1;
-    MB_to_write.n_data_blocks = real_disk_size - MB_to_write.n_inode_blocks;
+    MB_to_write.features = features;
+    if (features & fs_feature_block_checksums) {
+        MB_to_write.n_csum_blocks = BlockChecksums::calc_n_csum_blocks(MB_to_write.n_blocks, MB_to_write.block_size);
+    }
+    MB_to_write.n_data_blocks = real_disk_size - MB_to_write.n_inode_blocks - MB_to_write.n_csum_blocks;
+    if (features & fs_feature_allocation_bitmaps) {
+        MB_to_write.n_bitmap_blocks =
+            calc_n_bitmap_blocks(MB_to_write.n_inode_blocks, MB_to_write.n_data_blocks, MB_to_write.block_size);
+        MB_to_write.n_data_blocks -= MB_to_write.n_bitmap_blocks;
+        MB_to_write.state = fs_state_clean;
+    }
     MB_to_write.fs_ver_major = fs_system_major;
     MB_to_write.fs_ver_minor = fs_system_minor;
     memcpy(MB_to_write.magic_number, meta_magic_seq_lut, sizeof(meta_magic_seq_lut));
-    MB_to_write.checksum = calc_mb_checksum(MB_to_write);
 
     disk.mount();
-    disk.write(fs_offset_super_block, cast_to_data(&MB_to_write), meta_fragm_size_bytes);
+    if (MB_to_write.n_bitmap_blocks > 0) {
+        store_bitmaps(disk, MB_to_write, BlockBitmap(MB_to_write.n_inode_blocks),
+                      BlockBitmap(MB_to_write.n_data_blocks));
+    }
+    write_super_block(disk, MB_to_write);
+    if (MB_to_write.n_csum_blocks > 0) {
+        AlignedBuffer zero_blocks(MB_to_write.n_csum_blocks * MB_to_write.block_size);
+        int32_t first_csum_block_n = MB_to_write.n_blocks - MB_to_write.n_csum_blocks;
+        disk.write_blocks(first_csum_block_n, MB_to_write.n_csum_blocks, zero_blocks.data());
+    }
     disk.unmount();
 
     Inode inode;
     Block block(disk, MB_to_write);
+    block.set_write_mode(WriteMode::WriteBack);
     BlockBitmap dummy_bitmap(real_disk_size);
     for (int32_t inode_n = 0; inode_n < MB_to_write.n_inode_blocks; inode_n++) {
         inode.load(inode_n, block);
@@ -72,6 +213,7 @@ void FileSystem::format(Disk& disk) {
         inode.meta().file_len = 0;
         inode.commit(block, dummy_bitmap);
     }
+    block.flush();
 }
 
 uint32_t FileSystem::calc_mb_checksum(super_block& MB) {
@@ -103,7 +245,9 @@ void FileSystem::set_data_blocks_status(int32_t inode_n, bool status) {
     }
 }
 
-int32_t FileSystem::edit_data(int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length) {
+template <typename Geometry>
+int32_t FileSystem::edit_data(const Geometry& geometry, int32_t inode_n, const uint8_t* wdata, int32_t offset,
+                              int32_t length) {
     using std::min;
 
     if (offset == 0) {
@@ -119,18 +263,18 @@ int32_t FileSystem::edit_data(int32_t inode_n, const uint8_t* wdata, int32_t off
     }
 
     // Step 2: Edit tail in last uint8_t block
-    int32_t ptr_n = abs_offset / MB.block_size;
-    int32_t first_offset = abs_offset % MB.block_size;
+    int32_t ptr_n = geometry.block_of(abs_offset);
+    int32_t first_offset = geometry.offset_in_block(abs_offset);
     int32_t n_written_bytes = block.write(block.data_n_to_block_n(inode.ptr(ptr_n)), wdata, first_offset,
-                                        min(MB.block_size - first_offset, length));
+                                        min(geometry.size() - first_offset, length));
     ptr_n += 1;
 
     // Step 3: Edit full blocks of uint8_t
     if (length - n_written_bytes > 0) {
-        int32_t blocks_to_edit = block.bytes_to_blocks(length);
+        int32_t blocks_to_edit = geometry.blocks_for(length);
         for (auto i = 0; i < blocks_to_edit; i++) {
             int32_t addr = block.data_n_to_block_n(inode.ptr(ptr_n));
-            int32_t write_length = min(MB.block_size, length - n_written_bytes);
+            int32_t write_length = min(geometry.size(), length - n_written_bytes);
             n_written_bytes += block.write(addr, &wdata[n_written_bytes], 0, write_length);
             ptr_n++;
         }
@@ -139,7 +283,8 @@ int32_t FileSystem::edit_data(int32_t inode_n, const uint8_t* wdata, int32_t off
     return n_written_bytes;
 }
 
-int32_t FileSystem::write(int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length) {
+template <typename Geometry>
+int32_t FileSystem::write_as(int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length) {
     using std::max;
     using std::min;
 
@@ -151,22 +296,28 @@ int32_t FileSystem::write(int32_t inode_n, const uint8_t* wdata, int32_t offset,
         return 0;
     }
 
+    const Geometry geometry(MB.block_size);
     inode.load(inode_n, block);
 
-    // Step 1: Check if there is uint8_t to edit
+    // Step 1: Nothing is written when new data and indirect blocks do not fit in the free blocks
     //
-    int32_t n_eddited_bytes = edit_data(inode_n, wdata, offset, min(length, offset));
-    if (n_eddited_bytes == length || n_eddited_bytes == fs_nullptr) {
-        return n_eddited_bytes;
+    int32_t n_ptr_used = geometry.blocks_for(inode.meta().file_len);
+    int32_t free_bytes = n_ptr_used * geometry.size() - inode.meta().file_len;
+    int32_t blocks_of_new_data = geometry.blocks_for(max(0, length - free_bytes - min(length, offset)));
+    int32_t n_new_indirect_blocks = IndirectInode::calc_n_blocks(n_ptr_used + blocks_of_new_data, geometry.n_addresses()) -
+                                    IndirectInode::calc_n_blocks(n_ptr_used, geometry.n_addresses());
+    if (blocks_of_new_data + n_new_indirect_blocks > data_bitmap.get_n_free()) {
+        return fs_nullptr;
     }
 
-    // Step 2: Prepare informations to allocate new uint8_t blocks
+    // Step 2: Check if there is uint8_t to edit
     //
+    int32_t n_eddited_bytes = edit_data(geometry, inode_n, wdata, offset, min(length, offset));
+    if (n_eddited_bytes == length || n_eddited_bytes == fs_nullptr) {
+        return n_eddited_bytes;
+    }
     const uint8_t* wdata_new_p = &wdata[n_eddited_bytes];
     int32_t n_written = 0;
-    int32_t n_ptr_used = block.bytes_to_blocks(inode.meta().file_len);
-    int32_t free_bytes = n_ptr_used * MB.block_size - inode.meta().file_len;
-    int32_t blocks_of_new_data = block.bytes_to_blocks(max(0, length - free_bytes - n_eddited_bytes));
 
     // Step 3: Store new uint8_t in already allocated block
     //
@@ -176,34 +327,49 @@ int32_t FileSystem::write(int32_t inode_n, const uint8_t* wdata, int32_t offset,
         n_written += block.write(addr, wdata_new_p, -free_bytes, free_bytes);
     }
 
-    // Step 4: Store uint8_t in new allocated blocks
+    // Step 4: Allocate new blocks in runs chosen by the allocation policy, hinted with the file end.
+    // Full blocks are gathered and written in one call
     //
-    for (auto i = 0; i < blocks_of_new_data; i++) {
-        // Allocate new block
-        int32_t data_n = data_bitmap.next_free(0);
-        if (data_n == fs_nullptr) {
+    write_vecs.clear();
+    int32_t hint = n_ptr_used > 0 ? inode.ptr(n_ptr_used - 1) + 1 : fs_nullptr;
+    for (int32_t n_blocks_left = blocks_of_new_data; n_blocks_left > 0;) {
+        int32_t first_data_n = fs_nullptr;
+        int32_t run_len = data_bitmap.allocate(n_blocks_left, hint, first_data_n);
+        if (run_len == 0) {
             break;
         }
-        data_bitmap.set_status(data_n, 1);
-        inode.add_data(data_n);
-
-        // Store uint8_t in block
-        int32_t addr = block.data_n_to_block_n(data_n);
-        int32_t to_write = std::min(length - n_written - n_eddited_bytes, MB.block_size);
-        n_written += block.write(addr, &wdata_new_p[n_written], 0, to_write);
+        n_blocks_left -= run_len;
+        hint = first_data_n + run_len;
+
+        for (int32_t data_n = first_data_n; data_n < first_data_n + run_len; data_n++) {
+            inode.add_data(data_n);
+
+            // Store uint8_t in block
+            int32_t addr = block.data_n_to_block_n(data_n);
+            int32_t to_write = std::min(length - n_written - n_eddited_bytes, geometry.size());
+            if (to_write == geometry.size()) {
+                write_vecs.push_back({addr, &wdata_new_p[n_written]});
+                n_written += to_write;
+            } else {
+                // Fresh block, nothing to preserve past the new data
+                n_written += block.write_full(addr, &wdata_new_p[n_written], to_write);
+            }
+        }
     }
+    block.write_blocks(write_vecs);
 
     // Step 5: Update inode meta
     //
     inode.meta().file_len += n_written;
     int32_t n_ptrs_written = inode.commit(block, data_bitmap);
-    if (n_ptrs_written != block.bytes_to_blocks(n_written - free_bytes)) {
+    if (n_ptrs_written != geometry.blocks_for(max(0, n_written - free_bytes))) {
         throw std::runtime_error("Cannot create indirect block for some pointers.");
     }
     return n_written + n_eddited_bytes;
 }
 
-int32_t FileSystem::read(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_t length) {
+template <typename Geometry>
+int32_t FileSystem::read_as(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_t length) {
     if (!inode_bitmap.get_status(inode_n)) {
         return fs_nullptr;
     }
@@ -212,6 +378,7 @@ int32_t FileSystem::read(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_
         return 0;
     }
 
+    const Geometry geometry(MB.block_size);
     int32_t n_read = 0;
 
     // Step 1: Load inode & calculate absolute offset
@@ -227,8 +394,8 @@ int32_t FileSystem::read(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_
     if (offset + length > inode.meta().file_len) {
         length = inode.meta().file_len - offset;
     }
-    int32_t offset_ptr = std::max(0, block.bytes_to_blocks(offset) - 1);
-    if(offset != 0 && offset % block.get_block_size() == 0){
+    int32_t offset_ptr = std::max(0, geometry.blocks_for(offset) - 1);
+    if(offset != 0 && geometry.offset_in_block(offset) == 0){
         // When reading by chunk, the offest can be at the end of previous block
         offset_ptr += 1;
     }
@@ -236,40 +403,92 @@ int32_t FileSystem::read(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_
     // Step 3 : Read first block and attach to the rdata buffor
     //
     int32_t addr = block.data_n_to_block_n(inode.ptr(offset_ptr));
-    int32_t first_offset = offset % block.get_block_size();
-    int32_t to_read = std::min(length, MB.block_size - first_offset);
+    int32_t first_offset = geometry.offset_in_block(offset);
+    int32_t to_read = std::min(length, geometry.size() - first_offset);
     n_read += block.read(addr, &rdata[n_read], first_offset, to_read);
     offset_ptr += 1;
 
-    // Step 4: Read N full blocks and attach to the rdata buffor
+    // Step 4: Read N full blocks in one scattered call and attach to the rdata buffor
+    //
+    read_vecs.clear();
+    int32_t ptr_n = offset_ptr;
+    for (; length - n_read >= geometry.size(); ptr_n++) {
+        addr = block.data_n_to_block_n(inode.ptr(ptr_n));
+        read_vecs.push_back({addr, &rdata[n_read]});
+        n_read += geometry.size();
+    }
+    block.read_blocks(read_vecs);
+
+    // Step 5: Read tail of the last block
     //
-    for (int32_t ptr_n = 0; n_read < length; ptr_n++) {
-        addr = block.data_n_to_block_n(inode.ptr(offset_ptr + ptr_n));
-        to_read = std::min(length - n_read, MB.block_size);
-        n_read += block.read(addr, &rdata[n_read], 0, to_read);
+    if (n_read < length) {
+        addr = block.data_n_to_block_n(inode.ptr(ptr_n));
+        n_read += block.read(addr, &rdata[n_read], 0, length - n_read);
     }
 
+    // Step 6: Start reading the blocks a sequential reader asks for next
+    //
+    prefetch_ahead(geometry, inode_n, offset, n_read);
+
     return n_read;
 }
 
-int32_t FileSystem::create_file(const char* file_name) {
-    int32_t inode_n = inode_bitmap.next_free(0);
-    if (fs_nullptr == inode_n) {
-        // No free inode blocks
-        return fs_nullptr;
+// Pins the block holding offset instead of copying it out, the view ends at the block or the file end.
+template <typename Geometry>
+BlockReadView FileSystem::read_view_as(int32_t inode_n, int32_t offset, int32_t length) {
+    if (!inode_bitmap.get_status(inode_n) || length <= 0) {
+        return BlockReadView();
+    }
+
+    inode.load(inode_n, block);
+    if ((offset < 0) || (offset >= inode.meta().file_len)) {
+        return BlockReadView();
+    }
+
+    const Geometry geometry(MB.block_size);
+    int32_t block_offset = geometry.offset_in_block(offset);
+    length = std::min({length, inode.meta().file_len - offset, geometry.size() - block_offset});
+    int32_t addr = block.data_n_to_block_n(inode.ptr(geometry.block_of(offset)));
+    auto view = block.pin_read(addr, block_offset, length);
+
+    prefetch_ahead(geometry, inode_n, offset, length);
+    return view;
+}
+
+// Loaded inode must be the one just read.
+template <typename Geometry>
+void FileSystem::prefetch_ahead(const Geometry& geometry, int32_t inode_n, int32_t offset, int32_t length) {
+    int32_t first_ptr_n = 0;
+    int32_t last_ptr_n = geometry.block_of(offset + std::max(1, length) - 1);
+    int32_t n_ptrs = geometry.blocks_for(inode.meta().file_len);
+    int32_t n_ahead = read_ahead.advance(inode_n, offset, length, last_ptr_n, n_ptrs, first_ptr_n);
+    if (n_ahead == 0) {
+        return;
     }
 
+    prefetch_block_ns.clear();
+    for (int32_t ptr_n = first_ptr_n; ptr_n < first_ptr_n + n_ahead; ptr_n++) {
+        prefetch_block_ns.push_back(block.data_n_to_block_n(inode.ptr(ptr_n)));
+    }
+    block.prefetch(prefetch_block_ns);
+}
+
+int32_t FileSystem::create_file(const char* file_name) {
     int32_t file_name_len = strnlen(file_name, meta_max_file_name_size);
     if (file_name_len == meta_max_file_name_size) {
         return fs_nullptr;
     }
 
+    int32_t inode_n = inode_bitmap.allocate(fs_nullptr);
+    if (fs_nullptr == inode_n) {
+        // No free inode blocks
+        return fs_nullptr;
+    }
+
     inode.alloc_new(inode_n);
     memcpy(inode.meta().file_name, file_name, file_name_len);
     inode.commit(block, data_bitmap);
 
-    inode_bitmap.set_status(inode_n, 1);
-
     return inode_n;
 }
 
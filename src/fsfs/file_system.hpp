@@ -1,28 +1,61 @@
 #ifndef FSFS_FILE_SYSTEM_HPP
 #define FSFS_FILE_SYSTEM_HPP
+#include <algorithm>
+
 #include "block.hpp"
 #include "block_bitmap.hpp"
+#include "block_geometry.hpp"
 #include "common/types.hpp"
 #include "data_structs.hpp"
 #include "disk-emulator/disk.hpp"
 #include "indirect_inode.hpp"
 #include "inode.hpp"
+#include "read_ahead.hpp"
 
 namespace FSFS {
 class FileSystem {
    private:
+    using ReadFn = int32_t (FileSystem::*)(int32_t, uint8_t*, int32_t, int32_t);
+    using WriteFn = int32_t (FileSystem::*)(int32_t, const uint8_t*, int32_t, int32_t);
+    using ReadViewFn = BlockReadView (FileSystem::*)(int32_t, int32_t, int32_t);
+
     Disk& disk;
     super_block MB;
     BlockBitmap inode_bitmap;
     BlockBitmap data_bitmap;
     Block block;
     Inode inode;
+    ReadAhead read_ahead;
+    std::vector<BlockReadVec> read_vecs;
+    std::vector<BlockWriteVec> write_vecs;
+    std::vector<int32_t> prefetch_block_ns;
+    BlockArithmetic arithmetic;
+    bool is_scanned;
+    ReadFn read_fn;
+    WriteFn write_fn;
+    ReadViewFn read_view_fn;
 
     static void read_super_block(Disk& disk, super_block& MB);
+    static void write_super_block(Disk& disk, super_block& MB);
     static uint32_t calc_mb_checksum(super_block& MB);
-    int32_t edit_data(int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length);
+    static void store_bitmaps(Disk& disk, super_block& MB, const BlockBitmap& inode_bitmap,
+                              const BlockBitmap& data_bitmap);
+    bool load_bitmaps();
     void scan_blocks();
     void set_data_blocks_status(int32_t inode_n, bool status);
+    void select_block_arithmetic();
+
+    // Data paths built for each block geometry, the one matching the mounted disk is picked by mount()
+    template <typename Geometry>
+    int32_t edit_data(const Geometry& geometry, int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length);
+    template <typename Geometry>
+    void prefetch_ahead(const Geometry& geometry, int32_t inode_n, int32_t offset, int32_t length);
+    template <typename Geometry>
+    int32_t write_as(int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length);
+    template <typename Geometry>
+    int32_t read_as(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_t length);
+    template <typename Geometry>
+    BlockReadView read_view_as(int32_t inode_n, int32_t offset, int32_t length);
 
     template <typename Self>
     static decltype(auto) get_inode_bitmap_common(Self* self) {
@@ -35,15 +68,29 @@ class FileSystem {
     }
 
    public:
-    FileSystem(Disk& disk)
-        : disk(disk), MB(), inode_bitmap(), data_bitmap(), block(disk, MB), inode(){
+    FileSystem(Disk& disk, int32_t n_cache_entries = default_block_cache_entries)
+        : disk(disk), MB(), inode_bitmap(), data_bitmap(), block(disk, MB, n_cache_entries), inode(),
+          read_ahead(std::min(default_read_ahead_window, block.get_cache().get_max_admitted())),
+          arithmetic(BlockArithmetic::Specialized), is_scanned(false) {
         MB.block_size = -1;
+        prefetch_block_ns.reserve(n_cache_entries);
+        select_block_arithmetic();
     };
 
-    static void format(Disk& disk);
+    static void format(Disk& disk, uint32_t features = 0);
+    static int32_t calc_n_bitmap_blocks(int32_t n_inodes, int32_t n_data_blocks, int32_t block_size);
 
     void mount();
+    // Throws when dirty blocks cannot be written back, destroying the file system without it drops the error
     void unmount();
+    void flush();
+    void set_write_mode(WriteMode mode, int32_t n_dirty_limit = fs_nullptr);
+    void set_read_ahead(int32_t max_window);
+    void set_cache_policy(CachePolicy policy);
+    void set_alloc_policy(AllocPolicy policy);
+    AllocPolicy get_alloc_policy() const { return data_bitmap.get_alloc_policy(); };
+    void set_block_arithmetic(BlockArithmetic new_arithmetic);
+    BlockArithmetic get_block_arithmetic() const { return arithmetic; };
 
     int32_t create_file(const char* file_name);
     int32_t remove_file(int32_t inode_n);
@@ -52,14 +99,28 @@ class FileSystem {
     int32_t get_file_length(int32_t inode_n);
     int32_t get_file_name(int32_t inode_n, char* file_name_buffer);
 
-    int32_t write(int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length);
-    int32_t read(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_t length);
+    int32_t write(int32_t inode_n, const uint8_t* wdata, int32_t offset, int32_t length) {
+        return (this->*write_fn)(inode_n, wdata, offset, length);
+    }
+    int32_t read(int32_t inode_n, uint8_t* rdata, int32_t offset, int32_t length) {
+        return (this->*read_fn)(inode_n, rdata, offset, length);
+    }
+    BlockReadView read_view(int32_t inode_n, int32_t offset, int32_t length) {
+        return (this->*read_view_fn)(inode_n, offset, length);
+    }
 
     decltype(auto) get_inode_bitmap() const { return get_inode_bitmap_common(this); }
     decltype(auto) get_data_bitmap() const { return get_data_bitmap_common(this); }
 
     int32_t get_inode_blocks_ammount() { return MB.block_size != -1 ? MB.n_inode_blocks : -1; }
     int32_t get_data_blocks_ammount() { return MB.block_size != -1 ? MB.n_data_blocks : -1; }
+    int32_t free_inodes() const { return MB.block_size != -1 ? inode_bitmap.get_n_free() : -1; }
+    int32_t free_data_blocks() const { return MB.block_size != -1 ? data_bitmap.get_n_free() : -1; }
+    bool is_scanned_on_mount() const { return is_scanned; }
+
+    const BlockCache& get_block_cache() const { return block.get_cache(); }
+    const BlockChecksums& get_block_checksums() const { return block.get_checksums(); }
+    const ReadAhead& get_read_ahead() const { return read_ahead; }
 };
 }
 #endif
\ No newline at end of file
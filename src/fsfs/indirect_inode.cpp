@@ -1,8 +1,22 @@
 #include "indirect_inode.hpp"
 
+#include <cstring>
+
 namespace FSFS {
 
-IndirectInode::IndirectInode(const inode_block& inode) : inode(inode) { clear(); }
+IndirectInode::IndirectInode(const inode_block& inode)
+    : inode(inode), indirect_block_n(PtrsLList::allocator_type(block_ns_pool)) {
+    clear();
+}
+
+// Last address of every indirect block links the next one.
+int32_t IndirectInode::calc_n_blocks(int32_t n_ptrs, int32_t n_addreses_in_block) {
+    int32_t n_indirect_ptrs = n_ptrs - meta_n_direct_ptrs;
+    if (n_indirect_ptrs <= 0) {
+        return 0;
+    }
+    return (n_indirect_ptrs + n_addreses_in_block - 2) / (n_addreses_in_block - 1);
+}
 
 int32_t IndirectInode::ptr(int32_t ptr_n) const { return indirect_ptrs_list[ptr_n]; }
 
@@ -44,6 +58,9 @@ int32_t IndirectInode::commit(Block& data_block, BlockBitmap& data_bitmap, PtrsL
     //
     int32_t last_ptr_in_block = n_used_indirect_ptrs % (data_block.get_n_addreses_in_block() - 1);
     int32_t n_free_ptr_slots = (data_block.get_n_addreses_in_block() - 1) - last_ptr_in_block;
+    if (n_used_indirect_ptrs > 0 && last_ptr_in_block == 0) {
+        n_free_ptr_slots = 0;
+    }
     int32_t n_ptrs_to_write = std::min(n_free_ptr_slots, n_ptrs_left_to_write);
     if (n_ptrs_to_write > 0) {
         uint8_t* indirect_ptrs_list_p = cast_to_data(&indirect_ptrs_list[n_used_indirect_ptrs]);
@@ -59,12 +76,11 @@ int32_t IndirectInode::commit(Block& data_block, BlockBitmap& data_bitmap, PtrsL
     //
     while (n_ptrs_left_to_write > 0) {
         // Prepare new uint8_t block
-        int32_t new_block_addr = data_bitmap.next_free(0);
+        int32_t new_block_addr = data_bitmap.allocate(fs_nullptr);
         if (new_block_addr == fs_nullptr) {
             clear();
             return n_new_ptrs - n_ptrs_left_to_write;
         }
-        data_bitmap.set_status(new_block_addr, 1);
         int32_t addr = data_block.data_n_to_block_n(indirect_block_n.front());
         indirect_block_n.push_front(new_block_addr);
 
@@ -110,24 +126,29 @@ void IndirectInode::load(Block& data_block) {
     int32_t n_read_ptrs = 0;
     int32_t n_indirect_blocks = n_indirect_used_ptrs / (data_block.get_n_addreses_in_block() - 1);
     for (int32_t nth_block = 0; nth_block < n_indirect_blocks; nth_block++) {
-        uint8_t* data_indirect_p = cast_to_data(&indirect_ptrs_list[n_read_ptrs]);
         int32_t addr = data_block.data_n_to_block_n(indirect_block_ptr);
+        auto indirect_view = data_block.pin_read(addr, 0, data_block.get_block_size());
 
-        data_block.read(addr, data_indirect_p, 0, indirect_ptrs_block_len);
-        data_block.read(addr, cast_to_data(&indirect_block_ptr), indirect_ptrs_block_len, sizeof(int32_t));
-        indirect_block_n.push_front(indirect_block_ptr);
-
+        // Pointers and the link to the next indirect block parsed straight from the cached block
+        memcpy(&indirect_ptrs_list[n_read_ptrs], indirect_view.data(), indirect_ptrs_block_len);
         n_read_ptrs += (data_block.get_n_addreses_in_block() - 1);
+
+        // Last full block links to nothing until the file grows past it
+        if (n_read_ptrs == n_indirect_used_ptrs) {
+            break;
+        }
+        memcpy(&indirect_block_ptr, indirect_view.data() + indirect_ptrs_block_len, sizeof(int32_t));
+        indirect_block_n.push_front(indirect_block_ptr);
     }
 
     // Step 3: Read tail in the last indirect block
     //
     if (n_read_ptrs < n_indirect_used_ptrs) {
-        uint8_t* data_indirect_p = cast_to_data(&indirect_ptrs_list[n_read_ptrs]);
         int32_t n_ptrs_left = n_indirect_used_ptrs - n_read_ptrs;
         int32_t addr = data_block.data_n_to_block_n(indirect_block_ptr);
+        auto indirect_view = data_block.pin_read(addr, 0, n_ptrs_left * sizeof(int32_t));
 
-        data_block.read(addr, data_indirect_p, 0, n_ptrs_left * sizeof(int32_t));
+        memcpy(&indirect_ptrs_list[n_read_ptrs], indirect_view.data(), indirect_view.size());
     }
 }
 }
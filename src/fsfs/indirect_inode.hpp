@@ -5,20 +5,27 @@
 
 #include "block.hpp"
 #include "block_bitmap.hpp"
+#include "common/pool_allocator.hpp"
 #include "common/types.hpp"
 #include "data_structs.hpp"
 
 namespace FSFS {
-using PtrsLList = std::forward_list<int32_t>;
+// Pointer lists keep their nodes in a pool owned next to them, reloading and
+// growing a file reuses the nodes freed by the previous operation.
+using PtrsLList = std::forward_list<int32_t, PoolAllocator<int32_t>>;
 class IndirectInode {
    private:
     const inode_block& inode;
-    std::forward_list<int32_t> indirect_block_n;
+    NodePool block_ns_pool;
+    PtrsLList indirect_block_n;
     std::vector<int32_t> indirect_ptrs_list;
 
    public:
     IndirectInode(const inode_block& inode);
 
+    // Indirect blocks holding the pointers past the direct ones of a file with n_ptrs data blocks
+    static int32_t calc_n_blocks(int32_t n_ptrs, int32_t n_addreses_in_block);
+
     int32_t ptr(int32_t ptr_n) const;
     int32_t last_indirect_ptr(int32_t indirect_ptr_n) const;
 
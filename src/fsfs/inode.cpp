@@ -2,7 +2,10 @@
 
 #include <cstring>
 namespace FSFS {
-Inode::Inode() : loaded_inode_n(fs_nullptr), indirect_inode(inode) { clear(); }
+Inode::Inode()
+    : loaded_inode_n(fs_nullptr), indirect_inode(inode), ptrs_to_allocate(PtrsLList::allocator_type(ptrs_pool)) {
+    clear();
+}
 
 inode_block const& Inode::meta() const {
     if (loaded_inode_n == fs_nullptr) {
@@ -35,10 +38,10 @@ void Inode::add_data(int32_t new_data_n) { ptrs_to_allocate.push_front(new_data_
 void Inode::load_direct(int32_t inode_n, Block& data_block) {
     int32_t block_n = data_block.inode_n_to_block_n(inode_n);
     int32_t offset = inode_n % data_block.get_n_inodes_in_block() * meta_fragm_size_bytes;
-    uint8_t* data_inode_p = cast_to_data(&inode);
+    auto inode_view = data_block.pin_read(block_n, offset, meta_fragm_size_bytes);
 
-    data_block.read(block_n, data_inode_p, offset, meta_fragm_size_bytes);
-    memcpy(&inode_buf, &inode, sizeof(inode_block));
+    memcpy(&inode, inode_view.data(), sizeof(inode_block));
+    memcpy(&inode_buf, inode_view.data(), sizeof(inode_block));
 }
 
 void Inode::load(int32_t inode_n, Block& data_block) {
@@ -94,11 +97,10 @@ int32_t Inode::commit(Block& data_block, BlockBitmap& data_bitmap) {
         if (ptrs_used >= meta_n_direct_ptrs) {
             if (inode.indirect_inode_ptr == fs_nullptr) {
                 // No more direct ptr slots, allocate new indirect slot if needed or use already alloceted one
-                int32_t new_block_n = data_bitmap.next_free(0);
+                int32_t new_block_n = data_bitmap.allocate(fs_nullptr);
                 if (new_block_n == fs_nullptr) {
                     break;
                 }
-                data_bitmap.set_status(new_block_n, 1);
                 meta().indirect_inode_ptr = new_block_n;
                 inode.indirect_inode_ptr = new_block_n;
             }
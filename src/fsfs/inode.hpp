@@ -4,7 +4,6 @@
 #include "block_bitmap.hpp"
 #include "indirect_inode.hpp"
 namespace FSFS {
-using PtrsLList = std::forward_list<int32_t>;
 class Inode {
    private:
     int32_t loaded_inode_n;
@@ -12,6 +11,7 @@ class Inode {
     IndirectInode indirect_inode;
     inode_block inode;
     inode_block inode_buf;
+    NodePool ptrs_pool;
     PtrsLList ptrs_to_allocate;
 
     void load_direct(int32_t inode_n, Block& data_block);
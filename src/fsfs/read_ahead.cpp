@@ -0,0 +1,62 @@
+#include "read_ahead.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "data_structs.hpp"
+
+namespace FSFS {
+ReadAhead::ReadAhead(int32_t max_window) {
+    set_max_window(max_window);
+    reset();
+}
+
+void ReadAhead::reset() {
+    window = 0;
+    inode_n = fs_nullptr;
+    next_offset = 0;
+    next_ptr_n = 0;
+}
+
+void ReadAhead::set_max_window(int32_t max_window) {
+    if (max_window < 0) {
+        throw std::invalid_argument("Read-ahead window cannot be lower than zero.");
+    }
+
+    this->max_window = max_window;
+    window = std::min(window, max_window);
+}
+
+// Called after every read, returns how many pointers starting at first_ptr_n should be prefetched.
+// Pointers already handed out for the current stream are not returned again.
+int32_t ReadAhead::advance(int32_t inode_n, int32_t offset, int32_t length, int32_t last_ptr_n, int32_t n_ptrs,
+                           int32_t& first_ptr_n) {
+    bool continued = inode_n == this->inode_n && offset == next_offset;
+    this->inode_n = inode_n;
+    next_offset = offset + length;
+
+    if (!continued) {
+        window = 0;
+        next_ptr_n = 0;
+    }
+
+    if (max_window == 0 || (!continued && offset != 0)) {
+        return 0;
+    }
+    window = window == 0 ? std::min(initial_read_ahead_window, max_window) : std::min(window * 2, max_window);
+
+    // Refilled once half of the prefetched pointers were consumed, so reads are issued in batches
+    if (next_ptr_n - (last_ptr_n + 1) > window / 2) {
+        return 0;
+    }
+
+    first_ptr_n = std::max(next_ptr_n, last_ptr_n + 1);
+    int32_t end_ptr_n = std::min(last_ptr_n + 1 + window, n_ptrs);
+    if (end_ptr_n <= first_ptr_n) {
+        return 0;
+    }
+
+    next_ptr_n = end_ptr_n;
+    return end_ptr_n - first_ptr_n;
+}
+}
@@ -0,0 +1,32 @@
+#ifndef FSFS_READ_AHEAD_HPP
+#define FSFS_READ_AHEAD_HPP
+#include "common/types.hpp"
+
+namespace FSFS {
+constexpr int32_t default_read_ahead_window = 16;
+constexpr int32_t initial_read_ahead_window = 4;
+
+// Detects sequential reads of a file and tells which of its pointers to prefetch.
+// The window starts small, doubles with every sequential read up to the maximum
+// and is closed by any other access. Read from the file start opens a new stream.
+class ReadAhead {
+   private:
+    int32_t max_window;
+    int32_t window;
+    int32_t inode_n;
+    int32_t next_offset;
+    int32_t next_ptr_n;
+
+   public:
+    ReadAhead(int32_t max_window = default_read_ahead_window);
+
+    void reset();
+    int32_t advance(int32_t inode_n, int32_t offset, int32_t length, int32_t last_ptr_n, int32_t n_ptrs,
+                    int32_t& first_ptr_n);
+
+    void set_max_window(int32_t max_window);
+    int32_t get_max_window() const { return max_window; };
+    int32_t get_window() const { return window; };
+};
+}
+#endif
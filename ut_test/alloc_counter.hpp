@@ -0,0 +1,19 @@
+#ifndef UT_TEST_ALLOC_COUNTER_HPP
+#define UT_TEST_ALLOC_COUNTER_HPP
+#include <stdint.h>
+
+namespace FSFS {
+// Counts heap allocations made anywhere in the test binary while the counter lives.
+// Backed by the global operator new replaced in ut-main.
+class AllocCounter {
+   private:
+    int64_t n_allocs_at_start;
+
+   public:
+    AllocCounter();
+    ~AllocCounter();
+
+    int64_t get_n_allocs() const;
+};
+}
+#endif
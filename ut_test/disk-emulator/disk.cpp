@@ -1,6 +1,11 @@
+#include <atomic>
+#include <filesystem>
 #include <fstream>
+#include <limits>
 #include <string_view>
+#include <thread>
 
+#include "disk-emulator/striped_disk_backend.hpp"
 #include "test_base.hpp"
 using namespace FSFS;
 namespace {
@@ -75,6 +80,52 @@ TEST(DiskTest, mount_multiple_times) {
     EXPECT_FALSE(disk.is_mounted());
 }
 
+TEST(DiskTest, large_sparse_image_above_2gib) {
+    constexpr char large_disk_name[] = "_tmp_large_disk.img";
+    constexpr int32_t large_block_size = 4 * block_size_quant;
+    constexpr int64_t large_disk_size = 3LL * 1024 * 1024 * 1024;
+    constexpr int32_t large_n_blocks = large_disk_size / large_block_size;
+    constexpr int32_t block_above_2gib = (2LL * 1024 * 1024 * 1024) / large_block_size + 1;
+
+    std::remove(large_disk_name);
+    Disk::create(large_disk_name, large_n_blocks, large_block_size);
+
+    std::vector<uint8_t> ref_data(large_block_size);
+    std::vector<uint8_t> r_data(large_block_size);
+    for (auto i = 0; i < large_block_size; i++) {
+        ref_data[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    {
+        Disk disk(large_block_size, ut_disk_mode());
+        disk.open(large_disk_name);
+        EXPECT_EQ(disk.get_disk_img_size(), large_disk_size);
+        EXPECT_EQ(disk.get_disk_size(), large_n_blocks);
+
+        disk.mount();
+        EXPECT_EQ(disk.write(block_above_2gib, ref_data.data(), large_block_size), large_block_size);
+        EXPECT_EQ(disk.write(large_n_blocks - 1, ref_data.data(), 2 * large_block_size), large_block_size);
+        EXPECT_EQ(disk.read(0, r_data.data(), large_block_size), large_block_size);
+        EXPECT_NE(std::memcmp(ref_data.data(), r_data.data(), large_block_size), 0);
+        disk.unmount();
+    }
+
+    std::ifstream file(large_disk_name, std::ios::binary);
+    file.seekg(0, std::ios::end);
+    EXPECT_EQ(static_cast<int64_t>(file.tellg()), large_disk_size);
+
+    file.seekg(static_cast<int64_t>(block_above_2gib) * large_block_size);
+    file.read(reinterpret_cast<char*>(r_data.data()), large_block_size);
+    EXPECT_EQ(std::memcmp(ref_data.data(), r_data.data(), large_block_size), 0);
+
+    file.seekg(large_disk_size - large_block_size);
+    file.read(reinterpret_cast<char*>(r_data.data()), large_block_size);
+    EXPECT_EQ(std::memcmp(ref_data.data(), r_data.data(), large_block_size), 0);
+    file.close();
+
+    std::remove(large_disk_name);
+}
+
 TEST_P(DiskTest, get_block_size) { EXPECT_EQ(disk.get_block_size(), block_size); }
 
 TEST_P(DiskTest, get_disk_size) { EXPECT_EQ(disk.get_disk_size(), n_blocks); }
@@ -88,13 +139,13 @@ TEST_P(DiskTest, create_requested_disk_size_test) {
 }
 
 TEST_P(DiskTest, open_throw_when_mounted_already) {
-    Disk tmp_disk(block_size);
+    Disk tmp_disk(block_size, ut_disk_mode());
     tmp_disk.mount();
     EXPECT_THROW(tmp_disk.open(disk_name), std::runtime_error);
 }
 
 TEST_P(DiskTest, open_throw_when_invalid_img_name) {
-    Disk tmp_disk(block_size);
+    Disk tmp_disk(block_size, ut_disk_mode());
 
     EXPECT_THROW(tmp_disk.open("xxx.img"), std::runtime_error);
 }
@@ -134,7 +185,27 @@ TEST_P(DiskTest, write_invalid_block) {
 
     disk.mount();
     auto n_written = disk.write(n_blocks, w_data.data(), w_data_size);
-    EXPECT_EQ(n_written, 0);
+    EXPECT_EQ(n_written, -1);
+    disk.unmount();
+}
+
+TEST_P(DiskTest, out_of_range_block_rejected) {
+    DataBufferType data(block_size);
+    fill_dummy(data);
+
+    disk.mount();
+    disk.reset_io_stats();
+    for (auto block_n : {-1, -n_blocks, n_blocks, std::numeric_limits<int32_t>::min()}) {
+        EXPECT_EQ(disk.write(block_n, data.data(), block_size), -1);
+        EXPECT_EQ(disk.read(block_n, data.data(), block_size), -1);
+        EXPECT_EQ(disk.write_async(block_n, data.data(), block_size).get(), -1);
+        EXPECT_EQ(disk.read_async(block_n, data.data(), block_size).get(), -1);
+    }
+
+    // Rejected before the backend, neither counted nor timed
+    auto totals = disk.get_io_stats()->get_totals();
+    EXPECT_EQ(totals.n_reads, 0);
+    EXPECT_EQ(totals.n_writes, 0);
     disk.unmount();
 }
 
@@ -187,5 +258,550 @@ TEST_P(DiskTest, write_and_read_test_unchanged_other_blocks) {
     }
 }
 
+TEST_P(DiskTest, posix_concurrent_write_and_read) {
+    constexpr int32_t n_threads = 4;
+    DataBufferType ref_data(disk_size);
+    fill_dummy(ref_data);
+
+    Disk posix_disk(block_size, DiskMode::Posix);
+    posix_disk.open(disk_name);
+    posix_disk.mount();
+
+    std::vector<std::thread> workers;
+    for (auto thread_n = 0; thread_n < n_threads; thread_n++) {
+        workers.emplace_back([&, thread_n]() {
+            for (auto block_n = thread_n; block_n < n_blocks; block_n += n_threads) {
+                posix_disk.write(block_n, &ref_data[block_n * block_size], block_size);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    DataBufferType r_data(disk_size);
+    for (auto thread_n = 0; thread_n < n_threads; thread_n++) {
+        workers.emplace_back([&, thread_n]() {
+            for (auto block_n = thread_n; block_n < n_blocks; block_n += n_threads) {
+                posix_disk.read(block_n, &r_data[block_n * block_size], block_size);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    posix_disk.unmount();
+
+    EXPECT_TRUE(cmp_data(ref_data, r_data));
+}
+
+TEST_P(DiskTest, read_and_write_blocks_contiguous_run) {
+    DataBufferType ref_data(block_size * 3);
+    DataBufferType r_data(block_size * 3);
+    fill_dummy(ref_data);
+
+    EXPECT_EQ(disk.write_blocks(1, 3, ref_data.data()), -1);
+
+    disk.mount();
+    EXPECT_EQ(disk.write_blocks(1, 3, ref_data.data()), 3);
+    EXPECT_EQ(disk.read_blocks(1, 3, r_data.data()), 3);
+    EXPECT_EQ(disk.read_blocks(n_blocks - 2, 3, r_data.data()), -1);
+    EXPECT_EQ(disk.read_blocks(-1, 1, r_data.data()), -1);
+    EXPECT_EQ(disk.read_blocks(std::numeric_limits<int32_t>::max() - 1, 3, r_data.data()), -1);
+    EXPECT_EQ(disk.write_blocks(1, std::numeric_limits<int32_t>::max(), ref_data.data()), -1);
+    disk.unmount();
+
+    EXPECT_TRUE(cmp_data(ref_data, r_data));
+}
+
+TEST_P(DiskTest, read_and_write_blocks_scatter_list) {
+    DataBufferType ref_data(block_size * 4);
+    DataBufferType r_data(block_size * 4);
+    fill_dummy(ref_data);
+
+    // Two consecutive runs and a lone block placed in front of them
+    const int32_t block_ns[] = {n_blocks - 1, 2, 3, 0};
+    std::vector<BlockWriteVec> w_vecs;
+    std::vector<BlockReadVec> r_vecs;
+    for (auto i = 0; i < 4; i++) {
+        w_vecs.push_back({block_ns[i], &ref_data[i * block_size]});
+        r_vecs.push_back({block_ns[i], &r_data[i * block_size]});
+    }
+
+    disk.mount();
+    ASSERT_EQ(disk.write_blocks(w_vecs), 4);
+    ASSERT_EQ(disk.read_blocks(r_vecs), 4);
+    EXPECT_TRUE(cmp_data(ref_data, r_data));
+
+    DataBufferType single_block(block_size);
+    for (auto i = 0; i < 4; i++) {
+        disk.read(block_ns[i], single_block.data(), block_size);
+        EXPECT_TRUE(cmp_data(&ref_data[i * block_size], single_block.data(), block_size));
+    }
+
+    r_vecs.push_back({n_blocks, r_data.data()});
+    EXPECT_EQ(disk.read_blocks(r_vecs), -1);
+    disk.unmount();
+}
+
+TEST_P(DiskTest, async_not_mounted_completes_with_error) {
+    uint8_t dummy_data[1] = {};
+    int32_t callback_result = 0;
+    auto completion = disk.read_async(0, dummy_data, 1, [&](int32_t result) { callback_result = result; });
+
+    EXPECT_EQ(completion.get(), -1);
+    EXPECT_EQ(callback_result, -1);
+}
+
+TEST_P(DiskTest, async_throw_when_not_opened) {
+    Disk tmp_disk(block_size);
+    EXPECT_THROW(tmp_disk.start_async(), std::runtime_error);
+    EXPECT_THROW(tmp_disk.get_async_engine(), std::runtime_error);
+}
+
+class DiskAsyncTest : public DiskTest {
+   protected:
+    void write_and_read_in_flight(AsyncEngine engine) {
+        constexpr int32_t queue_depth = 4;
+        const int32_t n_async_blocks = std::min(n_blocks, 256);
+        DataBufferType ref_data(n_async_blocks * block_size);
+        DataBufferType r_data(n_async_blocks * block_size);
+        fill_dummy(ref_data);
+
+        disk.start_async(queue_depth, engine);
+        disk.mount();
+
+        std::atomic<int32_t> n_callbacks = 0;
+        std::vector<std::future<int32_t>> completions;
+        for (auto block_n = 0; block_n < n_async_blocks; block_n++) {
+            completions.push_back(disk.write_async(block_n, &ref_data[block_n * block_size], block_size,
+                                                   [&](int32_t) { n_callbacks++; }));
+        }
+        for (auto& completion : completions) {
+            EXPECT_EQ(completion.get(), block_size);
+        }
+        completions.clear();
+
+        for (auto block_n = 0; block_n < n_async_blocks; block_n++) {
+            completions.push_back(disk.read_async(block_n, &r_data[block_n * block_size], block_size));
+        }
+        disk.wait_async();
+        for (auto& completion : completions) {
+            EXPECT_EQ(completion.get(), block_size);
+        }
+
+        DataBufferType overflow_data(2 * block_size);
+        auto overflow = disk.read_async(n_blocks - 1, overflow_data.data(), 2 * block_size);
+        EXPECT_EQ(overflow.get(), block_size);
+        disk.unmount();
+
+        EXPECT_EQ(n_callbacks, n_async_blocks);
+        EXPECT_TRUE(cmp_data(ref_data, r_data));
+    }
+
+    // Every request in flight submits another one from its callback while the queue is full
+    void callback_submits_on_full_queue(AsyncEngine engine) {
+        constexpr int32_t queue_depth = 2;
+        DataBufferType ref_data(queue_depth * block_size);
+        DataBufferType r_data(queue_depth * block_size);
+        fill_dummy(ref_data);
+
+        disk.start_async(queue_depth, engine);
+        disk.mount();
+
+        std::vector<std::future<int32_t>> inner_completions(queue_depth);
+        std::vector<std::future<int32_t>> completions;
+        for (auto block_n = 0; block_n < queue_depth; block_n++) {
+            completions.push_back(
+                disk.write_async(block_n, &ref_data[block_n * block_size], block_size, [&, block_n](int32_t) {
+                    inner_completions[block_n] = disk.read_async(block_n, &r_data[block_n * block_size], block_size);
+                }));
+        }
+        disk.wait_async();
+        for (auto block_n = 0; block_n < queue_depth; block_n++) {
+            EXPECT_EQ(completions[block_n].get(), block_size);
+            EXPECT_EQ(inner_completions[block_n].get(), block_size);
+        }
+        disk.unmount();
+
+        EXPECT_TRUE(cmp_data(ref_data, r_data));
+    }
+
+    void callback_error_reaches_future(AsyncEngine engine) {
+        DataBufferType data(block_size);
+        disk.start_async(2, engine);
+        disk.mount();
+
+        auto completion =
+            disk.read_async(0, data.data(), block_size, [](int32_t) { throw std::runtime_error("Callback failed."); });
+        EXPECT_THROW(completion.get(), std::runtime_error);
+        EXPECT_EQ(disk.read_async(0, data.data(), block_size).get(), block_size);
+        disk.unmount();
+    }
+
+    // Transfer cut short by the image end reports the bytes moved. Returns the engine used.
+    AsyncEngine short_transfer_returns_prefix(AsyncEngine engine) {
+        constexpr char short_name[] = "_tmp_short.img";
+        create_dummy_file(short_name, block_size);
+        int32_t file_len = static_cast<int32_t>(std::filesystem::file_size(short_name));
+
+        PosixDiskBackend backend;
+        backend.open(short_name);
+        auto io_queue = IoQueue::make(backend, 2, engine);
+
+        DataBufferType data(2 * block_size);
+        EXPECT_EQ(io_queue->submit({IoType::Read, 0, data.data(), 2 * block_size, nullptr}).get(), file_len);
+        EXPECT_EQ(io_queue->submit({IoType::Read, file_len, data.data(), block_size, nullptr}).get(), 0);
+        return io_queue->engine();
+    }
+};
+
+TEST_P(DiskAsyncTest, thread_pool_write_and_read_in_flight) {
+    write_and_read_in_flight(AsyncEngine::ThreadPool);
+    EXPECT_EQ(disk.get_async_engine(), AsyncEngine::ThreadPool);
+}
+
+TEST_P(DiskAsyncTest, uring_write_and_read_in_flight) {
+    write_and_read_in_flight(AsyncEngine::Uring);
+    if (disk.get_async_engine() != AsyncEngine::Uring) {
+        GTEST_SKIP() << "io_uring not available for this backend or kernel.";
+    }
+}
+
+TEST_P(DiskAsyncTest, thread_pool_callback_submits_on_full_queue) {
+    callback_submits_on_full_queue(AsyncEngine::ThreadPool);
+}
+
+TEST_P(DiskAsyncTest, uring_callback_submits_on_full_queue) {
+    callback_submits_on_full_queue(AsyncEngine::Uring);
+    if (disk.get_async_engine() != AsyncEngine::Uring) {
+        GTEST_SKIP() << "io_uring not available for this backend or kernel.";
+    }
+}
+
+TEST_P(DiskAsyncTest, thread_pool_callback_error_reaches_future) {
+    callback_error_reaches_future(AsyncEngine::ThreadPool);
+}
+
+TEST_P(DiskAsyncTest, uring_callback_error_reaches_future) {
+    callback_error_reaches_future(AsyncEngine::Uring);
+    if (disk.get_async_engine() != AsyncEngine::Uring) {
+        GTEST_SKIP() << "io_uring not available for this backend or kernel.";
+    }
+}
+
+TEST_P(DiskAsyncTest, thread_pool_short_transfer_returns_prefix) {
+    EXPECT_EQ(short_transfer_returns_prefix(AsyncEngine::ThreadPool), AsyncEngine::ThreadPool);
+}
+
+TEST_P(DiskAsyncTest, uring_short_transfer_returns_prefix) {
+    if (short_transfer_returns_prefix(AsyncEngine::Uring) != AsyncEngine::Uring) {
+        GTEST_SKIP() << "io_uring not available for this backend or kernel.";
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, DiskAsyncTest, testing::ValuesIn(valid_block_sizes));
+
+TEST_P(DiskTest, direct_unaligned_and_aligned_access) {
+    Disk direct_disk(block_size, DiskMode::Direct);
+    try {
+        direct_disk.open(disk_name);
+    } catch (const std::runtime_error&) {
+        GTEST_SKIP() << "Direct I/O not supported by the file system.";
+    }
+
+    AlignedBuffer ref_data(disk_size);
+    AlignedBuffer r_data(disk_size);
+    fill_dummy(ref_data);
+
+    direct_disk.mount();
+
+    // Aligned buffer, whole image
+    ASSERT_EQ(direct_disk.write(0, ref_data.data(), disk_size), disk_size);
+    ASSERT_EQ(direct_disk.read(0, r_data.data(), disk_size), disk_size);
+    EXPECT_EQ(std::memcmp(ref_data.data(), r_data.data(), disk_size), 0);
+
+    // Misaligned buffer and sub-block length must not disturb neighbouring bytes
+    constexpr int32_t patch_len = 100;
+    DataBufferType patch(patch_len + 1, 0x5A);
+    ASSERT_EQ(direct_disk.write(1, &patch[1], patch_len), patch_len);
+    std::memset(&ref_data[block_size], 0x5A, patch_len);
+
+    ASSERT_EQ(direct_disk.read(0, &r_data[0], disk_size), disk_size);
+    EXPECT_EQ(std::memcmp(ref_data.data(), r_data.data(), disk_size), 0);
+
+    DataBufferType last_block(block_size + 1);
+    ASSERT_EQ(direct_disk.read(n_blocks - 1, &last_block[1], block_size), block_size);
+    EXPECT_TRUE(cmp_data(&ref_data[disk_size - block_size], &last_block[1], block_size));
+    direct_disk.unmount();
+}
+
+TEST_P(DiskTest, map_block_not_available_without_mapping) {
+    Disk stream_disk(block_size, DiskMode::Stream);
+    stream_disk.open(disk_name);
+    stream_disk.mount();
+    EXPECT_EQ(stream_disk.map_block(0), nullptr);
+    stream_disk.unmount();
+}
+
+TEST_P(DiskTest, mmap_map_block_points_to_written_data) {
+    DataBufferType ref_data(block_size);
+    fill_dummy(ref_data);
+
+    Disk mmap_disk(block_size, DiskMode::Mmap);
+    mmap_disk.open(disk_name);
+    EXPECT_EQ(mmap_disk.map_block(1), nullptr);
+
+    mmap_disk.mount();
+    mmap_disk.advise(DiskAccess::Sequential);
+    ASSERT_EQ(mmap_disk.write(1, ref_data.data(), block_size), block_size);
+
+    const uint8_t* mapped_block = mmap_disk.map_block(1);
+    ASSERT_NE(mapped_block, nullptr);
+    EXPECT_TRUE(cmp_data(ref_data.data(), mapped_block, block_size));
+    EXPECT_EQ(mmap_disk.map_block(n_blocks), nullptr);
+    EXPECT_EQ(mmap_disk.map_block(-1), nullptr);
+    mmap_disk.unmount();
+}
+
+TEST_P(DiskTest, mmap_backend_rejects_range_outside_image) {
+    constexpr char mmap_disk_name[] = "_tmp_mmap_disk.img";
+    DataBufferType data(block_size);
+    Disk::create(mmap_disk_name, n_blocks, block_size);
+
+    MmapDiskBackend backend;
+    backend.open(mmap_disk_name);
+    EXPECT_EQ(backend.write(-block_size, data.data(), block_size), -1);
+    EXPECT_EQ(backend.read(-1, data.data(), block_size), -1);
+    EXPECT_EQ(backend.write(disk_size, data.data(), block_size), -1);
+    EXPECT_EQ(backend.read(disk_size - block_size + 1, data.data(), block_size), -1);
+    EXPECT_EQ(backend.read(disk_size - block_size, data.data(), block_size), block_size);
+
+    std::remove(mmap_disk_name);
+}
+
+TEST_P(DiskTest, mmap_unmount_flushes_image) {
+    DataBufferType ref_data(block_size);
+    fill_dummy(ref_data);
+
+    Disk mmap_disk(block_size, DiskMode::Mmap);
+    mmap_disk.open(disk_name);
+    mmap_disk.mount();
+    std::memcpy(mmap_disk.map_block(n_blocks - 1), ref_data.data(), block_size);
+    mmap_disk.unmount();
+
+    DataBufferType r_data(block_size);
+    std::ifstream file(disk_name, std::ios::binary);
+    file.seekg((n_blocks - 1) * block_size);
+    file.read(reinterpret_cast<char*>(r_data.data()), block_size);
+
+    EXPECT_TRUE(cmp_data(ref_data, r_data));
+}
+
+TEST_P(DiskTest, open_ram_throw_when_not_ram_mode) {
+    Disk file_disk(block_size, DiskMode::Posix);
+
+    EXPECT_THROW(file_disk.open_ram(n_blocks), std::runtime_error);
+}
+
+TEST_P(DiskTest, open_ram_without_image) {
+    DataBufferType w_data(block_size);
+    DataBufferType r_data(block_size);
+    fill_dummy(w_data);
+
+    Disk ram_disk(block_size, DiskMode::Ram);
+    EXPECT_THROW(ram_disk.open_ram(0), std::invalid_argument);
+    ram_disk.open_ram(n_blocks);
+    ram_disk.mount();
+
+    EXPECT_EQ(ram_disk.get_disk_img_size(), disk_size);
+    EXPECT_EQ(ram_disk.write(n_blocks - 1, w_data.data(), block_size), block_size);
+    EXPECT_EQ(ram_disk.read(n_blocks - 1, r_data.data(), block_size), block_size);
+    EXPECT_TRUE(cmp_data(w_data, r_data));
+    EXPECT_TRUE(cmp_data(w_data.data(), ram_disk.map_block(n_blocks - 1), block_size));
+    EXPECT_EQ(ram_disk.read(n_blocks, r_data.data(), block_size), -1);
+
+    ram_disk.unmount();
+}
+
+TEST_P(DiskTest, ram_backend_rejects_range_outside_image) {
+    DataBufferType data(block_size);
+    RamDiskBackend backend;
+    EXPECT_EQ(backend.read(0, data.data(), block_size), -1);
+
+    backend.open_empty(disk_size);
+    EXPECT_EQ(backend.write(-block_size, data.data(), block_size), -1);
+    EXPECT_EQ(backend.read(-1, data.data(), block_size), -1);
+    EXPECT_EQ(backend.write(disk_size, data.data(), block_size), -1);
+    EXPECT_EQ(backend.read(disk_size - block_size + 1, data.data(), block_size), -1);
+    EXPECT_EQ(backend.write(disk_size - block_size, data.data(), block_size), block_size);
+}
+
+TEST_P(DiskTest, ram_load_and_dump_image) {
+    constexpr char dump_name[] = "_tmp_dump_disk.img";
+    DataBufferType ref_data(block_size);
+    DataBufferType r_data(block_size);
+    fill_dummy(ref_data);
+
+    disk.mount();
+    disk.write(1, ref_data.data(), block_size);
+    disk.unmount();
+
+    // Writes to RAM image stay in memory until dumped
+    Disk ram_disk(block_size, DiskMode::Ram);
+    ram_disk.open(disk_name);
+    ram_disk.mount();
+    EXPECT_EQ(ram_disk.get_disk_img_size(), disk_size);
+    ram_disk.read(1, r_data.data(), block_size);
+    EXPECT_TRUE(cmp_data(ref_data, r_data));
+    ram_disk.write(0, ref_data.data(), block_size);
+    ram_disk.unmount();
+
+    disk.mount();
+    disk.read(0, r_data.data(), block_size);
+    EXPECT_FALSE(cmp_data(ref_data, r_data));
+    disk.unmount();
+
+    ram_disk.dump(dump_name);
+    Disk dumped_disk(block_size);
+    dumped_disk.open(dump_name);
+    dumped_disk.mount();
+    EXPECT_EQ(dumped_disk.get_disk_img_size(), disk_size);
+    dumped_disk.read(0, r_data.data(), block_size);
+    EXPECT_TRUE(cmp_data(ref_data, r_data));
+    dumped_disk.read(1, r_data.data(), block_size);
+    EXPECT_TRUE(cmp_data(ref_data, r_data));
+    dumped_disk.unmount();
+
+    std::remove(dump_name);
+}
+
+TEST_P(DiskTest, dump_throw_when_not_opened) {
+    Disk unopened_disk(block_size, DiskMode::Ram);
+
+    EXPECT_THROW(unopened_disk.dump("_tmp_dump_disk.img"), std::runtime_error);
+}
+
+TEST_P(DiskTest, create_striped_throw_invalid_params) {
+    constexpr char stripe_set_name[] = "_tmp_disk.stripe";
+
+    EXPECT_THROW(Disk::create_striped(stripe_set_name, {}, n_blocks, block_size, block_size), std::invalid_argument);
+    EXPECT_THROW(Disk::create_striped(stripe_set_name, stripe_member_names, n_blocks, block_size, block_size + 1),
+                 std::invalid_argument);
+    EXPECT_THROW(Disk::create_striped(stripe_set_name, stripe_member_names, 3, block_size, block_size),
+                 std::invalid_argument);
+}
+
+TEST_P(DiskTest, open_striped_throw_invalid_stripe_set) {
+    Disk striped_disk(block_size, DiskMode::Striped);
+
+    EXPECT_THROW(striped_disk.open("xxx.stripe"), std::runtime_error);
+    EXPECT_THROW(striped_disk.open(disk_name), std::runtime_error);
+}
+
+TEST_P(DiskTest, striped_blocks_interleave_across_members) {
+    constexpr char stripe_set_name[] = "_tmp_disk.stripe";
+    constexpr int32_t n_run_blocks = 64;
+    Disk::create_striped(stripe_set_name, stripe_member_names, n_blocks, block_size, block_size);
+
+    int32_t run_size = n_run_blocks * block_size;
+    int32_t first_block_n = n_blocks - n_run_blocks;
+    DataBufferType w_data(run_size);
+    DataBufferType r_data(run_size);
+    fill_dummy(w_data);
+
+    // Run of blocks in one request spans both members
+    Disk striped_disk(block_size, DiskMode::Striped);
+    striped_disk.open(stripe_set_name);
+    striped_disk.mount();
+    EXPECT_EQ(striped_disk.get_disk_size(), n_blocks);
+    EXPECT_EQ(striped_disk.write(first_block_n, w_data.data(), run_size), run_size);
+    EXPECT_EQ(striped_disk.read(first_block_n, r_data.data(), run_size), run_size);
+    EXPECT_TRUE(cmp_data(w_data, r_data));
+    striped_disk.unmount();
+
+    DataBufferType member_data(block_size);
+    for (int32_t run_block_n : {0, 1, n_run_blocks - 2, n_run_blocks - 1}) {
+        int32_t block_n = first_block_n + run_block_n;
+        std::ifstream member(stripe_member_names[block_n % 2], std::ios::binary);
+        member.seekg(static_cast<int64_t>(block_n / 2) * block_size);
+        member.read(reinterpret_cast<char*>(member_data.data()), block_size);
+        EXPECT_TRUE(cmp_data(&w_data[run_block_n * block_size], member_data.data(), block_size));
+    }
+
+    std::remove(stripe_set_name);
+}
+
+TEST_P(DiskTest, striped_scatter_list_and_unaligned_access) {
+    constexpr char stripe_set_name[] = "_tmp_disk.stripe";
+    Disk::create_striped(stripe_set_name, stripe_member_names, n_blocks, block_size, 2 * block_size);
+
+    DataBufferType w_data(4 * block_size);
+    DataBufferType r_data(4 * block_size);
+    fill_dummy(w_data);
+
+    Disk striped_disk(block_size, DiskMode::Striped);
+    striped_disk.open(stripe_set_name);
+    striped_disk.mount();
+
+    std::vector<BlockWriteVec> w_vecs = {{1, &w_data[0]}, {2, &w_data[block_size]}, {7, &w_data[2 * block_size]}};
+    std::vector<BlockReadVec> r_vecs = {{1, &r_data[0]}, {2, &r_data[block_size]}, {7, &r_data[2 * block_size]}};
+    EXPECT_EQ(striped_disk.write_blocks(w_vecs), 3);
+    EXPECT_EQ(striped_disk.read_blocks(r_vecs), 3);
+    EXPECT_TRUE(cmp_data(w_data.data(), r_data.data(), 3 * block_size));
+
+    // Request starting in the middle of a stripe unit
+    EXPECT_EQ(striped_disk.write(1, &w_data[block_size / 2], 3 * block_size), 3 * block_size);
+    EXPECT_EQ(striped_disk.read(1, r_data.data(), 3 * block_size), 3 * block_size);
+    EXPECT_TRUE(cmp_data(&w_data[block_size / 2], r_data.data(), 3 * block_size));
+
+    striped_disk.unmount();
+    std::remove(stripe_set_name);
+}
+
+TEST_P(DiskTest, striped_members_relative_to_stripe_set) {
+    constexpr char stripe_set_dir[] = "_tmp_stripe_dir";
+    std::filesystem::create_directory(stripe_set_dir);
+    std::string stripe_set_name = std::string(stripe_set_dir) + "/_tmp_disk.stripe";
+    Disk::create_striped(stripe_set_name.c_str(), stripe_member_names, n_blocks, block_size, block_size);
+    for (auto& member_name : stripe_member_names) {
+        EXPECT_TRUE(std::filesystem::exists(std::string(stripe_set_dir) + "/" + member_name));
+    }
+
+    DataBufferType w_data(2 * block_size);
+    DataBufferType r_data(2 * block_size);
+    fill_dummy(w_data);
+
+    Disk striped_disk(block_size, DiskMode::Striped);
+    striped_disk.open(stripe_set_name.c_str());
+    striped_disk.mount();
+    EXPECT_EQ(striped_disk.write(0, w_data.data(), w_data.size()), static_cast<int32_t>(w_data.size()));
+    EXPECT_EQ(striped_disk.read(0, r_data.data(), r_data.size()), static_cast<int32_t>(r_data.size()));
+    EXPECT_TRUE(cmp_data(w_data, r_data));
+    striped_disk.unmount();
+
+    std::filesystem::remove_all(stripe_set_dir);
+}
+
+TEST_P(DiskTest, striped_short_member_transfer_returns_prefix) {
+    constexpr char stripe_set_name[] = "_tmp_disk.stripe";
+    Disk::create_striped(stripe_set_name, stripe_member_names, n_blocks, block_size, block_size);
+
+    DataBufferType r_data(3 * block_size);
+    {
+        StripedDiskBackend backend;
+        backend.open(stripe_set_name);
+
+        // Second member lost its content, a request counts only the bytes before its first piece there
+        std::filesystem::resize_file(stripe_member_names[1], 0);
+        EXPECT_EQ(backend.read(0, r_data.data(), 3 * block_size), block_size);
+        EXPECT_EQ(backend.read(block_size, r_data.data(), 2 * block_size), 0);
+        EXPECT_EQ(backend.read(2 * block_size, r_data.data(), block_size), block_size);
+    }
+
+    std::remove(stripe_set_name);
+}
+
 INSTANTIATE_TEST_SUITE_P(BlockSize, DiskTest, testing::ValuesIn(valid_block_sizes));
 }
@@ -0,0 +1,121 @@
+#include "disk-emulator/disk_stats.hpp"
+
+#include <fstream>
+#include <string>
+
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+class DiskStatsTest : public ::testing::TestWithParam<int32_t>, public TestBaseDisk {};
+
+TEST(DiskStatsTest, no_stats_before_open) {
+    Disk disk(block_size_quant);
+
+    EXPECT_EQ(disk.get_io_stats(), nullptr);
+}
+
+TEST(DiskStatsTest, block_counters_throw_when_out_of_range) {
+    DiskStats stats(block_size_quant, 4);
+
+    EXPECT_THROW(stats.get_block_writes(-1), std::invalid_argument);
+    EXPECT_THROW(stats.get_block_reads(4), std::invalid_argument);
+}
+
+TEST_P(DiskStatsTest, counts_every_touched_block) {
+    DataBufferType data(2 * block_size);
+    disk.mount();
+
+    disk.write(1, data.data(), 2 * block_size);
+    disk.read(2, data.data(), block_size);
+    disk.read(2, data.data(), block_size / 2);
+    disk.write_blocks({{0, data.data()}, {n_blocks - 1, data.data()}});
+
+    auto stats = disk.get_io_stats();
+    EXPECT_EQ(stats->get_block_writes(0), 1);
+    EXPECT_EQ(stats->get_block_writes(1), 1);
+    EXPECT_EQ(stats->get_block_writes(2), 1);
+    EXPECT_EQ(stats->get_block_reads(2), 2);
+    EXPECT_EQ(stats->get_block_writes(n_blocks - 1), 1);
+
+    auto totals = stats->get_totals();
+    EXPECT_EQ(totals.n_writes, 3);
+    EXPECT_EQ(totals.n_reads, 2);
+    EXPECT_EQ(totals.n_blocks_written, 4);
+    EXPECT_EQ(totals.n_blocks_read, 2);
+    EXPECT_EQ(totals.bytes_written, 4 * block_size);
+    EXPECT_EQ(totals.bytes_read, block_size + block_size / 2);
+
+    disk.unmount();
+}
+
+TEST_P(DiskStatsTest, counts_non_sequential_accesses) {
+    DataBufferType data(block_size);
+    disk.mount();
+
+    for (int32_t block_n = 0; block_n < n_blocks; block_n++) {
+        disk.write(block_n, data.data(), block_size);
+    }
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_seeks, 0);
+
+    disk.read(n_blocks - 1, data.data(), block_size);
+    disk.read(2, data.data(), block_size);
+    disk.read(3, data.data(), block_size);
+
+    auto totals = disk.get_io_stats()->get_totals();
+    EXPECT_EQ(totals.n_seeks, 2);
+    EXPECT_EQ(totals.seek_distance, 1 + (n_blocks - 2));
+
+    disk.reset_io_stats();
+    totals = disk.get_io_stats()->get_totals();
+    EXPECT_EQ(totals.n_seeks, 0);
+    EXPECT_EQ(totals.n_writes, 0);
+    EXPECT_EQ(disk.get_io_stats()->get_block_writes(0), 0);
+
+    disk.unmount();
+}
+
+TEST_P(DiskStatsTest, write_histogram_buckets_by_power_of_two) {
+    DataBufferType data(block_size);
+    disk.mount();
+
+    disk.write(0, data.data(), block_size);
+    for (int32_t i = 0; i < 3; i++) {
+        disk.write(1, data.data(), block_size);
+    }
+    for (int32_t i = 0; i < 4; i++) {
+        disk.write(2, data.data(), block_size);
+    }
+
+    std::vector<int32_t> histogram = disk.get_io_stats()->get_write_histogram();
+    std::vector<int32_t> ref_histogram = {n_blocks - 3, 1, 1, 1};
+    EXPECT_EQ(histogram, ref_histogram);
+
+    disk.unmount();
+}
+
+TEST_P(DiskStatsTest, dump_csv_lists_every_block) {
+    constexpr char csv_name[] = "_tmp_disk_stats.csv";
+    DataBufferType data(block_size);
+    disk.mount();
+
+    disk.write(1, data.data(), block_size);
+    disk.read(1, data.data(), block_size);
+    disk.get_io_stats()->dump_csv(csv_name);
+
+    std::ifstream csv(csv_name);
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(csv, line)) {
+        lines.push_back(line);
+    }
+    ASSERT_EQ(lines.size(), n_blocks + 1);
+    EXPECT_EQ(lines[0], "block,reads,writes");
+    EXPECT_EQ(lines[1], "0,0,0");
+    EXPECT_EQ(lines[2], "1,1,1");
+
+    disk.unmount();
+    std::remove(csv_name);
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, DiskStatsTest, testing::ValuesIn(valid_block_sizes));
+}
@@ -0,0 +1,126 @@
+#include "disk-emulator/nand_timing.hpp"
+
+#include "test_base.hpp"
+using namespace FSFS;
+using namespace std::chrono;
+namespace {
+constexpr NandTiming test_timing = {microseconds(10), microseconds(100), microseconds(1000), 1000 * 1000 * 1000, 4,
+                                    TimingMode::Virtual};
+
+class NandTimingTest : public ::testing::TestWithParam<int32_t>, public TestBaseDisk {
+   protected:
+    nanoseconds transfer_time(int32_t n_bytes) { return nanoseconds(n_bytes); }
+};
+
+TEST(NandTimingTest, constructor_throw_invalid_timing) {
+    NandTiming timing = test_timing;
+    timing.pages_per_erase_block = 0;
+    EXPECT_THROW(NandTimingModel(timing, block_size_quant, 8), std::invalid_argument);
+
+    timing = test_timing;
+    timing.bus_bytes_per_sec = 0;
+    EXPECT_THROW(NandTimingModel(timing, block_size_quant, 8), std::invalid_argument);
+}
+
+TEST_P(NandTimingTest, read_charges_every_touched_page) {
+    NandTimingModel model(test_timing, block_size, n_blocks);
+
+    model.read(0, block_size);
+    EXPECT_EQ(model.get_device_time(), test_timing.page_read + transfer_time(block_size));
+
+    model.reset();
+    model.read(block_size / 2, block_size);
+    EXPECT_EQ(model.get_stats().n_page_reads, 2);
+    EXPECT_EQ(model.get_device_time(), 2 * test_timing.page_read + transfer_time(block_size));
+}
+
+TEST_P(NandTimingTest, access_throw_out_of_range) {
+    NandTimingModel model(test_timing, block_size, n_blocks);
+    int64_t device_size = static_cast<int64_t>(n_blocks) * block_size;
+
+    EXPECT_THROW(model.program(-block_size, block_size), std::invalid_argument);
+    EXPECT_THROW(model.program(device_size, block_size), std::invalid_argument);
+    EXPECT_THROW(model.program(device_size - block_size, block_size + 1), std::invalid_argument);
+    EXPECT_THROW(model.read(-1, block_size), std::invalid_argument);
+    EXPECT_THROW(model.read(device_size, 1), std::invalid_argument);
+    EXPECT_EQ(model.get_stats().n_page_programs, 0);
+    EXPECT_EQ(model.get_device_time(), nanoseconds(0));
+
+    model.program(device_size - block_size, block_size);
+    EXPECT_EQ(model.get_stats().n_page_programs, 1);
+}
+
+TEST_P(NandTimingTest, reprogram_erases_whole_erase_block) {
+    NandTimingModel model(test_timing, block_size, n_blocks);
+
+    model.program(0, 2 * block_size);
+    EXPECT_EQ(model.get_stats().n_block_erases, 0);
+    EXPECT_EQ(model.get_device_time(), 2 * test_timing.page_program + transfer_time(2 * block_size));
+
+    // Page 1 already programmed, erase of pages 0..3 needed
+    model.reset();
+    model.program(0, 2 * block_size);
+    model.program(block_size, block_size);
+    EXPECT_EQ(model.get_stats().n_block_erases, 1);
+
+    // Page 0 was erased together with page 1 so it can be programmed again for free
+    model.program(0, block_size);
+    EXPECT_EQ(model.get_stats().n_block_erases, 1);
+    EXPECT_EQ(model.get_stats().n_page_programs, 4);
+
+    // Page in the next erase block is not affected
+    model.program(test_timing.pages_per_erase_block * block_size, block_size);
+    EXPECT_EQ(model.get_stats().n_block_erases, 1);
+}
+
+TEST_P(NandTimingTest, virtual_mode_does_not_sleep) {
+    NandTiming timing = test_timing;
+    timing.block_erase = seconds(10);
+    NandTimingModel model(timing, block_size, n_blocks);
+
+    auto start = steady_clock::now();
+    model.program(0, block_size);
+    model.program(0, block_size);
+    EXPECT_LT(steady_clock::now() - start, seconds(1));
+    EXPECT_GE(model.get_device_time(), seconds(10));
+}
+
+TEST_P(NandTimingTest, real_time_mode_sleeps) {
+    NandTiming timing = test_timing;
+    timing.mode = TimingMode::RealTime;
+    timing.page_read = milliseconds(20);
+    NandTimingModel model(timing, block_size, n_blocks);
+
+    auto start = steady_clock::now();
+    model.read(0, block_size);
+    EXPECT_GE(steady_clock::now() - start, milliseconds(20));
+}
+
+TEST_P(NandTimingTest, disk_charges_device_time) {
+    DataBufferType data(block_size * 2);
+    EXPECT_EQ(disk.get_timing_model(), nullptr);
+
+    disk.set_timing(test_timing);
+    disk.mount();
+    disk.write(0, data.data(), block_size * 2);
+    disk.read(0, data.data(), block_size);
+    disk.write(1, data.data(), block_size);
+
+    std::vector<BlockReadVec> r_vecs = {{0, &data[0]}, {1, &data[block_size]}};
+    disk.read_blocks(r_vecs);
+    disk.read_async(0, data.data(), block_size).get();
+    disk.unmount();
+
+    auto stats = disk.get_timing_model()->get_stats();
+    EXPECT_EQ(stats.n_page_programs, 3);
+    EXPECT_EQ(stats.n_block_erases, 1);
+    EXPECT_EQ(stats.n_page_reads, 4);
+    EXPECT_EQ(stats.device_time, 3 * test_timing.page_program + test_timing.block_erase +
+                                     4 * test_timing.page_read + transfer_time(7 * block_size));
+
+    disk.clear_timing();
+    EXPECT_EQ(disk.get_timing_model(), nullptr);
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, NandTimingTest, testing::ValuesIn(valid_block_sizes));
+}
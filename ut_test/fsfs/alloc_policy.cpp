@@ -0,0 +1,151 @@
+#include "fsfs/alloc_policy.hpp"
+
+#include "fsfs/block_bitmap.hpp"
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr AllocPolicy all_policies[] = {AllocPolicy::FirstFit, AllocPolicy::NextFit, AllocPolicy::BestFit};
+
+class AllocPolicyTest : public ::testing::TestWithParam<int32_t>, public TestBaseBasic {
+   protected:
+    BlockBitmap bitmap{n_blocks};
+
+    // Every block used except free runs of the given lengths starting at the given blocks
+    void leave_free_runs(std::initializer_list<std::pair<int32_t, int32_t>> runs) {
+        for (int32_t block_n = 0; block_n < n_blocks; block_n++) {
+            bitmap.set_status(block_n, 1);
+        }
+        for (auto [first_block_n, run_len] : runs) {
+            for (int32_t block_n = first_block_n; block_n < first_block_n + run_len; block_n++) {
+                bitmap.set_status(block_n, 0);
+            }
+        }
+    }
+};
+
+TEST_P(AllocPolicyTest, every_policy_allocates_all_blocks) {
+    for (auto policy : all_policies) {
+        bitmap.resize(n_blocks);
+        bitmap.set_alloc_policy(policy);
+        EXPECT_EQ(bitmap.get_alloc_policy(), policy);
+
+        int32_t n_allocated = 0;
+        int32_t first_block_n = fs_nullptr;
+        for (int32_t run_len; (run_len = bitmap.allocate(3, fs_nullptr, first_block_n)) > 0;) {
+            n_allocated += run_len;
+        }
+        EXPECT_EQ(n_allocated, n_blocks);
+        EXPECT_EQ(bitmap.get_n_free(), 0);
+        EXPECT_EQ(bitmap.allocate(fs_nullptr), fs_nullptr);
+    }
+}
+
+TEST_P(AllocPolicyTest, allocate_throw_invalid_params) {
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_THROW(bitmap.allocate(0, fs_nullptr, first_block_n), std::invalid_argument);
+
+    BlockBitmap uninitialized_bitmap;
+    EXPECT_THROW(uninitialized_bitmap.allocate(fs_nullptr), std::runtime_error);
+}
+
+TEST_P(AllocPolicyTest, next_free_run_walks_free_runs) {
+    leave_free_runs({{10, 5}, {30, 1}});
+
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap.next_free_run(0, first_block_n), 5);
+    EXPECT_EQ(first_block_n, 10);
+    EXPECT_EQ(bitmap.next_free_run(12, first_block_n), 3);
+    EXPECT_EQ(first_block_n, 12);
+    EXPECT_EQ(bitmap.next_free_run(15, first_block_n), 1);
+    EXPECT_EQ(first_block_n, 30);
+    EXPECT_EQ(bitmap.next_free_run(31, first_block_n), 0);
+    EXPECT_EQ(bitmap.next_free_run(n_blocks, first_block_n), 0);
+}
+
+TEST_P(AllocPolicyTest, first_fit_takes_lowest_run) {
+    leave_free_runs({{10, 1}, {30, 4}, {50, 2}});
+
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap.allocate(2, fs_nullptr, first_block_n), 2);
+    EXPECT_EQ(first_block_n, 30);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 10);
+
+    // Past the file end first, a run too short for the whole write is taken last
+    EXPECT_EQ(bitmap.allocate(2, 40, first_block_n), 2);
+    EXPECT_EQ(first_block_n, 50);
+    EXPECT_EQ(bitmap.allocate(3, 40, first_block_n), 2);
+    EXPECT_EQ(first_block_n, 32);
+}
+
+TEST_P(AllocPolicyTest, first_fit_extends_file_in_place) {
+    leave_free_runs({{10, 2}, {30, 4}});
+
+    // Free block past the file end comes before a later run long enough for the whole write
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap.allocate(3, 10, first_block_n), 2);
+    EXPECT_EQ(first_block_n, 10);
+    EXPECT_EQ(bitmap.allocate(3, 12, first_block_n), 3);
+    EXPECT_EQ(first_block_n, 30);
+}
+
+TEST_P(AllocPolicyTest, next_fit_moves_on_from_last_allocation) {
+    bitmap.set_alloc_policy(AllocPolicy::NextFit);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 0);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 1);
+
+    // Freed block is not reused until the cursor wraps
+    bitmap.set_status(0, 0);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 2);
+
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap.allocate(n_blocks - 3, fs_nullptr, first_block_n), n_blocks - 3);
+    EXPECT_EQ(first_block_n, 3);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 0);
+
+    // Cursor starts over with the bitmap
+    bitmap.resize(n_blocks);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 0);
+}
+
+TEST_P(AllocPolicyTest, next_fit_extends_file_in_place) {
+    bitmap.set_alloc_policy(AllocPolicy::NextFit);
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap.allocate(4, fs_nullptr, first_block_n), 4);
+    EXPECT_EQ(bitmap.allocate(4, fs_nullptr, first_block_n), 4);
+
+    // Free block past the file end comes before the cursor, even when the whole write does not fit
+    bitmap.set_status(2, 0);
+    bitmap.set_status(3, 0);
+    EXPECT_EQ(bitmap.allocate(4, 2, first_block_n), 2);
+    EXPECT_EQ(first_block_n, 2);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 8);
+}
+
+TEST_P(AllocPolicyTest, best_fit_takes_smallest_run) {
+    leave_free_runs({{10, 5}, {30, 2}, {50, 3}});
+    bitmap.set_alloc_policy(AllocPolicy::BestFit);
+
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap.allocate(3, fs_nullptr, first_block_n), 3);
+    EXPECT_EQ(first_block_n, 50);
+    EXPECT_EQ(bitmap.allocate(fs_nullptr), 30);
+
+    // No run long enough, the longest one is taken
+    EXPECT_EQ(bitmap.allocate(8, fs_nullptr, first_block_n), 5);
+    EXPECT_EQ(first_block_n, 10);
+
+    // Free block past the file end is taken first
+    bitmap.set_status(20, 0);
+    bitmap.set_status(60, 0);
+    EXPECT_EQ(bitmap.allocate(60), 60);
+}
+
+TEST(AllocPolicyTest, make_every_policy) {
+    for (auto policy : all_policies) {
+        EXPECT_NE(BlockAllocator::make(policy), nullptr);
+    }
+    EXPECT_THROW(BlockAllocator::make(static_cast<AllocPolicy>(-1)), std::invalid_argument);
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, AllocPolicyTest, testing::ValuesIn(valid_block_sizes));
+}
@@ -143,6 +143,318 @@ TEST_P(BlockTest, read_with_offset) {
     EXPECT_EQ(rdata[1], ref_data[ref_data.size() - 2]);
 }
 
+TEST_P(BlockTest, write_blocks_replaces_cached_block) {
+    block->write(block_n, ref_data.data(), 0, block_size / 2);
+
+    DataBufferType new_data(block_size, 0xA5);
+    std::vector<BlockWriteVec> w_vecs = {{block_n, new_data.data()}, {block_n + 1, new_data.data()}};
+    ASSERT_EQ(block->write_blocks(w_vecs), 2);
+
+    auto n_read = block->read(block_n, rdata.data(), 0, block_size);
+    ASSERT_EQ(n_read, block_size);
+    EXPECT_TRUE(cmp_data(new_data, rdata));
+}
+
+TEST_P(BlockTest, read_blocks_scatter_list) {
+    block->write(block_n + 2, ref_data.data(), 0, block_size);
+    block->write(block_n, ref_data.data(), 0, block_size);
+
+    DataBufferType scattered(block_size * 2);
+    std::vector<BlockReadVec> r_vecs = {{block_n + 2, &scattered[0]}, {block_n, &scattered[block_size]}};
+    ASSERT_EQ(block->read_blocks(r_vecs), 2);
+    EXPECT_TRUE(cmp_data(ref_data.data(), &scattered[0], block_size));
+    EXPECT_TRUE(cmp_data(ref_data.data(), &scattered[block_size], block_size));
+
+    r_vecs.push_back({MB.n_blocks, rdata.data()});
+    EXPECT_THROW(block->read_blocks(r_vecs), std::invalid_argument);
+}
+
+TEST_P(BlockTest, alternating_blocks_served_from_cache) {
+    block->write(fs_offset_inode_block, ref_data.data(), 0, block_size);
+    block->write(block_n, ref_data.data(), 0, block_size);
+    block->write(block_n + 1, ref_data.data(), 0, block_size);
+
+    disk.reset_io_stats();
+    for (int32_t i = 0; i < 8; i++) {
+        block->read(fs_offset_inode_block, rdata.data(), 0, block_size);
+        block->read(block_n, rdata.data(), 0, block_size);
+        block->write(block_n + 1, ref_data.data(), 0, block_size / 2);
+    }
+
+    // Only the first access of every block goes to the disk
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 3);
+    EXPECT_EQ(block->get_cache().get_n_misses(), 3);
+    EXPECT_EQ(block->get_cache().get_n_hits(), 3 * 8 - 3);
+}
+
+TEST_P(BlockTest, single_entry_cache_rereads_alternating_blocks) {
+    Block single_entry_block(disk, MB, 1);
+
+    disk.reset_io_stats();
+    for (int32_t i = 0; i < 4; i++) {
+        single_entry_block.read(block_n, rdata.data(), 0, block_size);
+        single_entry_block.read(block_n + 1, rdata.data(), 0, block_size);
+    }
+
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 8);
+    EXPECT_EQ(single_entry_block.get_cache().get_n_hits(), 0);
+}
+
+TEST_P(BlockTest, full_block_write_skips_read) {
+    disk.reset_io_stats();
+    EXPECT_EQ(block->write(block_n, ref_data.data(), 0, block_size), block_size);
+    EXPECT_EQ(block->write_full(block_n + 1, ref_data.data(), block_size), block_size);
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 0);
+
+    block->read(block_n + 1, rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+}
+
+TEST_P(BlockTest, write_full_zeroes_tail_and_updates_cache) {
+    block->write(block_n, ref_data.data(), 0, block_size);
+    block->read(block_n, rdata.data(), 0, block_size);
+
+    DataBufferType new_data(block_size / 2, 0xA5);
+    disk.reset_io_stats();
+    EXPECT_EQ(block->write_full(block_n, new_data.data(), new_data.size()), new_data.size());
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 0);
+
+    DataBufferType ref_block(block_size, 0x00);
+    std::memcpy(ref_block.data(), new_data.data(), new_data.size());
+    block->read(block_n, rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(ref_block, rdata));
+
+    Block uncached_block(disk, MB);
+    uncached_block.read(block_n, rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(ref_block, rdata));
+}
+
+TEST_P(BlockTest, write_full_throw_invalid_params) {
+    EXPECT_THROW(block->write_full(MB.n_blocks, ref_data.data(), block_size), std::invalid_argument);
+    EXPECT_THROW(block->write_full(block_n, ref_data.data(), block_size + 1), std::invalid_argument);
+    EXPECT_THROW(block->write_full(block_n, ref_data.data(), -1), std::invalid_argument);
+}
+
+TEST_P(BlockTest, write_back_coalesces_repeated_writes) {
+    block->set_write_mode(WriteMode::WriteBack);
+
+    disk.reset_io_stats();
+    for (int32_t offset = 0; offset < block_size; offset += block_size / 4) {
+        block->write(block_n, ref_data.data() + offset, offset, block_size / 4);
+    }
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_writes, 0);
+
+    // Not written back yet, other instances still see the old content
+    Block other_block(disk, MB);
+    other_block.read(block_n, rdata.data(), 0, block_size);
+    EXPECT_FALSE(cmp_data(ref_data, rdata));
+
+    block->flush();
+    EXPECT_EQ(disk.get_io_stats()->get_block_writes(block_n), 1);
+
+    Block uncached_block(disk, MB);
+    uncached_block.read(block_n, rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+}
+
+TEST_P(BlockTest, flush_writes_dirty_blocks_in_block_order) {
+    block->set_write_mode(WriteMode::WriteBack);
+    block->write(block_n + 2, ref_data.data(), 0, block_size / 2);
+    block->write(block_n, ref_data.data(), 0, block_size / 2);
+    block->write(block_n + 1, ref_data.data(), 0, block_size / 2);
+
+    disk.reset_io_stats();
+    block->flush();
+
+    // Consecutive dirty blocks end up in one write
+    auto totals = disk.get_io_stats()->get_totals();
+    EXPECT_EQ(totals.n_writes, 1);
+    EXPECT_EQ(totals.n_blocks_written, 3);
+    EXPECT_EQ(block->get_cache().get_n_dirty(), 0);
+
+    block->flush();
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_writes, 1);
+}
+
+TEST_P(BlockTest, dirty_limit_forces_flush) {
+    block->set_write_mode(WriteMode::WriteBack, 2);
+
+    disk.reset_io_stats();
+    block->write(block_n, ref_data.data(), 0, block_size / 2);
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_writes, 0);
+    block->write(block_n + 1, ref_data.data(), 0, block_size / 2);
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_blocks_written, 2);
+    EXPECT_EQ(block->get_cache().get_n_dirty(), 0);
+
+    EXPECT_THROW(block->set_write_mode(WriteMode::WriteBack, 0), std::invalid_argument);
+}
+
+TEST_P(BlockTest, evicted_dirty_block_written_back) {
+    Block single_entry_block(disk, MB, 1);
+    single_entry_block.set_write_mode(WriteMode::WriteBack, 2);
+
+    disk.reset_io_stats();
+    single_entry_block.write(block_n, ref_data.data(), 0, block_size / 2);
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_writes, 0);
+    single_entry_block.read(block_n + 1, rdata.data(), 0, block_size);
+    EXPECT_EQ(disk.get_io_stats()->get_block_writes(block_n), 1);
+
+    Block uncached_block(disk, MB);
+    uncached_block.read(block_n, rdata.data(), 0, block_size / 2);
+    EXPECT_TRUE(cmp_data(ref_data.data(), rdata.data(), block_size / 2));
+}
+
+TEST_P(BlockTest, read_blocks_sees_dirty_blocks) {
+    block->set_write_mode(WriteMode::WriteBack);
+    block->write(block_n + 1, ref_data.data(), 0, block_size / 2);
+
+    DataBufferType scattered(block_size * 2);
+    std::vector<BlockReadVec> r_vecs = {{block_n, &scattered[0]}, {block_n + 1, &scattered[block_size]}};
+    ASSERT_EQ(block->read_blocks(r_vecs), 2);
+    EXPECT_TRUE(cmp_data(ref_data.data(), &scattered[block_size], block_size / 2));
+}
+
+TEST_P(BlockTest, write_through_mode_flushes_pending_blocks) {
+    block->set_write_mode(WriteMode::WriteBack);
+    block->write(block_n, ref_data.data(), 0, block_size / 2);
+
+    block->set_write_mode(WriteMode::WriteThrough);
+    EXPECT_EQ(block->get_cache().get_n_dirty(), 0);
+
+    disk.reset_io_stats();
+    block->write(block_n, ref_data.data(), 0, block_size / 2);
+    EXPECT_EQ(disk.get_io_stats()->get_block_writes(block_n), 1);
+}
+
+TEST_P(BlockTest, destructor_drops_failed_flush) {
+    // Built for a bigger disk, the block past the disk end is accepted but cannot be written back
+    super_block bigger_MB = MB;
+    bigger_MB.n_blocks++;
+    {
+        Block failing_block(disk, bigger_MB);
+        failing_block.set_write_mode(WriteMode::WriteBack);
+        failing_block.write_full(MB.n_blocks, ref_data.data(), block_size / 2);
+        EXPECT_THROW(failing_block.flush(), std::runtime_error);
+    }
+
+    block->read(block_n, rdata.data(), 0, block_size);
+    EXPECT_TRUE(disk.is_mounted());
+}
+
+TEST_P(BlockTest, prefetch_reads_uncached_blocks_at_once) {
+    block->write(block_n, ref_data.data(), 0, block_size);
+    block->write(block_n + 1, ref_data.data(), 0, block_size);
+
+    Block prefetch_block(disk, MB);
+    prefetch_block.read(block_n, rdata.data(), 0, block_size);
+    disk.reset_io_stats();
+    EXPECT_EQ(prefetch_block.prefetch({block_n + 2, block_n, block_n + 1}), 2);
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 1);
+
+    prefetch_block.read(block_n + 1, rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+
+    DataBufferType scattered(block_size * 2);
+    std::vector<BlockReadVec> r_vecs = {{block_n + 2, &scattered[0]}, {block_n + 1, &scattered[block_size]}};
+    ASSERT_EQ(prefetch_block.read_blocks(r_vecs), 2);
+    EXPECT_TRUE(cmp_data(ref_data.data(), &scattered[block_size], block_size));
+
+    // Served from the cache only
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 1);
+    EXPECT_EQ(prefetch_block.get_cache().get_n_prefetched(), 2);
+    EXPECT_EQ(prefetch_block.get_cache().get_n_prefetch_hits(), 2);
+}
+
+TEST_P(BlockTest, two_q_prefetch_keeps_whole_batch) {
+    Block two_q_block(disk, MB, 8);
+    two_q_block.set_cache_policy(CachePolicy::TwoQ);
+
+    // Blocks missed again right after their eviction move to the working set, A1in is left to the batch
+    for (int32_t i = 0; i < 16; i++) {
+        two_q_block.read(block_n + i, rdata.data(), 0, block_size);
+    }
+    for (int32_t i = 4; i < 8; i++) {
+        two_q_block.read(block_n + i, rdata.data(), 0, block_size);
+    }
+
+    std::vector<int32_t> batch_block_ns;
+    for (int32_t i = 16; i < 23; i++) {
+        batch_block_ns.push_back(block_n + i);
+    }
+    EXPECT_EQ(two_q_block.prefetch(batch_block_ns), 7);
+
+    disk.reset_io_stats();
+    for (auto batch_block_n : batch_block_ns) {
+        two_q_block.read(batch_block_n, rdata.data(), 0, block_size);
+    }
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 0);
+    EXPECT_EQ(two_q_block.get_cache().get_n_prefetch_hits(), 7);
+}
+
+TEST_P(BlockTest, prefetch_throw_invalid_params) {
+    EXPECT_THROW(block->prefetch({MB.n_blocks}), std::invalid_argument);
+    EXPECT_THROW(block->prefetch(std::vector<int32_t>(default_block_cache_entries, block_n)), std::invalid_argument);
+}
+
+TEST_P(BlockTest, pin_read_views_cached_buffer) {
+    block->write(block_n, ref_data.data(), 0, block_size);
+
+    auto view = block->pin_read(block_n, block_size / 2, block_size / 4);
+    ASSERT_EQ(view.size(), block_size / 4);
+    EXPECT_TRUE(cmp_data(ref_data.data() + block_size / 2, view.data(), view.size()));
+    EXPECT_EQ(view.get_block_n(), block_n);
+
+    // Same buffer on the next pin, nothing read from the disk
+    disk.reset_io_stats();
+    auto view_again = block->pin_read(block_n, 0, block_size);
+    EXPECT_EQ(view_again.data() + block_size / 2, view.data());
+    EXPECT_EQ(disk.get_io_stats()->get_totals().n_reads, 0);
+
+    EXPECT_THROW(block->pin_read(MB.n_blocks, 0, block_size), std::invalid_argument);
+    EXPECT_THROW(block->pin_read(block_n, 1, block_size), std::invalid_argument);
+}
+
+TEST_P(BlockTest, pinned_block_survives_cache_pressure) {
+    Block single_entry_block(disk, MB, 1);
+    single_entry_block.write(block_n, ref_data.data(), 0, block_size);
+
+    auto view = single_entry_block.pin_read(block_n, 0, block_size);
+    EXPECT_THROW(single_entry_block.read(block_n + 1, rdata.data(), 0, block_size), std::runtime_error);
+    EXPECT_TRUE(cmp_data(ref_data.data(), view.data(), block_size));
+
+    BlockReadView moved_view = std::move(view);
+    EXPECT_FALSE(view.is_pinned());
+    moved_view.release();
+    EXPECT_EQ(single_entry_block.read(block_n + 1, rdata.data(), 0, block_size), block_size);
+}
+
+TEST_P(BlockTest, write_view_commit_stores_block) {
+    auto view = block->pin_write(block_n, 0, block_size / 2);
+    std::memcpy(view.data(), ref_data.data(), view.size());
+    block->commit(view);
+    EXPECT_FALSE(view.is_pinned());
+    EXPECT_EQ(block->get_cache().get_n_dirty(), 0);
+
+    Block uncached_block(disk, MB);
+    uncached_block.read(block_n, rdata.data(), 0, block_size / 2);
+    EXPECT_TRUE(cmp_data(ref_data.data(), rdata.data(), block_size / 2));
+
+    EXPECT_THROW(block->commit(view), std::invalid_argument);
+}
+
+TEST_P(BlockTest, released_write_view_stored_on_flush) {
+    {
+        auto view = block->pin_write(block_n + 1, 0, block_size);
+        std::memcpy(view.data(), ref_data.data(), view.size());
+    }
+    EXPECT_TRUE(block->get_cache().is_dirty(block_n + 1));
+
+    block->flush();
+    Block uncached_block(disk, MB);
+    uncached_block.read(block_n + 1, rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+}
+
 TEST_P(BlockTest, bytes_to_block) {
     EXPECT_EQ(block->bytes_to_blocks(0), 0);
     EXPECT_EQ(block->bytes_to_blocks(-1), 0);
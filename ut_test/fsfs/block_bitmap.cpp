@@ -144,6 +144,201 @@ TEST_P(BlockBitmapTest, next_free_not_even_bitmap_no_free) {
     EXPECT_EQ(bitmap->next_free(0), n_blocks - 2);
 }
 
+TEST_P(BlockBitmapTest, next_free_skips_free_blocks_before_offset) {
+    bitmap->resize(n_blocks);
+
+    for (auto i = 0; i < 3 * bitmap_row_length; i++) {
+        bitmap->set_status(i, 1);
+    }
+    bitmap->set_status(3, 0);
+    bitmap->set_status(2 * bitmap_row_length + 7, 0);
+
+    EXPECT_EQ(bitmap->next_free(0), 3);
+    EXPECT_EQ(bitmap->next_free(4), 2 * bitmap_row_length + 7);
+    EXPECT_EQ(bitmap->next_free(bitmap_row_length + 5), 2 * bitmap_row_length + 7);
+    EXPECT_EQ(bitmap->next_free(2 * bitmap_row_length + 8), 3 * bitmap_row_length);
+}
+
+TEST_P(BlockBitmapTest, counters_follow_set_status) {
+    bitmap->resize(n_blocks - 3);
+    EXPECT_EQ(bitmap->get_n_used(), 0);
+    EXPECT_EQ(bitmap->get_n_free(), n_blocks - 3);
+
+    bitmap->set_status(0, 1);
+    bitmap->set_status(0, 1);
+    bitmap->set_status(n_blocks - 4, 1);
+    bitmap->set_status(bitmap_row_length, 1);
+    bitmap->set_status(bitmap_row_length, 0);
+    bitmap->set_status(1, 0);
+    EXPECT_EQ(bitmap->get_n_used(), 2);
+    EXPECT_EQ(bitmap->get_n_free(), n_blocks - 5);
+    EXPECT_EQ(bitmap->count_used(), bitmap->get_n_used());
+
+    bitmap->resize(n_blocks);
+    EXPECT_EQ(bitmap->get_n_used(), 0);
+    EXPECT_EQ(bitmap->count_used(), 0);
+}
+
+TEST_P(BlockBitmapTest, count_used_throw_uninitialized) { EXPECT_THROW(bitmap->count_used(), std::runtime_error); }
+
+TEST_P(BlockBitmapTest, allocate_run_throw_invalid_params) {
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_THROW(bitmap->allocate_run(1, 1, 0, first_block_n), std::runtime_error);
+
+    bitmap->resize(n_blocks);
+    EXPECT_THROW(bitmap->allocate_run(0, 1, 0, first_block_n), std::invalid_argument);
+    EXPECT_THROW(bitmap->allocate_run(2, 1, 0, first_block_n), std::invalid_argument);
+    EXPECT_THROW(bitmap->allocate_run(1, 1, -1, first_block_n), std::invalid_argument);
+}
+
+TEST_P(BlockBitmapTest, allocate_run_skips_short_runs) {
+    bitmap->resize(n_blocks);
+
+    // Free runs of 3 at 0, 10 at row end over the row boundary, rest of the bitmap past them
+    int32_t long_run_n = bitmap_row_length - 4;
+    for (auto block_n : {3, long_run_n - 1, long_run_n + 10}) {
+        bitmap->set_status(block_n, 1);
+    }
+    for (auto block_n = 4; block_n < long_run_n - 1; block_n++) {
+        bitmap->set_status(block_n, 1);
+    }
+
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap->allocate_run(5, 8, 0, first_block_n), 8);
+    EXPECT_EQ(first_block_n, long_run_n);
+    for (auto block_n = long_run_n; block_n < long_run_n + 8; block_n++) {
+        EXPECT_TRUE(bitmap->get_status(block_n));
+    }
+    EXPECT_FALSE(bitmap->get_status(long_run_n + 8));
+
+    // Rest of the run too short now, the first one is long enough
+    EXPECT_EQ(bitmap->allocate_run(2, 2, 0, first_block_n), 2);
+    EXPECT_EQ(first_block_n, 0);
+    EXPECT_EQ(bitmap->allocate_run(3, 3, 0, first_block_n), 3);
+    EXPECT_EQ(first_block_n, long_run_n + 11);
+    EXPECT_EQ(bitmap->get_n_used(), bitmap->count_used());
+}
+
+TEST_P(BlockBitmapTest, allocate_run_wraps_past_hint) {
+    bitmap->resize(n_blocks);
+    for (auto block_n = 2; block_n < n_blocks; block_n++) {
+        bitmap->set_status(block_n, 1);
+    }
+
+    int32_t first_block_n = fs_nullptr;
+    EXPECT_EQ(bitmap->allocate_run(3, 3, 5, first_block_n), 0);
+    EXPECT_EQ(bitmap->allocate_run(1, 3, 5, first_block_n), 2);
+    EXPECT_EQ(first_block_n, 0);
+    EXPECT_EQ(bitmap->allocate_run(1, 1, n_blocks, first_block_n), 0);
+    EXPECT_EQ(bitmap->get_n_free(), 0);
+}
+
+TEST_P(BlockBitmapTest, allocate_run_whole_rows) {
+    bitmap->resize(n_blocks);
+    bitmap->set_status(1, 1);
+
+    int32_t first_block_n = fs_nullptr;
+    int32_t run_len = 3 * bitmap_row_length + 5;
+    EXPECT_EQ(bitmap->allocate_run(run_len, run_len, 0, first_block_n), run_len);
+    EXPECT_EQ(first_block_n, 2);
+    EXPECT_EQ(bitmap->next_free(0), 0);
+    EXPECT_EQ(bitmap->next_free(1), run_len + 2);
+    EXPECT_EQ(bitmap->count_used(), run_len + 1);
+}
+
+TEST_P(BlockBitmapTest, find_free_row_scans_agree) {
+    bitmap->resize(n_blocks);
+    for (auto i = 0; i < n_blocks; i++) {
+        bitmap->set_status(i, 1);
+    }
+
+    auto& rows = bitmap->get_rows();
+    for (auto block_n : {n_blocks - 1, n_blocks / 2, 9 * bitmap_row_length + 1, 0}) {
+        bitmap->set_status(block_n, 0);
+        for (size_t first_row = 0; first_row < rows.size(); first_row += 3) {
+            size_t ref_row = find_free_row_portable(rows.data(), first_row, rows.size());
+            ASSERT_EQ(find_free_row_avx2(rows.data(), first_row, rows.size()), ref_row);
+            ASSERT_EQ(find_free_row(rows.data(), first_row, rows.size()), ref_row);
+        }
+    }
+}
+
+TEST(BlockBitmapTest, next_free_across_summary_rows) {
+    // Summary of more than one row, last one partially used
+    constexpr int32_t row_length = std::numeric_limits<bitmap_t>::digits;
+    constexpr int32_t n_big_blocks = 3 * row_length * row_length + 5;
+    BlockBitmap bitmap(n_big_blocks);
+    for (int32_t block_n = 0; block_n < n_big_blocks; block_n++) {
+        bitmap.set_status(block_n, 1);
+    }
+    EXPECT_EQ(bitmap.next_free(0), -1);
+
+    for (auto block_n : {n_big_blocks - 1, 2 * row_length * row_length + 3, row_length * row_length - 1}) {
+        bitmap.set_status(block_n, 0);
+        EXPECT_EQ(bitmap.next_free(0), block_n);
+        EXPECT_EQ(bitmap.next_free(block_n), block_n);
+    }
+    EXPECT_EQ(bitmap.next_free(row_length * row_length), 2 * row_length * row_length + 3);
+
+    // Row full again is skipped
+    bitmap.set_status(row_length * row_length - 1, 1);
+    bitmap.set_status(2 * row_length * row_length + 3, 1);
+    EXPECT_EQ(bitmap.next_free(0), n_big_blocks - 1);
+}
+
+TEST(BlockBitmapTest, next_free_matches_linear_search) {
+    constexpr int32_t n_big_blocks = 1 << 19;
+    BlockBitmap bitmap(n_big_blocks);
+    std::vector<bool> ref_status(n_big_blocks);
+    srand(0xB17);
+
+    // Runs of 4096 allocations fill whole summary rows, single blocks are freed in between
+    for (int32_t op_n = 0; op_n < 1000; op_n++) {
+        int32_t block_n = rand() % n_big_blocks;
+        if (rand() % 4 != 0) {
+            bitmap.set_status(block_n, 0);
+            ref_status[block_n] = false;
+        } else {
+            int32_t first_n = block_n / 4096 * 4096;
+            for (int32_t fill_n = first_n; fill_n < std::min(first_n + 4096, n_big_blocks); fill_n++) {
+                bitmap.set_status(fill_n, 1);
+                ref_status[fill_n] = true;
+            }
+        }
+
+        int32_t offset = rand() % n_big_blocks;
+        int32_t ref_free = offset;
+        while (ref_free < n_big_blocks && ref_status[ref_free]) {
+            ref_free++;
+        }
+        ASSERT_EQ(bitmap.next_free(offset), ref_free == n_big_blocks ? -1 : ref_free);
+    }
+}
+
+TEST(BlockBitmapTest, load_rows_rebuilds_summary_and_counters) {
+    constexpr int32_t row_length = std::numeric_limits<bitmap_t>::digits;
+    constexpr int32_t n_big_blocks = 2 * row_length * row_length + 7;
+    BlockBitmap stored_bitmap(n_big_blocks);
+    for (int32_t block_n = 0; block_n < row_length * row_length + 3; block_n++) {
+        stored_bitmap.set_status(block_n, 1);
+    }
+
+    // Stored rows may come without the bits past the last block
+    std::vector<bitmap_t> rows = stored_bitmap.get_rows();
+    rows.back() = 0;
+
+    BlockBitmap bitmap(n_big_blocks);
+    bitmap.set_status(n_big_blocks - 1, 1);
+    bitmap.load_rows(rows.data());
+    EXPECT_EQ(bitmap.get_n_used(), row_length * row_length + 3);
+    EXPECT_EQ(bitmap.count_used(), bitmap.get_n_used());
+    EXPECT_EQ(bitmap.next_free(0), row_length * row_length + 3);
+    EXPECT_EQ(bitmap.get_rows(), stored_bitmap.get_rows());
+
+    BlockBitmap uninitialized_bitmap;
+    EXPECT_THROW(uninitialized_bitmap.load_rows(rows.data()), std::runtime_error);
+}
+
 INSTANTIATE_TEST_SUITE_P(BlockSize, BlockBitmapTest, testing::ValuesIn(valid_block_sizes));
 
 }
\ No newline at end of file
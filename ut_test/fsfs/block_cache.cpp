@@ -0,0 +1,194 @@
+#include "fsfs/block_cache.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr int32_t n_test_entries = 4;
+
+class BlockCacheTest : public ::testing::TestWithParam<int32_t>, public TestBaseBasic {
+   protected:
+    BlockCache cache{n_test_entries, block_size};
+
+    void fill_cache(int32_t first_block_n, int32_t n_blocks) {
+        for (int32_t block_n = first_block_n; block_n < first_block_n + n_blocks; block_n++) {
+            *cache.insert(block_n) = static_cast<uint8_t>(block_n);
+        }
+    }
+};
+
+TEST(BlockCacheTest, constructor_throw_no_entries) {
+    EXPECT_THROW(BlockCache(0, block_size_quant), std::invalid_argument);
+}
+
+TEST_P(BlockCacheTest, lookup_counts_hits_and_misses) {
+    EXPECT_EQ(cache.lookup(1), nullptr);
+    fill_cache(1, 1);
+
+    uint8_t* cached_data = cache.lookup(1);
+    ASSERT_NE(cached_data, nullptr);
+    EXPECT_EQ(*cached_data, 1);
+    EXPECT_EQ(cache.get_n_hits(), 1);
+    EXPECT_EQ(cache.get_n_misses(), 1);
+
+    cache.reset_stats();
+    EXPECT_EQ(cache.get_n_hits(), 0);
+    EXPECT_EQ(cache.get_n_misses(), 0);
+}
+
+TEST_P(BlockCacheTest, evicts_least_recently_used) {
+    fill_cache(0, n_test_entries);
+
+    // Block 0 used again, block 1 becomes the least recently used one
+    cache.lookup(0);
+    fill_cache(n_test_entries, 1);
+
+    EXPECT_EQ(cache.find(1), nullptr);
+    EXPECT_NE(cache.find(0), nullptr);
+    for (int32_t block_n = 2; block_n <= n_test_entries; block_n++) {
+        ASSERT_NE(cache.find(block_n), nullptr);
+        EXPECT_EQ(*cache.find(block_n), block_n);
+    }
+}
+
+TEST_P(BlockCacheTest, find_does_not_change_order_nor_counters) {
+    fill_cache(0, n_test_entries);
+
+    cache.find(0);
+    fill_cache(n_test_entries, 1);
+
+    EXPECT_EQ(cache.find(0), nullptr);
+    EXPECT_EQ(cache.get_n_hits(), 0);
+    EXPECT_EQ(cache.get_n_misses(), 0);
+}
+
+TEST_P(BlockCacheTest, invalidated_entry_reused_first) {
+    fill_cache(0, n_test_entries);
+
+    cache.invalidate(n_test_entries - 1);
+    EXPECT_EQ(cache.find(n_test_entries - 1), nullptr);
+
+    fill_cache(n_test_entries, 1);
+    for (int32_t block_n = 0; block_n < n_test_entries - 1; block_n++) {
+        EXPECT_NE(cache.find(block_n), nullptr);
+    }
+    EXPECT_NE(cache.find(n_test_entries), nullptr);
+}
+
+TEST_P(BlockCacheTest, clear_drops_every_entry) {
+    fill_cache(0, n_test_entries);
+
+    cache.clear();
+    for (int32_t block_n = 0; block_n < n_test_entries; block_n++) {
+        EXPECT_EQ(cache.find(block_n), nullptr);
+    }
+}
+
+TEST_P(BlockCacheTest, dirty_blocks_collected_in_block_order) {
+    fill_cache(0, n_test_entries);
+
+    cache.mark_dirty(3);
+    cache.mark_dirty(1);
+    cache.mark_dirty(1);
+    EXPECT_EQ(cache.get_n_dirty(), 2);
+    EXPECT_TRUE(cache.is_dirty(1));
+    EXPECT_FALSE(cache.is_dirty(0));
+
+    std::vector<int32_t> dirty_block_ns;
+    cache.collect_dirty(dirty_block_ns);
+    EXPECT_EQ(dirty_block_ns, std::vector<int32_t>({1, 3}));
+
+    cache.mark_clean(3);
+    EXPECT_EQ(cache.get_n_dirty(), 1);
+    EXPECT_THROW(cache.mark_dirty(n_test_entries), std::invalid_argument);
+}
+
+TEST_P(BlockCacheTest, victim_is_least_recently_used_block) {
+    EXPECT_EQ(cache.get_victim(), fs_nullptr);
+
+    fill_cache(0, n_test_entries);
+    EXPECT_EQ(cache.get_victim(), 0);
+
+    cache.mark_dirty(0);
+    fill_cache(n_test_entries, 1);
+    EXPECT_EQ(cache.get_victim(), 1);
+    EXPECT_EQ(cache.get_n_dirty(), 0);
+}
+
+TEST_P(BlockCacheTest, invalidate_and_clear_drop_dirty_state) {
+    fill_cache(0, n_test_entries);
+    cache.mark_dirty(0);
+    cache.mark_dirty(1);
+
+    cache.invalidate(0);
+    EXPECT_FALSE(cache.is_dirty(0));
+    EXPECT_EQ(cache.get_n_dirty(), 1);
+
+    cache.clear();
+    EXPECT_EQ(cache.get_n_dirty(), 0);
+}
+
+TEST_P(BlockCacheTest, prefetched_block_counted_on_first_use) {
+    fill_cache(0, 2);
+    cache.mark_prefetched(1);
+    EXPECT_EQ(cache.get_n_prefetched(), 1);
+
+    EXPECT_FALSE(cache.consume_prefetched(0));
+    EXPECT_TRUE(cache.consume_prefetched(1));
+    EXPECT_FALSE(cache.consume_prefetched(1));
+    EXPECT_EQ(cache.get_n_prefetch_hits(), 1);
+
+    // Evicted before use does not count
+    cache.mark_prefetched(0);
+    cache.invalidate(0);
+    EXPECT_FALSE(cache.consume_prefetched(0));
+    EXPECT_THROW(cache.mark_prefetched(0), std::invalid_argument);
+}
+
+TEST_P(BlockCacheTest, pinned_entry_not_reused) {
+    fill_cache(0, n_test_entries);
+
+    // Block 0 is the least recently used one, block 1 goes instead
+    {
+        BlockReadView view(cache, cache.pin(0), 0, cache.find(0), block_size);
+        EXPECT_EQ(cache.get_victim(), 1);
+        fill_cache(n_test_entries, 1);
+        EXPECT_EQ(cache.find(1), nullptr);
+        EXPECT_EQ(*view.data(), 0);
+        EXPECT_THROW(cache.clear(), std::runtime_error);
+    }
+    EXPECT_EQ(cache.get_n_pins(), 0);
+    EXPECT_FALSE(cache.is_dirty(0));
+}
+
+TEST_P(BlockCacheTest, insert_throw_all_entries_pinned) {
+    fill_cache(0, n_test_entries);
+
+    std::vector<BlockWriteView> views;
+    for (int32_t block_n = 0; block_n < n_test_entries; block_n++) {
+        views.emplace_back(cache, cache.pin(block_n), block_n, cache.find(block_n), block_size);
+    }
+    EXPECT_THROW(cache.insert(n_test_entries), std::runtime_error);
+    EXPECT_THROW(cache.pin(n_test_entries), std::invalid_argument);
+
+    // Writable views leave their blocks dirty
+    views.clear();
+    EXPECT_EQ(cache.get_n_dirty(), n_test_entries);
+    EXPECT_NE(cache.insert(n_test_entries), nullptr);
+}
+
+TEST_P(BlockCacheTest, warm_cache_does_not_allocate) {
+    fill_cache(0, n_test_entries);
+
+    AllocCounter alloc_counter;
+    for (int32_t block_n = 0; block_n < 16 * n_test_entries; block_n++) {
+        if (cache.lookup(block_n) == nullptr) {
+            fill_cache(block_n, 1);
+        }
+        cache.invalidate(block_n / 2);
+    }
+    EXPECT_EQ(alloc_counter.get_n_allocs(), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, BlockCacheTest, testing::ValuesIn(valid_block_sizes));
+}
@@ -0,0 +1,144 @@
+#include "fsfs/block_checksums.hpp"
+
+#include "fsfs/block.hpp"
+#include "fsfs/crc32c.hpp"
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+uint32_t crc32c_table_entry(uint32_t byte) {
+    uint32_t crc = byte;
+    for (int32_t bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (crc & 1 ? 0x82F63B78 : 0);
+    }
+    return crc;
+}
+
+// Last 4 bytes are rewritten so the CRC32C of the whole buffer is 0. Table indices giving
+// the final register are found from its top byte down, then the bytes hitting them follow.
+void force_zero_crc(std::vector<uint8_t>& data) {
+    uint32_t reg = ~0u;
+    uint32_t idx[4];
+    for (int32_t i = 3; i >= 0; i--) {
+        for (idx[i] = 0; (crc32c_table_entry(idx[i]) >> 24) != (reg >> 24); idx[i]++) {
+        }
+        reg = (reg ^ crc32c_table_entry(idx[i])) << 8;
+    }
+
+    size_t tail_n = data.size() - 4;
+    reg = ~crc32c(data.data(), tail_n);
+    for (int32_t i = 0; i < 4; i++) {
+        data[tail_n + i] = (reg ^ idx[i]) & 0xFF;
+        reg = (reg >> 8) ^ crc32c_table_entry(idx[i]);
+    }
+}
+
+class BlockChecksumsTest : public ::testing::TestWithParam<int32_t>, public TestBaseFileSystem {
+   protected:
+    std::unique_ptr<Block> block;
+    int32_t block_n = 0;
+    DataBufferType ref_data;
+    DataBufferType rdata;
+
+    void corrupt_block(int32_t corrupted_block_n) {
+        DataBufferType raw_data(block_size);
+        disk.mount();
+        disk.read(corrupted_block_n, raw_data.data(), block_size);
+        raw_data[block_size / 2] ^= 0x01;
+        disk.write(corrupted_block_n, raw_data.data(), block_size);
+        disk.unmount();
+    }
+
+   public:
+    void SetUp() override {
+        FileSystem::format(disk, fs_feature_block_checksums);
+        disk.mount();
+        disk.read(fs_offset_super_block, cast_to_data(&MB), sizeof(super_block));
+        disk.unmount();
+
+        block = std::make_unique<Block>(disk, MB);
+        block_n = fs_offset_inode_block + MB.n_inode_blocks;
+        ref_data.resize(block_size);
+        rdata.resize(block_size);
+        fill_dummy(ref_data);
+    }
+};
+
+TEST_P(BlockChecksumsTest, table_reserved_at_disk_end) {
+    EXPECT_EQ(MB.n_csum_blocks, BlockChecksums::calc_n_csum_blocks(n_blocks, block_size));
+    EXPECT_EQ(MB.n_data_blocks, n_blocks - 1 - MB.n_inode_blocks - MB.n_csum_blocks);
+    EXPECT_TRUE(block->get_checksums().is_enabled());
+}
+
+TEST_P(BlockChecksumsTest, disabled_without_feature) {
+    block.reset();
+    FileSystem::format(disk);
+    disk.mount();
+    disk.read(fs_offset_super_block, cast_to_data(&MB), sizeof(super_block));
+    disk.unmount();
+
+    Block plain_block(disk, MB);
+    EXPECT_EQ(MB.n_csum_blocks, 0);
+    EXPECT_FALSE(plain_block.get_checksums().is_enabled());
+}
+
+TEST_P(BlockChecksumsTest, written_block_verified_after_remount) {
+    block->write(block_n, ref_data.data(), 0, block_size);
+    block.reset();
+
+    block = std::make_unique<Block>(disk, MB);
+    block->read(block_n, rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+    EXPECT_EQ(block->get_checksums().get_n_verified(), 1);
+    EXPECT_EQ(block->get_checksums().get_n_mismatches(), 0);
+}
+
+TEST_P(BlockChecksumsTest, never_written_block_not_verified) {
+    block->read(block_n + 1, rdata.data(), 0, block_size);
+    EXPECT_EQ(block->get_checksums().get_n_verified(), 0);
+}
+
+TEST_P(BlockChecksumsTest, read_throw_corrupted_block) {
+    block->set_write_mode(WriteMode::WriteBack);
+    block->write(block_n, ref_data.data(), 0, block_size / 2);
+    block.reset();
+    corrupt_block(block_n);
+
+    block = std::make_unique<Block>(disk, MB);
+    EXPECT_THROW(block->read(block_n, rdata.data(), 0, block_size), std::runtime_error);
+    EXPECT_EQ(block->get_checksums().get_n_mismatches(), 1);
+
+    std::vector<BlockReadVec> read_vecs = {{block_n, rdata.data()}};
+    EXPECT_THROW(block->read_blocks(read_vecs), std::runtime_error);
+}
+
+TEST_P(BlockChecksumsTest, corrupted_prefetch_dropped) {
+    std::vector<BlockWriteVec> write_vecs = {{block_n, ref_data.data()}};
+    block->write_blocks(write_vecs);
+    block.reset();
+    corrupt_block(block_n);
+
+    block = std::make_unique<Block>(disk, MB);
+    EXPECT_EQ(block->prefetch({block_n}), 0);
+    EXPECT_EQ(block->get_cache().get_n_prefetched(), 0);
+
+    // Next read goes to the disk again and reports the corruption
+    EXPECT_THROW(block->read(block_n, rdata.data(), 0, block_size), std::runtime_error);
+}
+
+TEST_P(BlockChecksumsTest, zero_crc_block_verified) {
+    force_zero_crc(ref_data);
+    ASSERT_EQ(crc32c(ref_data.data(), block_size), 0u);
+
+    block->set_write_mode(WriteMode::WriteBack);
+    block->write(block_n, ref_data.data(), 0, block_size);
+    block.reset();
+    corrupt_block(block_n);
+
+    block = std::make_unique<Block>(disk, MB);
+    EXPECT_THROW(block->read(block_n, rdata.data(), 0, block_size), std::runtime_error);
+    EXPECT_EQ(block->get_checksums().get_n_verified(), 1);
+    EXPECT_EQ(block->get_checksums().get_n_mismatches(), 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, BlockChecksumsTest, testing::ValuesIn(valid_block_sizes));
+}
@@ -0,0 +1,52 @@
+#include "fsfs/block_geometry.hpp"
+
+#include <type_traits>
+
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+class BlockGeometryTest : public ::testing::TestWithParam<int32_t>, public TestBaseBasic {
+   protected:
+    // Size of the geometry picked by the dispatch, 0 for the generic one
+    int32_t dispatched_size(BlockArithmetic arithmetic) {
+        return dispatch_block_geometry(block_size, arithmetic, [](auto geometry) -> int32_t {
+            return std::is_same<decltype(geometry), BlockGeometry>::value ? 0 : geometry.size();
+        });
+    }
+};
+
+template <int32_t BlockSize>
+void expect_same_as_generic() {
+    FixedBlockGeometry<BlockSize> fixed;
+    BlockGeometry generic(BlockSize);
+    for (int32_t n_bytes = 0; n_bytes < 4 * BlockSize; n_bytes += 7) {
+        ASSERT_EQ(fixed.block_of(n_bytes), generic.block_of(n_bytes));
+        ASSERT_EQ(fixed.offset_in_block(n_bytes), generic.offset_in_block(n_bytes));
+        ASSERT_EQ(fixed.blocks_for(n_bytes), generic.blocks_for(n_bytes));
+    }
+    EXPECT_EQ(fixed.n_addresses(), generic.n_addresses());
+    EXPECT_EQ(fixed.n_inodes(), generic.n_inodes());
+}
+
+TEST(BlockGeometryTest, fixed_matches_generic) {
+    expect_same_as_generic<1024>();
+    expect_same_as_generic<2048>();
+    expect_same_as_generic<4096>();
+}
+
+TEST(BlockGeometryTest, fixed_folds_to_constants) {
+    static_assert(FixedBlockGeometry<4096>::shift == 12, "");
+    static_assert(FixedBlockGeometry<4096>::blocks_for(4097) == 2, "");
+    static_assert(FixedBlockGeometry<1024>::offset_in_block(1025) == 1, "");
+    EXPECT_EQ(BlockGeometry(3072).blocks_for(3073), 2);
+    EXPECT_EQ(BlockGeometry(3072).blocks_for(0), 0);
+}
+
+TEST_P(BlockGeometryTest, dispatch_picks_fixed_for_powers_of_two) {
+    bool is_specialized = block_size == 1024 || block_size == 2048 || block_size == 4096;
+    EXPECT_EQ(dispatched_size(BlockArithmetic::Specialized), is_specialized ? block_size : 0);
+    EXPECT_EQ(dispatched_size(BlockArithmetic::Generic), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, BlockGeometryTest, testing::ValuesIn(valid_block_sizes));
+}
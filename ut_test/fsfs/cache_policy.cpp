@@ -0,0 +1,108 @@
+#include "fsfs/cache_policy.hpp"
+
+#include "fsfs/block_cache.hpp"
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr int32_t n_test_entries = 8;
+
+class CachePolicyTest : public ::testing::TestWithParam<int32_t>, public TestBaseBasic {
+   protected:
+    BlockCache cache{n_test_entries, block_size, CachePolicy::TwoQ};
+
+    void touch(int32_t block_n) {
+        if (cache.lookup(block_n) == nullptr) {
+            *cache.insert(block_n) = static_cast<uint8_t>(block_n);
+        }
+    }
+
+    void sweep(int32_t first_block_n, int32_t n_blocks) {
+        for (int32_t block_n = first_block_n; block_n < first_block_n + n_blocks; block_n++) {
+            touch(block_n);
+        }
+    }
+};
+
+TEST(CachePolicyTest, free_entries_reused_first) {
+    for (auto policy : {CachePolicy::Lru, CachePolicy::TwoQ}) {
+        auto replacer = CacheReplacer::make(policy);
+        replacer->reset(2);
+
+        int32_t entry_n = replacer->victim();
+        replacer->on_insert(entry_n, 0, fs_nullptr);
+        EXPECT_NE(replacer->victim(), entry_n);
+
+        replacer->set_pinned(1 - entry_n, true);
+        EXPECT_EQ(replacer->victim(), entry_n);
+        replacer->set_pinned(entry_n, true);
+        EXPECT_EQ(replacer->victim(), fs_nullptr);
+
+        replacer->set_pinned(entry_n, false);
+        replacer->on_free(entry_n);
+        EXPECT_EQ(replacer->victim(), entry_n);
+    }
+}
+
+TEST(CachePolicyTest, lru_evicts_least_recently_used) {
+    auto replacer = CacheReplacer::make(CachePolicy::Lru);
+    replacer->reset(3);
+    for (int32_t block_n = 0; block_n < 3; block_n++) {
+        replacer->on_insert(replacer->victim(), block_n, fs_nullptr);
+    }
+
+    int32_t oldest_entry_n = replacer->victim();
+    replacer->on_hit(oldest_entry_n);
+    EXPECT_NE(replacer->victim(), oldest_entry_n);
+}
+
+TEST_P(CachePolicyTest, working_set_survives_sweep) {
+    // Blocks used again after leaving A1in join the working set
+    constexpr int32_t n_hot_blocks = 4;
+    sweep(0, n_hot_blocks);
+    sweep(100, n_test_entries);
+    sweep(0, n_hot_blocks);
+
+    sweep(1000, 4 * n_test_entries);
+
+    cache.reset_stats();
+    sweep(0, n_hot_blocks);
+    EXPECT_EQ(cache.get_n_hits(), n_hot_blocks);
+}
+
+TEST_P(CachePolicyTest, lru_loses_working_set_to_sweep) {
+    cache.set_policy(CachePolicy::Lru);
+    constexpr int32_t n_hot_blocks = 4;
+    sweep(0, n_hot_blocks);
+    sweep(0, n_hot_blocks);
+
+    sweep(1000, n_test_entries);
+
+    cache.reset_stats();
+    sweep(0, n_hot_blocks);
+    EXPECT_EQ(cache.get_n_hits(), 0);
+}
+
+TEST_P(CachePolicyTest, hits_in_a1_in_do_not_promote) {
+    sweep(0, 1);
+    for (int32_t i = 0; i < 3; i++) {
+        touch(0);
+    }
+
+    // Block 0 only used while new, the sweep pushes it out like any other block
+    sweep(1000, n_test_entries);
+    EXPECT_EQ(cache.find(0), nullptr);
+}
+
+TEST_P(CachePolicyTest, set_policy_throw_pinned) {
+    touch(0);
+    {
+        BlockReadView view(cache, cache.pin(0), 0, cache.find(0), block_size);
+        EXPECT_THROW(cache.set_policy(CachePolicy::Lru), std::runtime_error);
+    }
+    cache.set_policy(CachePolicy::Lru);
+    EXPECT_EQ(cache.get_policy(), CachePolicy::Lru);
+    EXPECT_EQ(cache.find(0), nullptr);
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, CachePolicyTest, testing::ValuesIn(valid_block_sizes));
+}
@@ -0,0 +1,50 @@
+#include "fsfs/crc32c.hpp"
+
+#include <cstring>
+#include <vector>
+
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr char check_input[] = "123456789";
+constexpr uint32_t check_crc = 0xE3069283;
+
+const uint8_t* check_data() { return reinterpret_cast<const uint8_t*>(check_input); }
+
+TEST(Crc32cTest, check_value) {
+    EXPECT_EQ(crc32c_portable(check_data(), std::strlen(check_input)), check_crc);
+    EXPECT_EQ(crc32c(check_data(), std::strlen(check_input)), check_crc);
+}
+
+TEST(Crc32cTest, empty_input) {
+    EXPECT_EQ(crc32c_portable(nullptr, 0), 0u);
+    EXPECT_EQ(crc32c(nullptr, 0), 0u);
+}
+
+TEST(Crc32cTest, chained_calls_equal_single_call) {
+    size_t length = std::strlen(check_input);
+    for (size_t split = 0; split <= length; split++) {
+        uint32_t crc = crc32c(check_data(), split);
+        EXPECT_EQ(crc32c(check_data() + split, length - split, crc), check_crc);
+    }
+}
+
+TEST(Crc32cTest, hw_equals_portable) {
+    if (!crc32c_hw_supported()) {
+        GTEST_SKIP() << "No CRC32C instruction on this host.";
+    }
+
+    std::vector<uint8_t> data(4096 + 16);
+    srand(0xCAFE);
+    for (auto& el : data) {
+        el = static_cast<uint8_t>(rand());
+    }
+
+    // Unaligned heads and tails go through the byte loop, lengths around 768 bytes around the three lane loop
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t length : {0, 1, 7, 8, 9, 63, 767, 768, 769, 1024, 2311, 4096}) {
+            EXPECT_EQ(crc32c_hw(&data[offset], length), crc32c_portable(&data[offset], length));
+        }
+    }
+}
+}
@@ -3,6 +3,7 @@
 #include "fsfs/block.hpp"
 #include "fsfs/block_bitmap.hpp"
 #include "fsfs/inode.hpp"
+#include "alloc_counter.hpp"
 #include "test_base.hpp"
 using namespace FSFS;
 namespace {
@@ -278,7 +279,560 @@ TEST_P(FileSystemTest, write_with_offset_and_overflown_length) {
     check_stored_blocks(inode_n, ref_data);
 }
 
+TEST_P(FileSystemTest, write_programs_every_data_block_once) {
+    int32_t data_len = block_size * 4;
+    DataBufferType ref_data(data_len);
+    fill_dummy(ref_data);
+
+    int32_t inode_n = fs->create_file(valid_file_name);
+    disk.reset_io_stats();
+    EXPECT_EQ(fs->write(inode_n, ref_data.data(), 0, data_len), data_len);
+
+    Inode inode;
+    Block block(disk, MB);
+    inode.load(inode_n, block);
+    for (auto i = 0; i < block.bytes_to_blocks(data_len); i++) {
+        EXPECT_EQ(disk.get_io_stats()->get_block_writes(block.data_n_to_block_n(inode.ptr(i))), 1);
+    }
+}
+
+TEST_P(FileSystemTest, write_new_blocks_without_reading_them) {
+    int32_t data_len = block_size * 2 + block_size / 2;
+    DataBufferType ref_data(data_len);
+    fill_dummy(ref_data);
+
+    int32_t inode_n = fs->create_file(valid_file_name);
+    disk.reset_io_stats();
+    EXPECT_EQ(fs->write(inode_n, ref_data.data(), 0, data_len), data_len);
+
+    Inode inode;
+    Block block(disk, MB);
+    inode.load(inode_n, block);
+    for (auto i = 0; i < block.bytes_to_blocks(data_len); i++) {
+        EXPECT_EQ(disk.get_io_stats()->get_block_reads(block.data_n_to_block_n(inode.ptr(i))), 0);
+    }
+    check_stored_blocks(inode_n, ref_data);
+}
+
+TEST_P(FileSystemTest, write_back_cuts_physical_writes) {
+    constexpr int32_t n_appends = 16;
+    int32_t append_len = block_size / 2;
+    DataBufferType ref_data(append_len * n_appends);
+    fill_dummy(ref_data);
+
+    auto append_file = [&](int32_t inode_n) {
+        disk.reset_io_stats();
+        for (int32_t i = 0; i < n_appends; i++) {
+            fs->write(inode_n, &ref_data[i * append_len], 0, append_len);
+        }
+        fs->flush();
+        return disk.get_io_stats()->get_totals().n_blocks_written;
+    };
+
+    int32_t write_through_inode_n = fs->create_file(valid_file_name);
+    auto n_write_through_blocks = append_file(write_through_inode_n);
+
+    fs->set_write_mode(WriteMode::WriteBack);
+    int32_t write_back_inode_n = fs->create_file(valid_file_name);
+    auto n_write_back_blocks = append_file(write_back_inode_n);
+
+    EXPECT_LT(n_write_back_blocks * 2, n_write_through_blocks);
+    check_stored_blocks(write_through_inode_n, ref_data);
+    check_stored_blocks(write_back_inode_n, ref_data);
+}
+
+TEST_P(FileSystemTest, unmount_flushes_dirty_blocks) {
+    fs->set_write_mode(WriteMode::WriteBack);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    DataBufferType ref_data(block_size / 2);
+    fill_dummy(ref_data);
+    fs->write(inode_n, ref_data.data(), 0, ref_data.size());
+    EXPECT_GT(fs->get_block_cache().get_n_dirty(), 0);
+
+    fs->unmount();
+    EXPECT_EQ(fs->get_block_cache().get_n_dirty(), 0);
+    check_stored_blocks(inode_n, ref_data);
+    fs->mount();
+}
+
+TEST_P(FileSystemTest, chunked_sequential_read_uses_read_ahead) {
+    int32_t data_len = block_size * 24;
+    DataBufferType ref_data(data_len);
+    fill_dummy(ref_data);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, ref_data.data(), 0, data_len);
+
+    DataBufferType rdata(data_len);
+    for (int32_t offset = 0; offset < data_len; offset += block_size) {
+        ASSERT_EQ(fs->read(inode_n, &rdata[offset], offset, block_size), block_size);
+    }
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+
+    // Every block after the first one was prefetched and used
+    auto& cache = fs->get_block_cache();
+    EXPECT_EQ(cache.get_n_prefetched(), data_len / block_size - 1);
+    EXPECT_EQ(cache.get_n_prefetch_hits(), cache.get_n_prefetched());
+    EXPECT_EQ(fs->get_read_ahead().get_window(), default_read_ahead_window);
+}
+
+TEST_P(FileSystemTest, read_ahead_disabled) {
+    int32_t data_len = block_size * 4;
+    DataBufferType ref_data(data_len);
+    fill_dummy(ref_data);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, ref_data.data(), 0, data_len);
+
+    fs->set_read_ahead(0);
+    DataBufferType rdata(data_len);
+    for (int32_t offset = 0; offset < data_len; offset += block_size) {
+        fs->read(inode_n, &rdata[offset], offset, block_size);
+    }
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+    EXPECT_EQ(fs->get_block_cache().get_n_prefetched(), 0);
+
+    EXPECT_THROW(fs->set_read_ahead(-1), std::invalid_argument);
+    EXPECT_THROW(fs->set_read_ahead(default_block_cache_entries), std::invalid_argument);
+}
+
+TEST_P(FileSystemTest, two_q_sequential_read_with_small_cache) {
+    int32_t data_len = block_size * 48;
+    DataBufferType ref_data(data_len);
+    fill_dummy(ref_data);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, ref_data.data(), 0, data_len);
+
+    for (int32_t n_cache_entries : {6, 8, 12, 16, 32}) {
+        FileSystem small_cache_fs(disk, n_cache_entries);
+        small_cache_fs.mount();
+        small_cache_fs.set_cache_policy(CachePolicy::TwoQ);
+
+        // Window goes no further than the A1in share, a batch never evicts itself
+        int32_t max_admitted = small_cache_fs.get_block_cache().get_max_admitted();
+        EXPECT_EQ(small_cache_fs.get_read_ahead().get_max_window(), max_admitted);
+        EXPECT_THROW(small_cache_fs.set_read_ahead(max_admitted + 1), std::invalid_argument);
+
+        DataBufferType rdata(data_len);
+        for (int32_t offset = 0; offset < data_len; offset += block_size) {
+            ASSERT_EQ(small_cache_fs.read(inode_n, &rdata[offset], offset, block_size), block_size);
+        }
+        EXPECT_TRUE(cmp_data(ref_data, rdata));
+        EXPECT_GT(small_cache_fs.get_block_cache().get_n_prefetch_hits(), 0);
+        small_cache_fs.unmount();
+    }
+}
+
+TEST_P(FileSystemTest, read_view_spans_file_blocks) {
+    int32_t data_len = block_size * 2 + block_size / 2;
+    DataBufferType ref_data(data_len);
+    fill_dummy(ref_data);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, ref_data.data(), 0, data_len);
+
+    DataBufferType rdata;
+    for (int32_t offset = 0; offset < data_len;) {
+        auto view = fs->read_view(inode_n, offset, data_len);
+        ASSERT_GT(view.size(), 0);
+        EXPECT_LE(view.size(), block_size);
+        rdata.insert(rdata.end(), view.begin(), view.end());
+        offset += view.size();
+    }
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+
+    // Clipped to the block end and to the file end
+    EXPECT_EQ(fs->read_view(inode_n, block_size / 2, block_size).size(), block_size / 2);
+    EXPECT_EQ(fs->read_view(inode_n, data_len - 1, block_size).size(), 1);
+    EXPECT_EQ(fs->get_block_cache().get_n_pins(), 0);
+}
+
+TEST_P(FileSystemTest, read_view_empty_for_invalid_params) {
+    int32_t inode_n = fs->create_file(valid_file_name);
+    DataBufferType ref_data(block_size);
+    fs->write(inode_n, ref_data.data(), 0, block_size);
+
+    EXPECT_FALSE(fs->read_view(inode_n, block_size, 1).is_pinned());
+    EXPECT_FALSE(fs->read_view(inode_n, -1, 1).is_pinned());
+    EXPECT_FALSE(fs->read_view(inode_n, 0, 0).is_pinned());
+    EXPECT_FALSE(fs->read_view(MB.n_inode_blocks - 1, 0, 1).is_pinned());
+}
+
+TEST_P(FileSystemTest, checksummed_file_system_detects_corruption) {
+    fs->unmount();
+    FileSystem::format(disk, fs_feature_block_checksums);
+    fs->mount();
+    EXPECT_TRUE(fs->get_block_checksums().is_enabled());
+
+    DataBufferType wdata(2 * block_size);
+    DataBufferType rdata(wdata.size());
+    fill_dummy(wdata);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, wdata.data(), 0, wdata.size());
+    fs->unmount();
+
+    fs->mount();
+    EXPECT_EQ(fs->read(inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+    EXPECT_TRUE(cmp_data(wdata, rdata));
+    EXPECT_EQ(fs->get_block_checksums().get_n_mismatches(), 0);
+    fs->unmount();
+
+    // Flip one byte of the first data block behind the file system's back
+    disk.mount();
+    disk.read(fs_offset_super_block, cast_to_data(&MB), sizeof(super_block));
+    int32_t block_n = fs_offset_inode_block + MB.n_inode_blocks;
+    disk.read(block_n, rdata.data(), block_size);
+    rdata[0] ^= 0xFF;
+    disk.write(block_n, rdata.data(), block_size);
+    disk.unmount();
+
+    fs->mount();
+    EXPECT_THROW(fs->read(inode_n, rdata.data(), 0, rdata.size()), std::runtime_error);
+}
+
+// Image copied before unmount stands for a crash, the table on it must already cover every write
+TEST_P(FileSystemTest, checksummed_write_through_survives_crash) {
+    constexpr char crash_disk_name[] = "_tmp_crash_disk.img";
+    fs->unmount();
+    FileSystem::format(disk, fs_feature_block_checksums);
+    fs->mount();
+
+    DataBufferType wdata(3 * block_size);
+    DataBufferType rdata(wdata.size());
+    fill_dummy(wdata);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, wdata.data(), 0, block_size + block_size / 2);
+    fs->flush();
+
+    // Inode and last data block written again after the table was stored
+    fs->write(inode_n, &wdata[block_size + block_size / 2], 0, wdata.size() - block_size - block_size / 2);
+    disk.dump(crash_disk_name);
+
+    Disk crash_disk(block_size);
+    crash_disk.open(crash_disk_name);
+    {
+        FileSystem crash_fs(crash_disk);
+        crash_fs.mount();
+        EXPECT_EQ(crash_fs.read(inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+        EXPECT_TRUE(cmp_data(wdata, rdata));
+        EXPECT_EQ(crash_fs.get_block_checksums().get_n_mismatches(), 0);
+        crash_fs.unmount();
+    }
+    std::remove(crash_disk_name);
+}
+
+// Data written after the table block went to the disk, as if the crash came between the two writes
+TEST_P(FileSystemTest, unclean_checksummed_image_mounts) {
+    constexpr char stale_disk_name[] = "_tmp_stale_disk.img";
+    constexpr char crash_disk_name[] = "_tmp_crash_disk.img";
+    fs->unmount();
+    FileSystem::format(disk, fs_feature_allocation_bitmaps | fs_feature_block_checksums);
+    fs->mount();
+
+    DataBufferType wdata(3 * block_size);
+    DataBufferType rdata(wdata.size());
+    fill_dummy(wdata);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, wdata.data(), 0, block_size + block_size / 2);
+    disk.dump(stale_disk_name);
+    fs->write(inode_n, &wdata[block_size + block_size / 2], 0, wdata.size() - block_size - block_size / 2);
+    disk.dump(crash_disk_name);
+
+    Disk stale_disk(block_size);
+    Disk crash_disk(block_size);
+    stale_disk.open(stale_disk_name);
+    crash_disk.open(crash_disk_name);
+    stale_disk.mount();
+    crash_disk.mount();
+    super_block crash_MB;
+    crash_disk.read(fs_offset_super_block, cast_to_data(&crash_MB), sizeof(super_block));
+    int32_t first_csum_block_n = crash_MB.n_blocks - crash_MB.n_csum_blocks;
+    DataBufferType stale_table(crash_MB.n_csum_blocks * block_size);
+    stale_disk.read_blocks(first_csum_block_n, crash_MB.n_csum_blocks, stale_table.data());
+    crash_disk.write_blocks(first_csum_block_n, crash_MB.n_csum_blocks, stale_table.data());
+    stale_disk.unmount();
+    crash_disk.unmount();
+    EXPECT_FALSE(crash_MB.state & fs_state_clean);
+
+    {
+        FileSystem crash_fs(crash_disk);
+        crash_fs.mount();
+        EXPECT_TRUE(crash_fs.is_scanned_on_mount());
+        EXPECT_EQ(crash_fs.read(inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+        EXPECT_TRUE(cmp_data(wdata, rdata));
+        EXPECT_EQ(crash_fs.get_block_checksums().get_n_mismatches(), 0);
+        crash_fs.unmount();
+
+        // Rebuilt table stored by the unmount verifies the next mount
+        crash_fs.mount();
+        EXPECT_FALSE(crash_fs.is_scanned_on_mount());
+        EXPECT_EQ(crash_fs.read(inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+        EXPECT_TRUE(cmp_data(wdata, rdata));
+        EXPECT_GT(crash_fs.get_block_checksums().get_n_verified(), 0);
+        EXPECT_EQ(crash_fs.get_block_checksums().get_n_mismatches(), 0);
+        crash_fs.unmount();
+    }
+    std::remove(stale_disk_name);
+    std::remove(crash_disk_name);
+}
+
+TEST_P(FileSystemTest, format_with_allocation_bitmaps) {
+    fs->unmount();
+    FileSystem::format(disk, fs_feature_allocation_bitmaps);
+
+    disk.mount();
+    disk.read(fs_offset_super_block, cast_to_data(&MB), sizeof(super_block));
+    disk.unmount();
+    int32_t n_bitmap_blocks =
+        FileSystem::calc_n_bitmap_blocks(MB.n_inode_blocks, MB.n_data_blocks + MB.n_bitmap_blocks, block_size);
+    EXPECT_EQ(MB.n_bitmap_blocks, n_bitmap_blocks);
+    EXPECT_GT(MB.n_bitmap_blocks, 0);
+    EXPECT_EQ(MB.n_inode_blocks + MB.n_bitmap_blocks + MB.n_data_blocks + 1, disk.get_disk_size());
+    EXPECT_EQ(MB.state, fs_state_clean);
+
+    // Inodes and data move past the bitmap blocks
+    Block block(disk, MB);
+    EXPECT_EQ(block.inode_n_to_block_n(0), fs_offset_inode_block + MB.n_bitmap_blocks);
+    EXPECT_EQ(block.data_n_to_block_n(0), fs_offset_inode_block + MB.n_bitmap_blocks + MB.n_inode_blocks);
+
+    fs->mount();
+    EXPECT_FALSE(fs->is_scanned_on_mount());
+    EXPECT_EQ(fs->free_inodes(), MB.n_inode_blocks);
+    EXPECT_EQ(fs->free_data_blocks(), MB.n_data_blocks);
+
+    // Mounted image is not clean anymore
+    disk.mount();
+    disk.read(fs_offset_super_block, cast_to_data(&MB), sizeof(super_block));
+    disk.unmount();
+    EXPECT_EQ(MB.state, 0u);
+}
+
+TEST_P(FileSystemTest, clean_mount_loads_stored_bitmaps) {
+    fs->unmount();
+    FileSystem::format(disk, fs_feature_allocation_bitmaps);
+    fs->mount();
+
+    DataBufferType wdata(3 * block_size + 1);
+    DataBufferType rdata(wdata.size());
+    fill_dummy(wdata);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, wdata.data(), 0, wdata.size());
+    fs->remove_file(fs->create_file(valid_file_name));
+    auto inode_rows = fs->get_inode_bitmap().get_rows();
+    auto data_rows = fs->get_data_bitmap().get_rows();
+    fs->unmount();
+
+    fs->mount();
+    EXPECT_FALSE(fs->is_scanned_on_mount());
+    EXPECT_EQ(fs->get_inode_bitmap().get_rows(), inode_rows);
+    EXPECT_EQ(fs->get_data_bitmap().get_rows(), data_rows);
+    EXPECT_EQ(fs->read(inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+    EXPECT_TRUE(cmp_data(wdata, rdata));
+
+    // Mounted again without unmount, as after a crash, the bitmaps are scanned to the same ones
+    FileSystem crashed_fs(disk);
+    crashed_fs.mount();
+    EXPECT_TRUE(crashed_fs.is_scanned_on_mount());
+    EXPECT_EQ(crashed_fs.get_inode_bitmap().get_rows(), inode_rows);
+    EXPECT_EQ(crashed_fs.get_data_bitmap().get_rows(), data_rows);
+    crashed_fs.unmount();
+}
+
+TEST_P(FileSystemTest, corrupted_bitmaps_fall_back_to_scan) {
+    fs->unmount();
+    FileSystem::format(disk, fs_feature_allocation_bitmaps);
+    fs->mount();
+
+    DataBufferType wdata(2 * block_size);
+    fill_dummy(wdata);
+    fs->write(fs->create_file(valid_file_name), wdata.data(), 0, wdata.size());
+    int32_t free_data_blocks = fs->free_data_blocks();
+    fs->unmount();
+
+    // Stored bitmaps claim every data block is free
+    DataBufferType rdata(block_size);
+    disk.mount();
+    disk.read(fs_offset_inode_block, rdata.data(), block_size);
+    std::fill(rdata.begin(), rdata.end(), 0);
+    disk.write(fs_offset_inode_block, rdata.data(), block_size);
+    disk.unmount();
+
+    fs->mount();
+    EXPECT_TRUE(fs->is_scanned_on_mount());
+    EXPECT_EQ(fs->free_data_blocks(), free_data_blocks);
+    EXPECT_EQ(fs->free_inodes(), fs->get_inode_blocks_ammount() - 1);
+}
+
+TEST_P(FileSystemTest, steady_state_io_does_not_allocate) {
+    int32_t chunk_len = block_size / 2;
+    int32_t n_chunks = 2 * (meta_n_direct_ptrs + n_indirect_ptrs_in_block);
+    DataBufferType wdata(chunk_len);
+    DataBufferType rdata(n_chunks * chunk_len);
+    fill_dummy(wdata);
+
+    // Larger file first, every buffer and pool reaches its working size
+    int32_t warm_inode_n = fs->create_file(valid_file_name);
+    for (int32_t chunk_n = 0; chunk_n < 2 * n_chunks; chunk_n++) {
+        fs->write(warm_inode_n, wdata.data(), 0, chunk_len);
+    }
+    fs->read(warm_inode_n, rdata.data(), 0, rdata.size());
+    ASSERT_EQ(fs->remove_file(warm_inode_n), warm_inode_n);
+
+    int32_t inode_n = fs->create_file(valid_file_name);
+    AllocCounter alloc_counter;
+    for (int32_t chunk_n = 0; chunk_n < n_chunks; chunk_n++) {
+        ASSERT_EQ(fs->write(inode_n, wdata.data(), 0, chunk_len), chunk_len);
+    }
+    ASSERT_EQ(fs->write(inode_n, wdata.data(), chunk_len, chunk_len), chunk_len);
+    ASSERT_EQ(fs->read(inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+    for (int32_t offset = 0; offset < static_cast<int32_t>(rdata.size()); offset += block_size) {
+        EXPECT_TRUE(fs->read_view(inode_n, offset, block_size).is_pinned());
+    }
+    EXPECT_EQ(alloc_counter.get_n_allocs(), 0);
+}
+
+TEST_P(FileSystemTest, generic_arithmetic_reads_same_data) {
+    int32_t data_len = block_size * meta_n_direct_ptrs + block_size / 2 + 3;
+    DataBufferType ref_data(data_len);
+    fill_dummy(ref_data);
+
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, ref_data.data(), 0, data_len / 3);
+    fs->set_block_arithmetic(BlockArithmetic::Generic);
+    fs->write(inode_n, &ref_data[data_len / 3], 0, data_len - data_len / 3);
+    EXPECT_EQ(fs->get_block_arithmetic(), BlockArithmetic::Generic);
+
+    // Both paths see the file written by the other one
+    for (auto arithmetic : {BlockArithmetic::Generic, BlockArithmetic::Specialized}) {
+        fs->set_block_arithmetic(arithmetic);
+        DataBufferType rdata(data_len);
+        for (int32_t offset = 0; offset < data_len; offset += block_size / 3) {
+            int32_t length = std::min(block_size / 3, data_len - offset);
+            ASSERT_EQ(fs->read(inode_n, &rdata[offset], offset, length), length);
+        }
+        EXPECT_TRUE(cmp_data(rdata.data(), ref_data.data(), data_len));
+    }
+}
+
+TEST_P(FileSystemTest, free_counters_follow_files) {
+    auto& data_bitmap = fs->get_data_bitmap();
+    EXPECT_EQ(fs->free_inodes(), MB.n_inode_blocks - 3);
+    EXPECT_EQ(fs->free_data_blocks(), MB.n_data_blocks - data_bitmap.count_used());
+
+    int32_t free_data_blocks = fs->free_data_blocks();
+    DataBufferType ref_data(2 * block_size);
+    fill_dummy(ref_data);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    fs->write(inode_n, ref_data.data(), 0, ref_data.size());
+    EXPECT_EQ(fs->free_inodes(), MB.n_inode_blocks - 4);
+    EXPECT_EQ(fs->free_data_blocks(), free_data_blocks - 2);
+
+    fs->remove_file(inode_n);
+    EXPECT_EQ(fs->free_inodes(), MB.n_inode_blocks - 3);
+    EXPECT_EQ(fs->free_data_blocks(), free_data_blocks);
+    EXPECT_EQ(data_bitmap.count_used(), data_bitmap.get_n_used());
+
+    FileSystem unmounted_fs(disk);
+    EXPECT_EQ(unmounted_fs.free_data_blocks(), -1);
+    EXPECT_EQ(unmounted_fs.free_inodes(), -1);
+}
+
+TEST_P(FileSystemTest, write_fails_fast_without_free_blocks) {
+    // Largest file fitting in the free blocks together with its indirect blocks
+    int32_t n_blocks = fs->free_data_blocks();
+    while (n_blocks + IndirectInode::calc_n_blocks(n_blocks, n_indirect_ptrs_in_block) > fs->free_data_blocks()) {
+        n_blocks--;
+    }
+
+    DataBufferType ref_data((n_blocks + 1) * block_size);
+    fill_dummy(ref_data);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    EXPECT_EQ(fs->write(inode_n, ref_data.data(), 0, ref_data.size()), fs_nullptr);
+    EXPECT_EQ(fs->get_file_length(inode_n), 0);
+
+    // One more block does not fit any more
+    int32_t n_written = n_blocks * block_size;
+    EXPECT_EQ(fs->write(inode_n, ref_data.data(), 0, n_written), n_written);
+    EXPECT_EQ(fs->write(inode_n, ref_data.data(), 0, block_size), fs_nullptr);
+    EXPECT_EQ(fs->get_file_length(inode_n), n_written);
+
+    // Edit of written data needs no new blocks
+    EXPECT_EQ(fs->write(inode_n, ref_data.data(), block_size, block_size), block_size);
+    EXPECT_EQ(fs->get_data_bitmap().count_used(), fs->get_data_bitmap().get_n_used());
+}
+
+TEST_P(FileSystemTest, write_allocates_contiguous_blocks) {
+    constexpr int32_t n_file_blocks = 6;
+    DataBufferType ref_data(n_file_blocks * block_size);
+    fill_dummy(ref_data);
+
+    // Appends of one file interleaved with another one still keep each write in one run
+    int32_t inode_n = fs->create_file(valid_file_name);
+    int32_t other_inode_n = fs->create_file("other");
+    fs->write(inode_n, ref_data.data(), 0, block_size / 2);
+    fs->write(other_inode_n, ref_data.data(), 0, block_size);
+    fs->write(inode_n, &ref_data[block_size / 2], 0, ref_data.size() - block_size / 2);
+
+    {
+        Inode inode;
+        Block block(disk, MB);
+        inode.load(inode_n, block);
+        for (int32_t ptr_n = 2; ptr_n < n_file_blocks; ptr_n++) {
+            EXPECT_EQ(inode.ptr(ptr_n), inode.ptr(ptr_n - 1) + 1);
+        }
+    }
+
+    // File end followed by a used block, the next run starts past it
+    fs->write(other_inode_n, ref_data.data(), 0, block_size);
+    fs->write(inode_n, ref_data.data(), 0, 2 * block_size);
+    {
+        Inode inode;
+        Block block(disk, MB);
+        inode.load(inode_n, block);
+        EXPECT_EQ(inode.ptr(n_file_blocks + 1), inode.ptr(n_file_blocks) + 1);
+    }
+
+    DataBufferType rdata(ref_data.size());
+    EXPECT_EQ(fs->read(inode_n, rdata.data(), 0, ref_data.size()), ref_data.size());
+    EXPECT_TRUE(cmp_data(rdata.data(), ref_data.data(), ref_data.size()));
+}
+
+TEST_P(FileSystemTest, alloc_policies_keep_file_data) {
+    int32_t n_file_blocks = meta_n_direct_ptrs + n_indirect_ptrs_in_block;
+    DataBufferType ref_data(n_file_blocks * block_size);
+    DataBufferType rdata(ref_data.size());
+    fill_dummy(ref_data);
+    int32_t free_data_blocks = fs->free_data_blocks();
+
+    for (auto policy : {AllocPolicy::FirstFit, AllocPolicy::NextFit, AllocPolicy::BestFit}) {
+        fs->set_alloc_policy(policy);
+
+        // Appends of two files interleaved, the second one past the first indirect block
+        int32_t inode_n = fs->create_file(valid_file_name);
+        int32_t other_inode_n = fs->create_file("other");
+        for (int32_t offset = 0; offset < static_cast<int32_t>(ref_data.size()); offset += 3 * block_size) {
+            int32_t length = std::min<int32_t>(3 * block_size, ref_data.size() - offset);
+            ASSERT_EQ(fs->write(inode_n, &ref_data[offset], 0, length), length);
+            ASSERT_EQ(fs->write(other_inode_n, &ref_data[offset], 0, length), length);
+        }
+
+        for (auto file_inode_n : {inode_n, other_inode_n}) {
+            EXPECT_EQ(fs->read(file_inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+            EXPECT_TRUE(cmp_data(ref_data, rdata));
+        }
+        EXPECT_EQ(fs->get_data_bitmap().count_used(), fs->get_data_bitmap().get_n_used());
+
+        fs->remove_file(inode_n);
+        fs->remove_file(other_inode_n);
+        EXPECT_EQ(fs->free_data_blocks(), free_data_blocks);
+    }
+
+    // Policy is kept over a remount
+    fs->unmount();
+    fs->mount();
+    EXPECT_EQ(fs->get_alloc_policy(), AllocPolicy::BestFit);
+}
+
 TEST_P(FileSystemTest, scan_blocks) {
+    EXPECT_TRUE(fs->is_scanned_on_mount());
+
     for (const auto inode_n : used_inode_blocks) {
         EXPECT_TRUE(fs->get_inode_bitmap().get_status(inode_n));
     }
@@ -323,10 +877,37 @@ TEST_P(FileSystemTest, dealloc_inode) {
             n_dealocated_blocks++;
         }
     }
-    constexpr int32_t n_indirect_data_blocks = 5;
+    // Four full indirect blocks, the unused link in the last one frees nothing
+    constexpr int32_t n_indirect_data_blocks = 4;
     EXPECT_EQ(n_dealocated_blocks, ref_nested_inode_n_ptrs + n_indirect_data_blocks);
 }
 
+TEST_P(FileSystemTest, append_past_full_indirect_block) {
+    DataBufferType other_data(block_size);
+    ASSERT_EQ(fs->read(1, other_data.data(), 0, block_size), block_size);
+    int32_t n_free_data_blocks = fs->free_data_blocks();
+
+    // Pointers fill the first indirect block exactly, its link slot is still unused
+    int32_t full_len = (meta_n_direct_ptrs + n_indirect_ptrs_in_block - 1) * block_size;
+    DataBufferType ref_data(full_len + block_size);
+    fill_dummy(ref_data);
+    int32_t inode_n = fs->create_file(valid_file_name);
+    ASSERT_EQ(fs->write(inode_n, ref_data.data(), 0, full_len), full_len);
+    ASSERT_EQ(fs->write(inode_n, &ref_data[full_len], 0, block_size), block_size);
+
+    DataBufferType rdata(ref_data.size());
+    ASSERT_EQ(fs->read(inode_n, rdata.data(), 0, rdata.size()), static_cast<int32_t>(rdata.size()));
+    EXPECT_TRUE(cmp_data(ref_data, rdata));
+
+    // Blocks of other files are neither overwritten nor freed with the file
+    DataBufferType other_rdata(block_size);
+    fs->read(1, other_rdata.data(), 0, block_size);
+    EXPECT_TRUE(cmp_data(other_data, other_rdata));
+    ASSERT_EQ(fs->remove_file(inode_n), inode_n);
+    EXPECT_EQ(fs->free_data_blocks(), n_free_data_blocks);
+    EXPECT_TRUE(fs->get_data_bitmap().get_status(0));
+}
+
 TEST_P(FileSystemTest, rename_inode) {
     constexpr const char* file_name_ref = "test_inode name_ref";
     int32_t addr = fs->create_file(file_name_ref);
@@ -136,5 +136,18 @@ TEST_P(IndirectInodeTest, add_data_and_commit_with_no_free_space) {
     EXPECT_EQ(n_written, 2 + (n_indirect_ptrs_in_block - 1));
 }
 
+TEST_P(IndirectInodeTest, calc_n_blocks) {
+    EXPECT_EQ(IndirectInode::calc_n_blocks(0, n_indirect_ptrs_in_block), 0);
+    EXPECT_EQ(IndirectInode::calc_n_blocks(meta_n_direct_ptrs, n_indirect_ptrs_in_block), 0);
+    EXPECT_EQ(IndirectInode::calc_n_blocks(meta_n_direct_ptrs + 1, n_indirect_ptrs_in_block), 1);
+    EXPECT_EQ(IndirectInode::calc_n_blocks(meta_n_direct_ptrs + n_indirect_ptrs_in_block - 1, n_indirect_ptrs_in_block),
+              1);
+    EXPECT_EQ(IndirectInode::calc_n_blocks(meta_n_direct_ptrs + n_indirect_ptrs_in_block, n_indirect_ptrs_in_block), 2);
+
+    // Blocks of the file set up for the test
+    int32_t n_ptrs = block->bytes_to_blocks(inode.file_len);
+    EXPECT_EQ(IndirectInode::calc_n_blocks(n_ptrs, n_indirect_ptrs_in_block), 3);
+}
+
 INSTANTIATE_TEST_SUITE_P(BlockSize, IndirectInodeTest, testing::ValuesIn(valid_block_sizes));
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "fsfs/read_ahead.hpp"
+
+#include "test_base.hpp"
+using namespace FSFS;
+namespace {
+constexpr int32_t test_inode_n = 3;
+constexpr int32_t test_n_ptrs = 64;
+
+TEST(ReadAheadTest, constructor_throw_negative_window) { EXPECT_THROW(ReadAhead(-1), std::invalid_argument); }
+
+TEST(ReadAheadTest, sequential_reads_grow_window) {
+    ReadAhead read_ahead;
+    int32_t first_ptr_n = 0;
+
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 0, 100, 0, test_n_ptrs, first_ptr_n), initial_read_ahead_window);
+    EXPECT_EQ(first_ptr_n, 1);
+
+    // Only pointers not handed out yet are returned
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 100, 100, 0, test_n_ptrs, first_ptr_n), initial_read_ahead_window);
+    EXPECT_EQ(first_ptr_n, 1 + initial_read_ahead_window);
+    EXPECT_EQ(read_ahead.get_window(), 2 * initial_read_ahead_window);
+
+    for (int32_t i = 0; i < 8; i++) {
+        read_ahead.advance(test_inode_n, 200 + i * 100, 100, 0, test_n_ptrs, first_ptr_n);
+    }
+    EXPECT_EQ(read_ahead.get_window(), default_read_ahead_window);
+}
+
+TEST(ReadAheadTest, refilled_after_half_window_consumed) {
+    ReadAhead read_ahead(8);
+    int32_t first_ptr_n = 0;
+
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 0, 100, 0, test_n_ptrs, first_ptr_n), 4);
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 100, 100, 1, test_n_ptrs, first_ptr_n), 5);
+    EXPECT_EQ(first_ptr_n, 5);
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 200, 100, 2, test_n_ptrs, first_ptr_n), 0);
+
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 300, 100, 5, test_n_ptrs, first_ptr_n), 4);
+    EXPECT_EQ(first_ptr_n, 10);
+}
+
+TEST(ReadAheadTest, random_read_closes_window) {
+    ReadAhead read_ahead;
+    int32_t first_ptr_n = 0;
+
+    read_ahead.advance(test_inode_n, 0, 100, 0, test_n_ptrs, first_ptr_n);
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 500, 100, 0, test_n_ptrs, first_ptr_n), 0);
+    EXPECT_EQ(read_ahead.get_window(), 0);
+
+    // Other file breaks the stream as well
+    read_ahead.advance(test_inode_n, 0, 100, 0, test_n_ptrs, first_ptr_n);
+    EXPECT_EQ(read_ahead.advance(test_inode_n + 1, 100, 100, 0, test_n_ptrs, first_ptr_n), 0);
+}
+
+TEST(ReadAheadTest, window_clipped_to_file_end) {
+    ReadAhead read_ahead;
+    int32_t first_ptr_n = 0;
+
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 0, 100, 0, 3, first_ptr_n), 2);
+    EXPECT_EQ(first_ptr_n, 1);
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 100, 100, 0, 3, first_ptr_n), 0);
+}
+
+TEST(ReadAheadTest, zero_window_disables_prefetch) {
+    ReadAhead read_ahead(0);
+    int32_t first_ptr_n = 0;
+
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 0, 100, 0, test_n_ptrs, first_ptr_n), 0);
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 100, 100, 0, test_n_ptrs, first_ptr_n), 0);
+
+    read_ahead.set_max_window(2);
+    EXPECT_EQ(read_ahead.advance(test_inode_n, 200, 100, 0, test_n_ptrs, first_ptr_n), 2);
+}
+}
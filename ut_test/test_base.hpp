@@ -1,7 +1,10 @@
 #ifndef UT_TEST_TEST_BASE_HPP
 #define UT_TEST_TEST_BASE_HPP
+#include <cstdlib>
 #include <cstring>
 #include <exception>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "common/types.hpp"
@@ -12,6 +15,29 @@
 namespace FSFS {
 
 constexpr int32_t block_size_quant = 1024;
+constexpr char ut_disk_mode_env[] = "FSFS_UT_DISK_MODE";
+
+// Lets the same suite run against every disk backend, selected by the environment.
+inline DiskMode ut_disk_mode() {
+    const char* mode = std::getenv(ut_disk_mode_env);
+    if (mode != nullptr && std::string_view(mode) == "posix") {
+        return DiskMode::Posix;
+    }
+    if (mode != nullptr && std::string_view(mode) == "mmap") {
+        return DiskMode::Mmap;
+    }
+    if (mode != nullptr && std::string_view(mode) == "direct") {
+        return DiskMode::Direct;
+    }
+    if (mode != nullptr && std::string_view(mode) == "ram") {
+        return DiskMode::Ram;
+    }
+    if (mode != nullptr && std::string_view(mode) == "striped") {
+        return DiskMode::Striped;
+    }
+    return DiskMode::Stream;
+}
+
 const int32_t valid_block_sizes[] = {block_size_quant, block_size_quant * 2, block_size_quant * 3, block_size_quant * 4};
 class TestBaseBasic : public testing::WithParamInterface<int32_t> {
    protected:
@@ -47,19 +73,35 @@ class TestBaseBasic : public testing::WithParamInterface<int32_t> {
 class TestBaseDisk : public TestBaseBasic {
    protected:
     Disk disk;
+    const std::vector<std::string> stripe_member_names = {std::string(disk_name) + ".0", std::string(disk_name) + ".1"};
 
    public:
-    TestBaseDisk() : disk(block_size) {
+    TestBaseDisk() : disk(block_size, ut_disk_mode()) {
+        // RAM image needs no file, parallel runs do not share the temporary image
+        if (disk.get_mode() == DiskMode::Ram) {
+            disk.open_ram(n_blocks);
+            return;
+        }
+
         std::remove(disk_name);
 
-        Disk::create(disk_name, n_blocks, block_size);
+        if (disk.get_mode() == DiskMode::Striped) {
+            Disk::create_striped(disk_name, stripe_member_names, n_blocks, block_size, 2 * block_size);
+        } else {
+            Disk::create(disk_name, n_blocks, block_size);
+        }
         disk.open(disk_name);
     }
 
     ~TestBaseDisk() {
         EXPECT_FALSE(disk.is_mounted());
 
-        std::remove(disk_name);
+        if (disk.get_mode() != DiskMode::Ram) {
+            std::remove(disk_name);
+        }
+        for (auto& member_name : stripe_member_names) {
+            std::remove(member_name.c_str());
+        }
     }
 };
 
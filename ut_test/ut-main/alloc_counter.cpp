@@ -0,0 +1,46 @@
+#include "alloc_counter.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<int32_t> n_counters(0);
+std::atomic<int64_t> n_allocs(0);
+
+void* counted_alloc(size_t size, size_t alignment) {
+    if (n_counters.load(std::memory_order_relaxed) > 0) {
+        n_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(size ? size : 1);
+    } else if (posix_memalign(&p, alignment, size ? size : 1) != 0) {
+        p = nullptr;
+    }
+
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+}
+
+void* operator new(size_t size) { return counted_alloc(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    return counted_alloc(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace FSFS {
+AllocCounter::AllocCounter() : n_allocs_at_start(n_allocs.load()) { n_counters++; }
+
+AllocCounter::~AllocCounter() { n_counters--; }
+
+int64_t AllocCounter::get_n_allocs() const { return n_allocs.load() - n_allocs_at_start; }
+}